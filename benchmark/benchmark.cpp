@@ -0,0 +1,1047 @@
+#include <bricked_extractor.h>
+#include <contour.h>
+#include <cube_classifier.h>
+#include <ddsbase.h>
+#include <extractor_check.h>
+#include <glfw3.h>
+#include <gpu_extractor.h>
+#include <grid.h>
+#include <isosurface_extractor.h>
+#include <marching_cubes.h>
+#include <mesh_writer.h>
+#include <surface.h>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+#define BENCHMARK_CHUNK_VERTICES 4096
+
+// Vertices the extractor used to reserve for every cell before shrinking the result
+#define OVER_ALLOCATED_VERTICES_PER_CELL 24
+
+// Points per axis of the 2D grids for every point per axis of the volumes
+#define GRID_2D_POINTS_SCALE 8
+
+// Bricks per axis the out-of-core volumes are split into, so many more bricks stream through than fit the cache
+#define OUT_OF_CORE_BRICKS_PER_AXIS 8
+
+typedef std::function<float(float, float, float)> BenchmarkFunction;
+
+struct BenchmarkVolume
+{
+	std::vector<float> values;
+	int numPoints;
+	float min;
+	float max;
+	float spacing;
+};
+
+// One row of the JSON report. Kernels over points count every point as a cell, bytes are those of the
+// scalars a kernel reads or, for kernels that produce a grid or a file, of what they produce.
+struct BenchmarkResult
+{
+	std::string benchmark;
+	std::string variant;
+	std::string dataset;
+	long long cells;
+	double bytes;
+	double seconds;
+};
+
+static std::vector<BenchmarkResult> s_results;
+
+static void record(const std::string& benchmark, const std::string& variant, const std::string& dataset, long long cells, double bytes, double seconds)
+{
+	s_results.push_back(BenchmarkResult{ benchmark, variant, dataset, cells, bytes, seconds });
+}
+
+typedef int (*BenchmarkVoxel)(const BenchmarkVolume& volume, int x, int y, int z, float isoValue, float colorNorm, MeshVertexAttribute* buffer);
+
+static float radius(float x, float y, float z)
+{
+	return sqrt(x * x + y * y + z * z);
+}
+
+static float sinc(float x, float y, float z)
+{
+	return (sinf(10 * x) * sinf(10 * y) * sinf(10 * z)) / (1000 * x * y * z);
+}
+
+static float radius2D(float x, float y)
+{
+	return sqrt(x * x + y * y);
+}
+
+static float sinc2D(float x, float y)
+{
+	return (sinf(10 * x) * sinf(10 * y)) / (100 * x * y);
+}
+
+static BenchmarkVolume createVolume(BenchmarkFunction function, int numPoints)
+{
+	BenchmarkVolume volume;
+	volume.numPoints = numPoints;
+	volume.spacing = 2.0f / (numPoints - 1);
+	volume.values.resize(numPoints * numPoints * numPoints);
+	volume.min = INFINITY;
+	volume.max = -INFINITY;
+
+	for (int i = 0; i < (int)volume.values.size(); i++)
+	{
+		float x = -1.0f + (i % numPoints) * volume.spacing;
+		float y = -1.0f + ((i / numPoints) % numPoints) * volume.spacing;
+		float z = -1.0f + (i / (numPoints * numPoints)) * volume.spacing;
+		float value = function(x, y, z);
+		value = std::isfinite(value) ? value : 1.0f;
+
+		volume.values[i] = value;
+		volume.min = fmin(volume.min, value);
+		volume.max = fmax(volume.max, value);
+	}
+
+	return volume;
+}
+
+static const int s_cornerOffsets[CORNERS_PER_VOXEL][3] = {
+	{0, 0, 0}, {1, 0, 0}, {1, 1, 0}, {0, 1, 0},
+	{0, 0, 1}, {1, 0, 1}, {1, 1, 1}, {0, 1, 1}
+};
+
+static void gatherValues(const BenchmarkVolume& volume, int x, int y, int z, float* values)
+{
+	int n = volume.numPoints;
+	for (int i = 0; i < CORNERS_PER_VOXEL; i++)
+	{
+		values[i] = volume.values[(x + s_cornerOffsets[i][0]) + (y + s_cornerOffsets[i][1]) * n + (z + s_cornerOffsets[i][2]) * n * n];
+	}
+}
+
+static void gatherPositions(const BenchmarkVolume& volume, int x, int y, int z, glm::vec3* positions)
+{
+	for (int i = 0; i < CORNERS_PER_VOXEL; i++)
+	{
+		positions[i].x = -1.0f + (x + s_cornerOffsets[i][0]) * volume.spacing;
+		positions[i].y = -1.0f + (y + s_cornerOffsets[i][1]) * volume.spacing;
+		positions[i].z = -1.0f + (z + s_cornerOffsets[i][2]) * volume.spacing;
+	}
+}
+
+static int classify(float isoValue, const float* values)
+{
+	int code = 0;
+	for (int i = 0; i < CORNERS_PER_VOXEL; i++)
+	{
+		code |= (values[i] < isoValue) << i;
+	}
+
+	return code;
+}
+
+static int emitTriangles(const int* triangles, const glm::vec3* vertices, float colorNorm, MeshVertexAttribute* buffer)
+{
+	int numVertices = 0;
+	while (triangles[numVertices] != -1)
+	{
+		glm::vec3 a = vertices[triangles[numVertices + 0]];
+		glm::vec3 b = vertices[triangles[numVertices + 1]];
+		glm::vec3 c = vertices[triangles[numVertices + 2]];
+		glm::vec3 n = glm::normalize(glm::cross(b - a, c - a));
+
+		buffer[numVertices].position = a;
+		buffer[numVertices].normal = n;
+		buffer[numVertices++].colorNorm = colorNorm;
+		buffer[numVertices].position = b;
+		buffer[numVertices].normal = n;
+		buffer[numVertices++].colorNorm = colorNorm;
+		buffer[numVertices].position = c;
+		buffer[numVertices].normal = n;
+		buffer[numVertices++].colorNorm = colorNorm;
+	}
+
+	return numVertices;
+}
+
+static void interpolateEdges(int edges, float isoValue, const glm::vec3* positions, const float* values, glm::vec3* vertices)
+{
+	for (int i = 0; i < EDGES_PER_VOXEL; i++)
+	{
+		if (edges & (1 << i))
+		{
+			int c0 = MarchingCubesTables::edgeCorners[i][0];
+			int c1 = MarchingCubesTables::edgeCorners[i][1];
+			vertices[i] = MarchingCubes::vertexInterpolation(isoValue, positions[c0], positions[c1], values[c0], values[c1]);
+		}
+	}
+}
+
+// Reproduces the original Mesh::updateVoxel, which rebuilt both tables on the stack and fetched every corner for every voxel
+static int stackTableVoxel(const BenchmarkVolume& volume, int x, int y, int z, float isoValue, float colorNorm, MeshVertexAttribute* buffer)
+{
+	int edgeTable[MARCHING_CUBES_CASES];
+	int triangleTable[MARCHING_CUBES_CASES][MAX_TRIANGLE_TABLE_ENTRIES];
+	memcpy(edgeTable, MarchingCubesTables::edgeTable, sizeof(edgeTable));
+	memcpy(triangleTable, MarchingCubesTables::triangleTable, sizeof(triangleTable));
+
+	float values[CORNERS_PER_VOXEL];
+	glm::vec3 positions[CORNERS_PER_VOXEL];
+	gatherValues(volume, x, y, z, values);
+	gatherPositions(volume, x, y, z, positions);
+
+	int code = classify(isoValue, values);
+	if (edgeTable[code] == 0)
+	{
+		return 0;
+	}
+
+	glm::vec3 vertices[EDGES_PER_VOXEL];
+	interpolateEdges(edgeTable[code], isoValue, positions, values, vertices);
+	return emitTriangles(triangleTable[code], vertices, colorNorm, buffer);
+}
+
+// Table driven loop over the static tables
+static int staticTableVoxel(const BenchmarkVolume& volume, int x, int y, int z, float isoValue, float colorNorm, MeshVertexAttribute* buffer)
+{
+	float values[CORNERS_PER_VOXEL];
+	gatherValues(volume, x, y, z, values);
+
+	int code = classify(isoValue, values);
+	if (MarchingCubesTables::edgeTable[code] == 0)
+	{
+		return 0;
+	}
+
+	glm::vec3 positions[CORNERS_PER_VOXEL];
+	gatherPositions(volume, x, y, z, positions);
+
+	glm::vec3 vertices[EDGES_PER_VOXEL];
+	interpolateEdges(MarchingCubesTables::edgeTable[code], isoValue, positions, values, vertices);
+	return emitTriangles(MarchingCubesTables::triangleTable[code], vertices, colorNorm, buffer);
+}
+
+// MarchingCubes::polygonise, which the extractors use
+static int polygoniseVoxel(const BenchmarkVolume& volume, int x, int y, int z, float isoValue, float colorNorm, MeshVertexAttribute* buffer)
+{
+	float values[CORNERS_PER_VOXEL];
+	gatherValues(volume, x, y, z, values);
+
+	int code = classify(isoValue, values);
+	if (MarchingCubesTables::edgeTable[code] == 0)
+	{
+		return 0;
+	}
+
+	glm::vec3 positions[CORNERS_PER_VOXEL];
+	gatherPositions(volume, x, y, z, positions);
+
+	return MarchingCubes::polygonise(code, isoValue, positions, values, colorNorm, buffer);
+}
+
+// Runs a voxel kernel over the whole volume, returns the number of vertices emitted
+static long long runKernel(const BenchmarkVolume& volume, float isoValue, BenchmarkVoxel voxel, double& checksum)
+{
+	std::vector<MeshVertexAttribute> buffer(BENCHMARK_CHUNK_VERTICES);
+	float colorNorm = (isoValue - volume.min) / (volume.max - volume.min);
+	int n = volume.numPoints;
+	int offset = 0;
+	long long numVertices = 0;
+
+	for (int z = 0; z < n - 1; z++)
+	{
+		for (int y = 0; y < n - 1; y++)
+		{
+			for (int x = 0; x < n - 1; x++)
+			{
+				if (offset + MAX_TRIANGLE_TABLE_ENTRIES > BENCHMARK_CHUNK_VERTICES)
+				{
+					for (int i = 0; i < offset; i++)
+					{
+						checksum += fabs(buffer[i].position.x) + fabs(buffer[i].position.y) + fabs(buffer[i].position.z);
+					}
+
+					offset = 0;
+				}
+
+				int emitted = voxel(volume, x, y, z, isoValue, colorNorm, &buffer[offset]);
+				offset += emitted;
+				numVertices += emitted;
+			}
+		}
+	}
+
+	for (int i = 0; i < offset; i++)
+	{
+		checksum += fabs(buffer[i].position.x) + fabs(buffer[i].position.y) + fabs(buffer[i].position.z);
+	}
+
+	return numVertices;
+}
+
+static void benchmarkKernels(const std::string& name, const BenchmarkVolume& volume, float isoValue, int iterations)
+{
+	struct Entry
+	{
+		const char* name;
+		BenchmarkVoxel voxel;
+	};
+
+	Entry entries[] = {
+		{ "stack tables", stackTableVoxel },
+		{ "static tables", staticTableVoxel },
+		{ "polygonise", polygoniseVoxel }
+	};
+
+	long long numCells = (long long)(volume.numPoints - 1) * (volume.numPoints - 1) * (volume.numPoints - 1);
+	double baseline = 0;
+
+	printf("%s (%d^3 points, iso %.3f)\n", name.c_str(), volume.numPoints, isoValue);
+	for (Entry& entry : entries)
+	{
+		double checksum = 0;
+		long long numVertices = 0;
+		double best = INFINITY;
+
+		for (int i = 0; i < iterations; i++)
+		{
+			auto start = std::chrono::high_resolution_clock::now();
+			numVertices = runKernel(volume, isoValue, entry.voxel, checksum);
+			std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+			best = fmin(best, elapsed.count());
+		}
+
+		baseline = (baseline == 0) ? best : baseline;
+		record("voxel kernels", entry.name, name, numCells, volume.values.size() * sizeof(float), best);
+
+		printf("  %-14s %9.2f ms %9.2f Mcells/s %6.2fx  %lld vertices (checksum %.3f)\n",
+			entry.name,
+			best * 1000.0,
+			numCells / best / 1.0e6,
+			baseline / best,
+			numVertices,
+			checksum / iterations);
+	}
+
+	printf("\n");
+}
+
+// Classifies every cell one at a time and a row at a time, returns the number of non trivial cells
+static long long classifyCells(const BenchmarkVolume& volume, float isoValue, bool rows)
+{
+	int n = volume.numPoints;
+	std::vector<uint8_t> codes(n);
+	std::vector<int> active(n);
+	long long numActive = 0;
+
+	for (int z = 0; z < n - 1; z++)
+	{
+		for (int y = 0; y < n - 1; y++)
+		{
+			const float* row = volume.values.data() + y * n + z * n * n;
+			if (rows)
+			{
+				numActive += CubeClassifier::classifyRow(row, row + n, row + n * n, row + n + n * n, n - 1, isoValue, codes.data(), active.data());
+				continue;
+			}
+
+			for (int x = 0; x < n - 1; x++)
+			{
+				float values[CORNERS_PER_VOXEL];
+				gatherValues(volume, x, y, z, values);
+				int code = classify(isoValue, values);
+				numActive += (code != 0 && code != 255);
+			}
+		}
+	}
+
+	return numActive;
+}
+
+static void benchmarkClassifier(const std::string& name, const BenchmarkVolume& volume, float isoValue, int iterations)
+{
+	long long numCells = (long long)(volume.numPoints - 1) * (volume.numPoints - 1) * (volume.numPoints - 1);
+	double baseline = 0;
+
+	printf("%s classification (%s)\n", name.c_str(), CubeClassifier::instructionSet());
+	for (int rows = 0; rows < 2; rows++)
+	{
+		long long numActive = 0;
+		double best = INFINITY;
+		for (int i = 0; i < iterations; i++)
+		{
+			auto start = std::chrono::high_resolution_clock::now();
+			numActive = classifyCells(volume, isoValue, rows != 0);
+			std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+			best = fmin(best, elapsed.count());
+		}
+
+		baseline = (baseline == 0) ? best : baseline;
+		record("classification", rows ? "rows" : "per cell", name, numCells, volume.values.size() * sizeof(float), best);
+
+		printf("  %-14s %9.2f ms %9.2f Mcells/s %6.2fx  %lld active cells\n",
+			rows ? "rows" : "per cell",
+			best * 1000.0,
+			numCells / best / 1.0e6,
+			baseline / best,
+			numActive);
+	}
+
+	printf("\n");
+}
+
+// Times the full extractor and compares its peak memory with the numCells * 24 vertex reservation it replaced
+static void benchmarkExtractor(const std::string& name, const BenchmarkVolume& volume, float isoValue, int iterations)
+{
+	Volume view;
+	view.values = volume.values.data();
+	view.numPointsX = view.numPointsY = view.numPointsZ = volume.numPoints;
+	view.origin = glm::vec3(-1.0f);
+	view.spacing = glm::vec3(volume.spacing);
+	view.min = volume.min;
+	view.max = volume.max;
+
+	long long numCells = (long long)view.numCellsX() * view.numCellsY() * view.numCellsZ();
+	double reserved = numCells * OVER_ALLOCATED_VERTICES_PER_CELL * sizeof(MeshVertexAttribute) / (1024.0 * 1024.0);
+
+	auto octreeStart = std::chrono::high_resolution_clock::now();
+	MinMaxOctree octree(view);
+	std::chrono::duration<double> octreeTime = std::chrono::high_resolution_clock::now() - octreeStart;
+
+	printf("%s extractor (%d threads, over-allocation reserved %.1f MB)\n", name.c_str(), ThreadPool::instance().numThreads(), reserved);
+	printf("  octree built in %.2f ms, %d levels, %.2f MB\n", octreeTime.count() * 1000.0, octree.numLevels(), octree.memory() / (1024.0 * 1024.0));
+
+	struct Entry
+	{
+		const char* name;
+		bool indexed;
+		const MinMaxOctree* octree;
+		IsoSurfaceMethod method;
+	};
+
+	Entry entries[] = {
+		{ "soup", false, nullptr, ISOSURFACE_MARCHING_CUBES },
+		{ "indexed", true, nullptr, ISOSURFACE_MARCHING_CUBES },
+		{ "octree", true, &octree, ISOSURFACE_MARCHING_CUBES },
+		{ "surface nets", true, &octree, ISOSURFACE_SURFACE_NETS },
+		{ "flying soup", false, nullptr, ISOSURFACE_FLYING_EDGES },
+		{ "flying edges", true, nullptr, ISOSURFACE_FLYING_EDGES },
+		{ "adaptive", true, &octree, ISOSURFACE_ADAPTIVE }
+	};
+
+	for (Entry& entry : entries)
+	{
+		IsoSurfaceExtractor extractor(view);
+		extractor.setIndexed(entry.indexed);
+		extractor.setMinMaxOctree(entry.octree);
+		extractor.setMethod(entry.method);
+
+		IsoSurface surface;
+		double best = INFINITY;
+		for (int i = 0; i < iterations; i++)
+		{
+			auto start = std::chrono::high_resolution_clock::now();
+			extractor.extract(isoValue, surface);
+			std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+			best = fmin(best, elapsed.count());
+		}
+
+		record("extractor", entry.name, name, numCells, volume.values.size() * sizeof(float), best);
+		printf("  %-14s %9.2f ms %9.2f Mcells/s  %zu vertices %zu indices, peak %.2f MB\n",
+			entry.name,
+			best * 1000.0,
+			numCells / best / 1.0e6,
+			surface.vertices.size(),
+			surface.indices.size(),
+			extractor.peakMemory() / (1024.0 * 1024.0));
+	}
+
+	printf("\n");
+}
+
+// Holds every extractor against whole volume marching cubes before any of them is timed, so a faster variant that
+// drifts from the others fails the run instead of only showing up as a different vertex count
+static bool checkAgreement(const std::string& name, const BenchmarkVolume& volume, const std::vector<float>& isoValues)
+{
+	Volume view;
+	view.values = volume.values.data();
+	view.numPointsX = view.numPointsY = view.numPointsZ = volume.numPoints;
+	view.origin = glm::vec3(-1.0f);
+	view.spacing = glm::vec3(volume.spacing);
+	view.min = volume.min;
+	view.max = volume.max;
+
+	bool agree = true;
+	for (float isoValue : isoValues)
+	{
+		agree = checkExtractors(view, isoValue, name + ".check.bricks") && agree;
+	}
+
+	printf("%s extractors %s at %zu iso values\n\n", name.c_str(), agree ? "agree" : "DISAGREE", isoValues.size());
+
+	return agree;
+}
+
+// Nested surfaces extracted one after the other against all of them in a single sweep
+static void benchmarkMultiIso(const std::string& name, const BenchmarkVolume& volume, const std::vector<float>& isoValues, int iterations)
+{
+	Volume view;
+	view.values = volume.values.data();
+	view.numPointsX = view.numPointsY = view.numPointsZ = volume.numPoints;
+	view.origin = glm::vec3(-1.0f);
+	view.spacing = glm::vec3(volume.spacing);
+	view.min = volume.min;
+	view.max = volume.max;
+
+	long long numCells = (long long)view.numCellsX() * view.numCellsY() * view.numCellsZ();
+
+	printf("%s multi iso extractor (%zu iso values)\n", name.c_str(), isoValues.size());
+
+	for (int sweep = 0; sweep < 2; sweep++)
+	{
+		IsoSurfaceExtractor extractor(view);
+		extractor.setIndexed(true);
+
+		std::vector<IsoSurface> surfaces(isoValues.size());
+		double best = INFINITY;
+		for (int i = 0; i < iterations; i++)
+		{
+			auto start = std::chrono::high_resolution_clock::now();
+			if (sweep == 1)
+			{
+				extractor.extract(isoValues, surfaces);
+			}
+			else
+			{
+				for (size_t j = 0; j < isoValues.size(); j++)
+				{
+					extractor.extract(isoValues[j], surfaces[j]);
+				}
+			}
+
+			std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+			best = fmin(best, elapsed.count());
+		}
+
+		size_t numVertices = 0;
+		for (const IsoSurface& surface : surfaces)
+		{
+			numVertices += surface.vertices.size();
+		}
+
+		record("multi iso extractor", (sweep == 1) ? "one sweep" : "separately", name, numCells, volume.values.size() * sizeof(float), best);
+		printf("  %-14s %9.2f ms %9.2f Mcells/s  %zu vertices\n",
+			(sweep == 1) ? "one sweep" : "separately",
+			best * 1000.0,
+			numCells / best / 1.0e6,
+			numVertices);
+	}
+
+	printf("\n");
+}
+
+// Hidden window whose context the GPU extraction runs in, OpenGL 4.5 so Mesa's llvmpipe qualifies. GLFW needs a
+// display for it even though it is never shown, Xvfb stands in for one on headless machines.
+static GLFWwindow* createContext()
+{
+	if (!glfwInit())
+	{
+		fprintf(stderr, "Failed to initialize GLFW, --gpu needs a display\n");
+		return nullptr;
+	}
+
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	GLFWwindow* window = glfwCreateWindow(64, 64, "benchmark", NULL, NULL);
+	if (window == nullptr)
+	{
+		fprintf(stderr, "Failed to create an OpenGL 4.5 context, --gpu needs a display\n");
+		glfwTerminate();
+		return nullptr;
+	}
+
+	glfwMakeContextCurrent(window);
+	GLenum glerr = glewInit();
+	if (GLEW_OK != glerr)
+	{
+		fprintf(stderr, "glewInit Error: %s\n", glewGetErrorString(glerr));
+		glfwDestroyWindow(window);
+		glfwTerminate();
+		return nullptr;
+	}
+
+	printf("GPU %s, OpenGL %s\n\n", (const char*)glGetString(GL_RENDERER), (const char*)glGetString(GL_VERSION));
+	return window;
+}
+
+// Marching cubes in compute shaders against the triangle soups of the CPU, which come out in the same order, so
+// every vertex is checked against its counterpart. Run from the directory holding the shader folder.
+static bool benchmarkGpu(const std::string& name, const BenchmarkVolume& volume, const std::vector<float>& isoValues, int iterations)
+{
+	Volume view;
+	view.values = volume.values.data();
+	view.numPointsX = view.numPointsY = view.numPointsZ = volume.numPoints;
+	view.origin = glm::vec3(-1.0f);
+	view.spacing = glm::vec3(volume.spacing);
+	view.min = volume.min;
+	view.max = volume.max;
+
+	long long numCells = (long long)view.numCellsX() * view.numCellsY() * view.numCellsZ();
+
+	printf("%s GPU extractor (%zu iso values)\n", name.c_str(), isoValues.size());
+
+	GpuExtractor gpuExtractor(view);
+	if (!gpuExtractor.valid())
+	{
+		fprintf(stderr, "  GPU extraction is not available\n\n");
+		return false;
+	}
+
+	IsoSurfaceExtractor extractor(view);
+	std::vector<IsoSurface> surfaces;
+	double cpuBest = INFINITY;
+	double gpuBest = INFINITY;
+	for (int i = 0; i < iterations; i++)
+	{
+		auto cpuStart = std::chrono::high_resolution_clock::now();
+		extractor.extract(isoValues, surfaces);
+		std::chrono::duration<double> cpuElapsed = std::chrono::high_resolution_clock::now() - cpuStart;
+		cpuBest = fmin(cpuBest, cpuElapsed.count());
+
+		// The count of every surface is read back already, finishing waits for the triangles
+		auto gpuStart = std::chrono::high_resolution_clock::now();
+		bool extracted = gpuExtractor.extract(isoValues);
+		glFinish();
+		std::chrono::duration<double> gpuElapsed = std::chrono::high_resolution_clock::now() - gpuStart;
+		gpuBest = fmin(gpuBest, gpuElapsed.count());
+		if (!extracted)
+		{
+			printf("\n");
+			return false;
+		}
+	}
+
+	std::vector<IsoSurface> gpuSurfaces;
+	gpuExtractor.read(gpuSurfaces);
+
+	bool matches = true;
+	size_t numVertices = 0;
+	float maxDistance = 0.0f;
+	for (size_t i = 0; i < isoValues.size(); i++)
+	{
+		const std::vector<MeshVertexAttribute>& cpuVertices = surfaces[i].vertices;
+		const std::vector<MeshVertexAttribute>& gpuVertices = gpuSurfaces[i].vertices;
+		matches = matches && cpuVertices.size() == gpuVertices.size();
+		for (size_t v = 0; matches && v < cpuVertices.size(); v++)
+		{
+			maxDistance = fmax(maxDistance, glm::length(cpuVertices[v].position - gpuVertices[v].position));
+		}
+
+		numVertices += gpuVertices.size();
+	}
+
+	// A vertex may move by rounding only, far less than a cell
+	matches = matches && maxDistance < 1.0e-3f * volume.spacing;
+
+	record("gpu extractor", "cpu soup", name, numCells, volume.values.size() * sizeof(float), cpuBest);
+	record("gpu extractor", "compute", name, numCells, volume.values.size() * sizeof(float), gpuBest);
+	printf("  %-14s %9.2f ms %9.2f Mcells/s\n", "cpu soup", cpuBest * 1000.0, numCells / cpuBest / 1.0e6);
+	printf("  %-14s %9.2f ms %9.2f Mcells/s  %zu vertices, %s the CPU (%g apart at most)\n\n",
+		"compute",
+		gpuBest * 1000.0,
+		numCells / gpuBest / 1.0e6,
+		numVertices,
+		matches ? "matches" : "DIFFERS FROM",
+		maxDistance);
+
+	return matches;
+}
+
+// Writes the volume as bricks and extracts it through a brick cache of an eighth of its size
+static void benchmarkOutOfCore(const std::string& name, const BenchmarkVolume& volume, float isoValue, int iterations)
+{
+	int n = volume.numPoints;
+	int brickCells = std::max((n - 1) / OUT_OF_CORE_BRICKS_PER_AXIS, 4);
+	size_t sliceSize = (size_t)n * n;
+	std::string path = name + ".bricks";
+	auto readSlice = [&](int z, float* values)
+	{
+		memcpy(values, volume.values.data() + z * sliceSize, sliceSize * sizeof(float));
+		return true;
+	};
+
+	auto writeStart = std::chrono::high_resolution_clock::now();
+	if (!BrickedVolume::write(path, n, n, n, glm::vec3(-1.0f), glm::vec3(volume.spacing), readSlice, brickCells))
+	{
+		return;
+	}
+
+	std::chrono::duration<double> writeTime = std::chrono::high_resolution_clock::now() - writeStart;
+	size_t volumeBytes = volume.values.size() * sizeof(float);
+	size_t budget = volumeBytes / 8;
+	int numBricks = ((n - 2) / brickCells + 1) * ((n - 2) / brickCells + 1) * ((n - 2) / brickCells + 1);
+
+	printf("%s out-of-core extractor (%d bricks of %d^3 cells written in %.2f ms, cache budget %.2f of %.2f MB)\n",
+		name.c_str(),
+		numBricks,
+		brickCells,
+		writeTime.count() * 1000.0,
+		budget / (1024.0 * 1024.0),
+		volumeBytes / (1024.0 * 1024.0));
+
+	for (int indexed = 0; indexed < 2; indexed++)
+	{
+		double best = INFINITY;
+		size_t peak = 0;
+		size_t reads = 0;
+		IsoSurface surface;
+		for (int i = 0; i < iterations; i++)
+		{
+			// A cold cache every time, as for a volume that is only passed over once
+			BrickedVolume bricks(path, budget);
+			BrickedExtractor extractor(bricks);
+			extractor.setIndexed(indexed != 0);
+
+			auto start = std::chrono::high_resolution_clock::now();
+			extractor.extract(isoValue, surface);
+			std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+			best = fmin(best, elapsed.count());
+			peak = bricks.peakMemory();
+			reads = bricks.numReads();
+		}
+
+		long long numCells = (long long)(n - 1) * (n - 1) * (n - 1);
+		record("out-of-core extractor", indexed ? "indexed" : "soup", name, numCells, (double)volumeBytes, best);
+		printf("  %-14s %9.2f ms  %zu vertices %zu indices, %zu bricks read, cache peak %.2f MB\n",
+			indexed ? "indexed" : "soup",
+			best * 1000.0,
+			surface.vertices.size(),
+			surface.indices.size(),
+			reads,
+			peak / (1024.0 * 1024.0));
+	}
+
+	// Streamed straight to mesh files, the surface is never held as a whole
+	for (const char* extension : { ".ply", ".stl", ".obj" })
+	{
+		std::string meshPath = name + extension;
+		double best = INFINITY;
+		size_t bytes = 0;
+		for (int i = 0; i < iterations; i++)
+		{
+			BrickedVolume bricks(path, budget);
+			BrickedExtractor extractor(bricks);
+			extractor.setIndexed(true);
+
+			auto start = std::chrono::high_resolution_clock::now();
+			MeshWriter* writer = MeshWriter::create(meshPath);
+			if (writer == nullptr)
+			{
+				break;
+			}
+
+			extractor.extract(isoValue, *writer);
+			writer->close();
+			delete writer;
+			std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+			best = fmin(best, elapsed.count());
+
+			FILE* file = fopen(meshPath.c_str(), "rb");
+			if (file != nullptr)
+			{
+				fseek(file, 0, SEEK_END);
+				bytes = (size_t)ftell(file);
+				fclose(file);
+			}
+		}
+
+		record("mesh writer", extension + 1, name, (long long)(n - 1) * (n - 1) * (n - 1), (double)bytes, best);
+		printf("  %-14s %9.2f ms  %.2f MB written\n", extension, best * 1000.0, bytes / (1024.0 * 1024.0));
+		remove(meshPath.c_str());
+	}
+
+	remove(path.c_str());
+	printf("\n");
+}
+
+// Contour without a shader, only its marching squares are run
+class BenchmarkContour : public Contour
+{
+public:
+	BenchmarkContour(Grid2D& grid)
+		: Contour(grid, nullptr),
+		  m_color(0.0f, 0.0f, 1.0f, 1.0f) { }
+
+private:
+	glm::vec4& getColor(float isoValue, int corners[CORNERS_PER_CELL]) { return m_color; }
+
+	glm::vec4 m_color;
+};
+
+// Evaluates the function at every point of a CalculateGrid3D and resamples it on a slice. The slice lies
+// in the xy plane, any other plane moves the grid through its GL update.
+static void benchmarkGrids(const std::string& name, BenchmarkFunction function, int numPoints, int slicePoints, int iterations)
+{
+	long long numGridPoints = (long long)numPoints * numPoints * numPoints;
+	long long numSlicePoints = (long long)slicePoints * slicePoints;
+
+	double gridBest = INFINITY;
+	for (int i = 0; i < iterations; i++)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		CalculateGrid3D grid(function, numPoints, numPoints, numPoints, -1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f);
+		std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+		gridBest = fmin(gridBest, elapsed.count());
+	}
+
+	CalculateGrid3D grid(function, numPoints, numPoints, numPoints, -1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f);
+	Plane plane = { 0.0f, 0.0f, 1.0f, 0.0f };
+	double sliceBest = INFINITY;
+	for (int i = 0; i < iterations; i++)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		SliceGrid2D slice(grid, plane, slicePoints, slicePoints, -1.0f, -1.0f, 1.0f, 1.0f);
+		std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+		sliceBest = fmin(sliceBest, elapsed.count());
+	}
+
+	record("grid", "CalculateGrid3D", name, numGridPoints, numGridPoints * sizeof(float), gridBest);
+	record("grid", "SliceGrid2D", name, numSlicePoints, numSlicePoints * sizeof(float), sliceBest);
+
+	printf("%s grids\n", name.c_str());
+	printf("  %-14s %9.2f ms %9.2f Mpoints/s  %d^3 points\n", "calculate 3D", gridBest * 1000.0, numGridPoints / gridBest / 1.0e6, numPoints);
+	printf("  %-14s %9.2f ms %9.2f Mpoints/s  %d^2 points\n", "slice 2D", sliceBest * 1000.0, numSlicePoints / sliceBest / 1.0e6, slicePoints);
+	printf("\n");
+}
+
+// Marching squares of a contour and the triangulation of a height field surface over the same 2D grid
+static void benchmarkGrid2D(const std::string& name, Calculate2DFunction function, int numPoints, float isoValue, int iterations)
+{
+	CalculateGrid2D grid(function, numPoints, numPoints, -1.0f, -1.0f, 1.0f, 1.0f);
+	long long numCells = grid.numCells();
+	double bytes = (double)grid.numPoints() * sizeof(float);
+
+	BenchmarkContour contour(grid);
+	std::vector<ContourVertexAttribute> lines;
+	double contourBest = INFINITY;
+	for (int i = 0; i < iterations; i++)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		contour.marchingSquares(isoValue, lines);
+		std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+		contourBest = fmin(contourBest, elapsed.count());
+	}
+
+	Surface surface(grid);
+	std::vector<SurfaceVertexAttribute> triangles;
+	double surfaceBest = INFINITY;
+	for (int i = 0; i < iterations; i++)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		surface.triangulate(triangles);
+		std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+		surfaceBest = fmin(surfaceBest, elapsed.count());
+	}
+
+	record("marching squares", "Contour", name, numCells, bytes, contourBest);
+	record("triangulate", "Surface", name, numCells, bytes, surfaceBest);
+
+	printf("%s 2D grid (%d^2 points, iso %.3f)\n", name.c_str(), numPoints, isoValue);
+	printf("  %-14s %9.2f ms %9.2f Mcells/s  %zu vertices\n", "contour", contourBest * 1000.0, numCells / contourBest / 1.0e6, lines.size());
+	printf("  %-14s %9.2f ms %9.2f Mcells/s  %zu vertices\n", "surface", surfaceBest * 1000.0, numCells / surfaceBest / 1.0e6, triangles.size());
+	printf("\n");
+}
+
+// Writes the volume as a DDS compressed 16 bit PVM file, reads it back and quantizes it to 8 bits
+static void benchmarkVolumeFiles(const std::string& name, const BenchmarkVolume& volume, int iterations)
+{
+	// Most significant byte first, as quantize expects it
+	size_t numPoints = volume.values.size();
+	std::vector<unsigned char> data(2 * numPoints);
+	for (size_t i = 0; i < numPoints; i++)
+	{
+		float norm = (volume.values[i] - volume.min) / (volume.max - volume.min);
+		unsigned int value = (unsigned int)(fmin(fmax(norm, 0.0f), 1.0f) * 65535.0f);
+		data[2 * i] = (unsigned char)(value >> 8);
+		data[2 * i + 1] = (unsigned char)(value & 0xff);
+	}
+
+	std::string path = name + ".pvm";
+	int n = volume.numPoints;
+	double bytes = (double)data.size();
+
+	double writeBest = INFINITY;
+	for (int i = 0; i < iterations; i++)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		writePVMvolume(path.c_str(), data.data(), n, n, n, 2);
+		std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+		writeBest = fmin(writeBest, elapsed.count());
+	}
+
+	double readBest = INFINITY;
+	for (int i = 0; i < iterations; i++)
+	{
+		unsigned int width;
+		unsigned int height;
+		unsigned int depth;
+		unsigned int components;
+
+		auto start = std::chrono::high_resolution_clock::now();
+		unsigned char* read = readPVMvolume(path.c_str(), &width, &height, &depth, &components);
+		std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+		readBest = fmin(readBest, elapsed.count());
+		free(read);
+	}
+
+	size_t fileBytes = 0;
+	FILE* file = fopen(path.c_str(), "rb");
+	if (file != nullptr)
+	{
+		fseek(file, 0, SEEK_END);
+		fileBytes = (size_t)ftell(file);
+		fclose(file);
+	}
+
+	remove(path.c_str());
+
+	double quantizeBest[2] = { INFINITY, INFINITY };
+	for (int linear = 0; linear < 2; linear++)
+	{
+		for (int i = 0; i < iterations; i++)
+		{
+			auto start = std::chrono::high_resolution_clock::now();
+			unsigned char* quantized = quantize(data.data(), n, n, n, TRUE, linear != 0, TRUE);
+			std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+			quantizeBest[linear] = fmin(quantizeBest[linear], elapsed.count());
+			free(quantized);
+		}
+	}
+
+	record("volume file", "writePVMvolume", name, (long long)numPoints, bytes, writeBest);
+	record("volume file", "readPVMvolume", name, (long long)numPoints, bytes, readBest);
+	record("quantize", "nonlinear", name, (long long)numPoints, bytes, quantizeBest[0]);
+	record("quantize", "linear", name, (long long)numPoints, bytes, quantizeBest[1]);
+
+	printf("%s volume file (16 bit, %.2f MB, %.2f MB compressed)\n", name.c_str(), bytes / (1024.0 * 1024.0), fileBytes / (1024.0 * 1024.0));
+	printf("  %-14s %9.2f ms %9.2f MB/s\n", "write PVM", writeBest * 1000.0, bytes / writeBest / (1024.0 * 1024.0));
+	printf("  %-14s %9.2f ms %9.2f MB/s\n", "read PVM", readBest * 1000.0, bytes / readBest / (1024.0 * 1024.0));
+	printf("  %-14s %9.2f ms %9.2f MB/s\n", "quantize", quantizeBest[0] * 1000.0, bytes / quantizeBest[0] / (1024.0 * 1024.0));
+	printf("  %-14s %9.2f ms %9.2f MB/s\n", "quantize lin", quantizeBest[1] * 1000.0, bytes / quantizeBest[1] / (1024.0 * 1024.0));
+	printf("\n");
+}
+
+static bool writeReport(const std::string& path, int numPoints, int iterations)
+{
+	FILE* file = fopen(path.c_str(), "w");
+	if (file == nullptr)
+	{
+		fprintf(stderr, "Failed to write benchmark report %s\n", path.c_str());
+		return false;
+	}
+
+	fprintf(file, "{\n");
+	fprintf(file, "  \"points\": %d,\n", numPoints);
+	fprintf(file, "  \"iterations\": %d,\n", iterations);
+	fprintf(file, "  \"threads\": %d,\n", ThreadPool::instance().numThreads());
+	fprintf(file, "  \"results\": [\n");
+	for (size_t i = 0; i < s_results.size(); i++)
+	{
+		const BenchmarkResult& result = s_results[i];
+		fprintf(file, "    { \"benchmark\": \"%s\", \"variant\": \"%s\", \"dataset\": \"%s\", \"cells\": %lld, \"bytes\": %.0f, \"seconds\": %.9f, \"cells_per_second\": %.1f, \"bytes_per_second\": %.1f }%s\n",
+			result.benchmark.c_str(),
+			result.variant.c_str(),
+			result.dataset.c_str(),
+			result.cells,
+			result.bytes,
+			result.seconds,
+			result.cells / result.seconds,
+			result.bytes / result.seconds,
+			(i + 1 < s_results.size()) ? "," : "");
+	}
+
+	fprintf(file, "  ]\n}\n");
+	fclose(file);
+
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	// benchmark [points per axis] [iterations] [--json report] [--gpu]
+	int numPoints = 128;
+	int iterations = 5;
+	std::string reportPath;
+	bool gpu = false;
+	int positional = 0;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--json") == 0 && i + 1 < argc)
+		{
+			reportPath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--gpu") == 0)
+		{
+			gpu = true;
+		}
+		else if (positional++ == 0)
+		{
+			numPoints = atoi(argv[i]);
+		}
+		else
+		{
+			iterations = atoi(argv[i]);
+		}
+	}
+
+	int gridPoints = numPoints * GRID_2D_POINTS_SCALE;
+
+	// Fails the run when the extractors disagree or the GPU extraction is missing or differs from the CPU
+	bool agree = true;
+
+	BenchmarkVolume radiusVolume = createVolume(radius, numPoints);
+	agree = checkAgreement("radius", radiusVolume, { 0.3f, 0.5f, 0.7f }) && agree;
+	benchmarkGrids("radius", radius, numPoints, gridPoints, iterations);
+	benchmarkGrid2D("radius", radius2D, gridPoints, 0.5f, iterations);
+	benchmarkKernels("radius", radiusVolume, 0.5f, iterations);
+	benchmarkClassifier("radius", radiusVolume, 0.5f, iterations);
+	benchmarkExtractor("radius", radiusVolume, 0.5f, iterations);
+	benchmarkMultiIso("radius", radiusVolume, { 0.3f, 0.5f, 0.7f }, iterations);
+	benchmarkOutOfCore("radius", radiusVolume, 0.5f, iterations);
+	benchmarkVolumeFiles("radius", radiusVolume, iterations);
+
+	BenchmarkVolume sincVolume = createVolume(sinc, numPoints);
+	agree = checkAgreement("sinc", sincVolume, { 0.1f, 0.3f, 0.5f }) && agree;
+	benchmarkGrids("sinc", sinc, numPoints, gridPoints, iterations);
+	benchmarkGrid2D("sinc", sinc2D, gridPoints, 0.5f, iterations);
+	benchmarkKernels("sinc", sincVolume, 0.5f, iterations);
+	benchmarkClassifier("sinc", sincVolume, 0.5f, iterations);
+	benchmarkExtractor("sinc", sincVolume, 0.5f, iterations);
+	benchmarkMultiIso("sinc", sincVolume, { 0.1f, 0.3f, 0.5f }, iterations);
+	benchmarkOutOfCore("sinc", sincVolume, 0.5f, iterations);
+	benchmarkVolumeFiles("sinc", sincVolume, iterations);
+
+	if (gpu)
+	{
+		GLFWwindow* window = createContext();
+		agree = window != nullptr && agree;
+		if (window != nullptr)
+		{
+			agree = benchmarkGpu("radius", radiusVolume, { 0.3f, 0.5f, 0.7f }, iterations) && agree;
+			agree = benchmarkGpu("sinc", sincVolume, { 0.1f, 0.3f, 0.5f }, iterations) && agree;
+			glfwDestroyWindow(window);
+			glfwTerminate();
+		}
+	}
+
+	if (!reportPath.empty() && !writeReport(reportPath, numPoints, iterations))
+	{
+		return 1;
+	}
+
+	return agree ? 0 : 1;
+}
@@ -0,0 +1,489 @@
+#include <bricked_extractor.h>
+#include <extractor_check.h>
+#include <isosurface_extractor.h>
+#include <mesh_writer.h>
+#include <minmax_octree.h>
+#include <thread_pool.h>
+#include <volume_file.h>
+#include <cctype>
+#include <cmath>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Extracts isosurfaces from a volume file and writes them as mesh files, without a window or GL context.
+// Every iso value gets its own file, <prefix>_<iso value>.<format>, and the timings of every step are
+// written to <prefix>_stats.json. Brick files stream every surface into its file as it is extracted, so
+// their write times include the extraction.
+
+struct ExtractOptions
+{
+	std::string volumePath;
+	std::vector<float> isoValues;
+	std::string prefix;
+	std::string format;
+	IsoSurfaceMethod method;
+	bool indexed;
+	int numThreads;
+	int numPoints[3];		// Of a volume without a header, 0 for a PVM volume
+	unsigned int components;
+	glm::vec3 spacing;
+	size_t cacheBytes;		// Of the brick cache when extracting a brick file
+	std::string brickPath;	// Converts a PVM volume into a brick file there instead of extracting
+};
+
+struct SurfaceStats
+{
+	float isoValue;
+	std::string path;
+	size_t numVertices;
+	size_t numTriangles;
+	double writeSeconds;
+	size_t bytes;
+};
+
+static double secondsSince(const std::chrono::high_resolution_clock::time_point& start)
+{
+	std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+	return elapsed.count();
+}
+
+static size_t fileSize(const std::string& path)
+{
+	FILE* file = fopen(path.c_str(), "rb");
+	if (file == nullptr)
+	{
+		return 0;
+	}
+
+	fseek(file, 0, SEEK_END);
+	size_t size = (size_t)ftell(file);
+	fclose(file);
+
+	return size;
+}
+
+static bool endsWith(const std::string& text, const std::string& suffix)
+{
+	return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+static void printUsage()
+{
+	fprintf(stderr,
+		"usage: extract <volume> <iso value>... [options]\n"
+		"       extract <volume> -w <brick file>\n"
+		"       extract --verify [points per axis]\n"
+		"  <volume>          PVM volume, DDS compressed or not, a headerless volume with -d or a .bricks file\n"
+		"  -o <prefix>       output paths start with prefix, the volume path without extension by default\n"
+		"  -f ply|stl|obj    mesh file format, ply by default\n"
+		"  -m mc|nets|fe|adaptive\n"
+		"                    marching cubes, surface nets, flying edges or adaptive marching cubes, mc by default\n"
+		"  -i                weld shared vertices\n"
+		"  -t <threads>      worker threads, every core by default\n"
+		"  -d <x> <y> <z>    points of a volume without a header\n"
+		"  -c <bytes>        bytes per value of a volume without a header, 1 by default\n"
+		"  -s <x> <y> <z>    spacing of a volume without a header, 1 by default\n"
+		"  -b <megabytes>    brick cache budget for a .bricks volume, 256 by default\n"
+		"  -w <brick file>   convert a PVM volume into a .bricks file for out-of-core extraction\n"
+		"  --verify          check that the extractors agree on a synthetic volume, 64 points per axis by default\n");
+}
+
+static bool parseOptions(int argc, char** argv, ExtractOptions& options)
+{
+	options.format = "ply";
+	options.method = ISOSURFACE_MARCHING_CUBES;
+	options.indexed = false;
+	options.numThreads = 0;
+	options.numPoints[0] = options.numPoints[1] = options.numPoints[2] = 0;
+	options.components = 1;
+	options.spacing = glm::vec3(1.0f);
+	options.cacheBytes = BRICK_CACHE_MEMORY_BUDGET;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		int remaining = argc - i - 1;
+		if (arg == "-o" && remaining >= 1)
+		{
+			options.prefix = argv[++i];
+		}
+		else if (arg == "-f" && remaining >= 1)
+		{
+			options.format = argv[++i];
+		}
+		else if (arg == "-m" && remaining >= 1)
+		{
+			std::string method = argv[++i];
+			if (method == "mc")
+			{
+				options.method = ISOSURFACE_MARCHING_CUBES;
+			}
+			else if (method == "nets")
+			{
+				options.method = ISOSURFACE_SURFACE_NETS;
+			}
+			else if (method == "fe")
+			{
+				options.method = ISOSURFACE_FLYING_EDGES;
+			}
+			else if (method == "adaptive")
+			{
+				options.method = ISOSURFACE_ADAPTIVE;
+			}
+			else
+			{
+				fprintf(stderr, "Unknown extraction method %s\n", method.c_str());
+				return false;
+			}
+		}
+		else if (arg == "-i")
+		{
+			options.indexed = true;
+		}
+		else if (arg == "-t" && remaining >= 1)
+		{
+			options.numThreads = atoi(argv[++i]);
+		}
+		else if (arg == "-d" && remaining >= 3)
+		{
+			for (int axis = 0; axis < 3; axis++)
+			{
+				options.numPoints[axis] = atoi(argv[++i]);
+			}
+		}
+		else if (arg == "-c" && remaining >= 1)
+		{
+			options.components = (unsigned int)atoi(argv[++i]);
+		}
+		else if (arg == "-s" && remaining >= 3)
+		{
+			for (int axis = 0; axis < 3; axis++)
+			{
+				options.spacing[axis] = (float)atof(argv[++i]);
+			}
+		}
+		else if (arg == "-b" && remaining >= 1)
+		{
+			options.cacheBytes = (size_t)atoi(argv[++i]) << 20;
+		}
+		else if (arg == "-w" && remaining >= 1)
+		{
+			options.brickPath = argv[++i];
+		}
+		else if (arg[0] == '-' && !(arg.size() > 1 && (isdigit(arg[1]) || arg[1] == '.')))
+		{
+			fprintf(stderr, "Unknown option %s\n", arg.c_str());
+			return false;
+		}
+		else if (options.volumePath.empty())
+		{
+			options.volumePath = arg;
+		}
+		else
+		{
+			options.isoValues.push_back((float)atof(arg.c_str()));
+		}
+	}
+
+	if (options.volumePath.empty() || (options.isoValues.empty() && options.brickPath.empty()))
+	{
+		return false;
+	}
+
+	if (options.format != "ply" && options.format != "stl" && options.format != "obj")
+	{
+		fprintf(stderr, "Unknown mesh file format %s\n", options.format.c_str());
+		return false;
+	}
+
+	if (options.prefix.empty())
+	{
+		size_t dot = options.volumePath.rfind('.');
+		size_t slash = options.volumePath.find_last_of("/\\");
+		bool hasExtension = dot != std::string::npos && (slash == std::string::npos || dot > slash);
+		options.prefix = hasExtension ? options.volumePath.substr(0, dot) : options.volumePath;
+	}
+
+	return true;
+}
+
+static std::string meshPath(const ExtractOptions& options, float isoValue)
+{
+	char name[32];
+	snprintf(name, sizeof(name), "_%g.", isoValue);
+
+	return options.prefix + name + options.format;
+}
+
+// Writes a whole surface, the surfaces of the sweep are only held until they are written
+static bool writeSurface(const IsoSurface& surface, SurfaceStats& stats)
+{
+	stats.numVertices = 0;
+	stats.numTriangles = 0;
+	stats.writeSeconds = 0.0;
+	stats.bytes = 0;
+
+	auto start = std::chrono::high_resolution_clock::now();
+	MeshWriter* writer = MeshWriter::create(stats.path);
+	if (writer == nullptr)
+	{
+		return false;
+	}
+
+	bool written = writer->write(surface) && writer->close();
+	stats.numVertices = writer->numVertices();
+	stats.numTriangles = writer->numTriangles();
+	delete writer;
+
+	stats.writeSeconds = secondsSince(start);
+	stats.bytes = fileSize(stats.path);
+
+	return written;
+}
+
+static bool extractVolume(const ExtractOptions& options, ThreadPool& pool, double& loadSeconds, double& extractSeconds, std::vector<SurfaceStats>& surfaces)
+{
+	auto loadStart = std::chrono::high_resolution_clock::now();
+	VolumeFile* file = (options.numPoints[0] > 0) ?
+		new VolumeFile(options.volumePath, options.numPoints[0], options.numPoints[1], options.numPoints[2], options.components, options.spacing) :
+		new VolumeFile(options.volumePath);
+	if (!file->valid())
+	{
+		delete file;
+		return false;
+	}
+
+	// The octree is built once and rules out empty blocks for every iso value
+	MinMaxOctree octree(file->volume(), pool);
+	loadSeconds = secondsSince(loadStart);
+
+	const Volume& volume = file->volume();
+	printf("%s: %dx%dx%d points, values %g to %g, read in %.2f ms\n",
+		options.volumePath.c_str(),
+		volume.numPointsX,
+		volume.numPointsY,
+		volume.numPointsZ,
+		volume.min,
+		volume.max,
+		loadSeconds * 1000.0);
+
+	IsoSurfaceExtractor extractor(volume, pool);
+	extractor.setIndexed(options.indexed);
+	extractor.setMethod(options.method);
+	extractor.setMinMaxOctree(&octree);
+
+	// All iso values in a single sweep, each cell is classified once for all of them
+	auto extractStart = std::chrono::high_resolution_clock::now();
+	std::vector<IsoSurface> extracted;
+	extractor.extract(options.isoValues, extracted);
+	extractSeconds = secondsSince(extractStart);
+
+	bool written = true;
+	for (size_t i = 0; i < options.isoValues.size(); i++)
+	{
+		SurfaceStats stats;
+		stats.isoValue = options.isoValues[i];
+		stats.path = meshPath(options, stats.isoValue);
+
+		written = writeSurface(extracted[i], stats) && written;
+		IsoSurface().vertices.swap(extracted[i].vertices);
+		IsoSurface().indices.swap(extracted[i].indices);
+		surfaces.push_back(stats);
+	}
+
+	delete file;
+
+	return written;
+}
+
+// Brick files are extracted one brick at a time and streamed to the mesh files, one pass per iso value
+static bool extractBricks(const ExtractOptions& options, ThreadPool& pool, double& loadSeconds, double& extractSeconds, std::vector<SurfaceStats>& surfaces)
+{
+	auto loadStart = std::chrono::high_resolution_clock::now();
+	BrickedVolume volume(options.volumePath, options.cacheBytes);
+	if (!volume.valid())
+	{
+		return false;
+	}
+
+	loadSeconds = secondsSince(loadStart);
+	printf("%s: %dx%dx%d points in %d bricks, values %g to %g\n",
+		options.volumePath.c_str(),
+		volume.numPointsX(),
+		volume.numPointsY(),
+		volume.numPointsZ(),
+		volume.numBricks().x * volume.numBricks().y * volume.numBricks().z,
+		volume.min(),
+		volume.max());
+
+	BrickedExtractor extractor(volume, pool);
+	extractor.setIndexed(options.indexed);
+	extractor.setMethod(options.method);
+
+	bool written = true;
+	extractSeconds = 0.0;
+	for (float isoValue : options.isoValues)
+	{
+		SurfaceStats stats;
+		stats.isoValue = isoValue;
+		stats.path = meshPath(options, isoValue);
+
+		auto start = std::chrono::high_resolution_clock::now();
+		MeshWriter* writer = MeshWriter::create(stats.path);
+		if (writer == nullptr)
+		{
+			return false;
+		}
+
+		written = extractor.extract(isoValue, *writer) && writer->close() && written;
+		stats.writeSeconds = secondsSince(start);
+		extractSeconds += stats.writeSeconds;
+		stats.numVertices = writer->numVertices();
+		stats.numTriangles = writer->numTriangles();
+		stats.bytes = fileSize(stats.path);
+		delete writer;
+
+		surfaces.push_back(stats);
+	}
+
+	return written;
+}
+
+// Checks the extractors against each other on the distances from the centre of a cube, whose spheres cut
+// cells at every angle
+static bool verifyExtractors(int numPoints)
+{
+	std::vector<float> values((size_t)numPoints * numPoints * numPoints);
+	Volume volume;
+	volume.values = values.data();
+	volume.numPointsX = volume.numPointsY = volume.numPointsZ = numPoints;
+	volume.origin = glm::vec3(-1.0f);
+	volume.spacing = glm::vec3(2.0f / (numPoints - 1));
+	for (int z = 0; z < numPoints; z++)
+	{
+		for (int y = 0; y < numPoints; y++)
+		{
+			for (int x = 0; x < numPoints; x++)
+			{
+				values[volume.index(x, y, z)] = glm::length(volume.point(x, y, z));
+			}
+		}
+	}
+
+	volume.min = 0.0f;
+	volume.max = sqrtf(3.0f);
+
+	bool agree = true;
+	for (float isoValue : { 0.3f, 0.5f, 0.7f, 1.2f })
+	{
+		bool checked = checkExtractors(volume, isoValue, "verify.bricks");
+		printf("  %-10g %s\n", isoValue, checked ? "extractors agree" : "extractors DISAGREE");
+		agree = checked && agree;
+	}
+
+	return agree;
+}
+
+static bool writeStats(const ExtractOptions& options, int numThreads, double loadSeconds, double extractSeconds, double totalSeconds, const std::vector<SurfaceStats>& surfaces)
+{
+	std::string path = options.prefix + "_stats.json";
+	FILE* file = fopen(path.c_str(), "w");
+	if (file == nullptr)
+	{
+		fprintf(stderr, "Failed to write %s\n", path.c_str());
+		return false;
+	}
+
+	const char* methods[] = { "marching cubes", "surface nets", "flying edges", "adaptive marching cubes" };
+	fprintf(file, "{\n");
+	fprintf(file, "  \"volume\": \"%s\",\n", options.volumePath.c_str());
+	fprintf(file, "  \"method\": \"%s\",\n", methods[options.method]);
+	fprintf(file, "  \"indexed\": %s,\n", options.indexed ? "true" : "false");
+	fprintf(file, "  \"threads\": %d,\n", numThreads);
+	fprintf(file, "  \"load_ms\": %.3f,\n", loadSeconds * 1000.0);
+	fprintf(file, "  \"extract_ms\": %.3f,\n", extractSeconds * 1000.0);
+	fprintf(file, "  \"total_ms\": %.3f,\n", totalSeconds * 1000.0);
+	fprintf(file, "  \"surfaces\": [\n");
+	for (size_t i = 0; i < surfaces.size(); i++)
+	{
+		const SurfaceStats& stats = surfaces[i];
+		fprintf(file, "    { \"iso_value\": %g, \"path\": \"%s\", \"vertices\": %zu, \"triangles\": %zu, \"write_ms\": %.3f, \"bytes\": %zu }%s\n",
+			stats.isoValue,
+			stats.path.c_str(),
+			stats.numVertices,
+			stats.numTriangles,
+			stats.writeSeconds * 1000.0,
+			stats.bytes,
+			(i + 1 < surfaces.size()) ? "," : "");
+	}
+
+	fprintf(file, "  ]\n}\n");
+	fclose(file);
+
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc >= 2 && strcmp(argv[1], "--verify") == 0)
+	{
+		int numPoints = (argc >= 3) ? atoi(argv[2]) : 64;
+		if (numPoints < 2)
+		{
+			printUsage();
+			return 1;
+		}
+
+		return verifyExtractors(numPoints) ? 0 : 1;
+	}
+
+	ExtractOptions options;
+	if (!parseOptions(argc, argv, options))
+	{
+		printUsage();
+		return 1;
+	}
+
+	if (!options.brickPath.empty())
+	{
+		return VolumeFile::writeBricks(options.volumePath, options.brickPath) ? 0 : 1;
+	}
+
+	// The shared pool already has a worker per core
+	ThreadPool* ownPool = (options.numThreads > 0) ? new ThreadPool(options.numThreads) : nullptr;
+	ThreadPool& pool = (ownPool != nullptr) ? *ownPool : ThreadPool::instance();
+
+	auto start = std::chrono::high_resolution_clock::now();
+	double loadSeconds = 0.0;
+	double extractSeconds = 0.0;
+	std::vector<SurfaceStats> surfaces;
+	bool extracted = endsWith(options.volumePath, ".bricks") ?
+		extractBricks(options, pool, loadSeconds, extractSeconds, surfaces) :
+		extractVolume(options, pool, loadSeconds, extractSeconds, surfaces);
+	double totalSeconds = secondsSince(start);
+
+	for (const SurfaceStats& stats : surfaces)
+	{
+		printf("  %-10g %10zu vertices %10zu triangles, written in %9.2f ms  %s\n",
+			stats.isoValue,
+			stats.numVertices,
+			stats.numTriangles,
+			stats.writeSeconds * 1000.0,
+			stats.path.c_str());
+	}
+
+	printf("%zu surfaces on %d threads, extracted in %.2f ms, %.2f ms in total\n",
+		surfaces.size(),
+		pool.numThreads(),
+		extractSeconds * 1000.0,
+		totalSeconds * 1000.0);
+	bool written = writeStats(options, pool.numThreads(), loadSeconds, extractSeconds, totalSeconds, surfaces);
+
+	delete ownPool;
+
+	return (extracted && written) ? 0 : 1;
+}
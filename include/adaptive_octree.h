@@ -0,0 +1,111 @@
+#pragma once
+#include <atomic>
+#include <unordered_map>
+#include <vector>
+#include <glm.hpp>
+#include <isosurface_extractor.h>
+#include <minmax_octree.h>
+#include <thread_pool.h>
+#include <volume.h>
+
+// Default distance in cells the field of a leaf may stray from the trilinear interpolation of its corners
+#define ADAPTIVE_ERROR_TOLERANCE 0.25f
+
+// Default angle in degrees the gradients at the corners of a leaf may spread around their mean
+#define ADAPTIVE_NORMAL_ANGLE 30.0f
+
+// Octree over the cells of a volume refined only where the surface of one iso value passes through and the
+// field is far from trilinear or the surface curves, so flat and slowly varying regions are polygonised with a
+// few large cells. Leaves sharing a face or an edge differ by one level at most. Points on the boundary of a
+// coarser leaf take the values interpolated from its corners, so the smaller leaves meet its edges exactly where
+// it does, and the cracks left in the faces between a coarse leaf and the four finer ones beside it are closed
+// with transition polygons between its contour and theirs.
+class AdaptiveOctree
+{
+public:
+	// ranges has to match the volume and outlive the octree
+	AdaptiveOctree(const Volume& volume, const MinMaxOctree& ranges, ThreadPool& pool = ThreadPool::instance());
+
+	void setErrorTolerance(float cells) { m_errorTolerance = cells; }
+	void setMaxNormalAngle(float degrees) { m_maxNormalAngle = degrees; }
+
+	// Refines the octree for the surface at isoValue and balances it, returns false when cancelled
+	bool build(float isoValue, const std::atomic<bool>* cancel = nullptr);
+
+	// Polygonises the leaves into welded vertices and indices, normals from the field gradient
+	void extract(IsoSurface& surface);
+
+	size_t numLeaves() const { return m_numLeaves; }
+	size_t numTransitionTriangles() const { return m_numTransitionTriangles; }
+	size_t memory() const;
+
+private:
+	enum NodeState
+	{
+		NODE_OUTSIDE,
+		NODE_LEAF,
+		NODE_SPLIT
+	};
+
+	struct Node
+	{
+		glm::ivec3 origin;	// First cell
+		int size;			// Cells per side, before clipping to the volume
+		int children;		// First of eight consecutive children, -1 for leaves
+		int state;
+	};
+
+	// Value a point takes in the leaves around it. Points inside an edge of a coarser leaf keep that edge, the
+	// vertices of every leaf edge lying along it are interpolated over the whole edge so they come out the same.
+	struct PointValue
+	{
+		float value;
+		int axis;			// Of the edge the point lies inside, -1 for none
+		uint32_t edgeBegin;
+		uint32_t edgeEnd;
+	};
+
+	// Triangles of a leaf in the index buffer
+	struct LeafOutput
+	{
+		int node;
+		int code;
+		uint32_t firstIndex;
+	};
+
+	int classify(const Node& node, bool refine) const;
+	bool needsRefinement(const Node& node) const;
+	ValueRange range(const Node& node) const;
+	void split(int node);
+	void splitLeaf(int node, std::vector<int>& leaves);
+	void balance();
+	int locate(const glm::ivec3& cell) const;
+
+	// Past the last cell for the nodes clipped by the far faces of the volume
+	glm::ivec3 end(const Node& node) const
+	{
+		return glm::min(node.origin + glm::ivec3(node.size), glm::ivec3(m_volume.numCellsX(), m_volume.numCellsY(), m_volume.numCellsZ()));
+	}
+
+	bool hasCoarserNeighbour(const Node& node) const;
+
+	uint32_t pointIndex(const glm::ivec3& p) const { return (uint32_t)(p.x + m_volume.numPointsX * (p.y + m_volume.numPointsY * p.z)); }
+	glm::ivec3 point(uint32_t index) const;
+	const PointValue& pointValue(const glm::ivec3& p);
+	uint32_t edgeVertex(glm::ivec3 p1, glm::ivec3 p2, float value1, float value2, int axis, const PointValue* point1, const PointValue* point2, IsoSurface& surface);
+	void faceSegments(const LeafOutput& leaf, int face, const IsoSurface& surface, std::vector<std::pair<uint32_t, uint32_t>>& segments) const;
+	void closeCrack(const std::vector<std::pair<uint32_t, uint32_t>>& segments, IsoSurface& surface);
+
+	float 					m_colorNorm;
+	float 					m_errorTolerance;
+	float 					m_isoValue;
+	float 					m_maxNormalAngle;
+	std::vector<Node> 		m_nodes;
+	size_t 					m_numLeaves;
+	size_t 					m_numTransitionTriangles;
+	ThreadPool& 			m_pool;
+	std::unordered_map<uint32_t, PointValue> m_pointValues;
+	const MinMaxOctree& 	m_ranges;
+	std::unordered_map<uint64_t, uint32_t> m_vertices;	// Welded by the points of their edge
+	Volume 					m_volume;
+};
@@ -0,0 +1,30 @@
+#pragma once
+#include <unordered_map>
+#include <vector>
+#include <glm.hpp>
+#include <isosurface_extractor.h>
+#include <volume.h>
+
+// Joins the welded surfaces of bricks extracted on their own into one surface. Vertices on the faces a brick
+// shares with others are merged by the grid edge they lie on, or by the grid point when they sit on one, their
+// positions may differ in the last bits as every brick has its own origin. One welder per surface.
+class BrickWelder
+{
+public:
+	// numPoints of the whole volume the bricks are cut out of
+	BrickWelder(const glm::ivec3& numPoints);
+
+	// Fills chunk with the vertices of a brick surface no earlier brick emitted and its indices into all the
+	// vertices emitted so far. brick is the volume the surface was extracted from, starting at firstPoint.
+	void weld(const IsoSurface& brickSurface, const Volume& brick, const glm::ivec3& firstPoint, IsoSurface& chunk);
+
+	size_t numVertices() const { return m_numVertices; }
+
+private:
+	uint64_t edgeKey(const glm::vec3& point) const;
+
+	glm::ivec3 				m_numPoints;
+	size_t 					m_numVertices;
+	std::vector<uint32_t> 	m_remap;
+	std::unordered_map<uint64_t, uint32_t> m_welded;
+};
@@ -0,0 +1,52 @@
+#pragma once
+#include <atomic>
+#include <functional>
+#include <vector>
+#include <bricked_volume.h>
+#include <isosurface_extractor.h>
+#include <mesh_writer.h>
+#include <thread_pool.h>
+
+// Extracts isosurfaces from a bricked volume one brick at a time, so only the bricks in the cache are ever
+// in memory. Bricks whose value range misses every iso value are skipped without being read. Each brick
+// is extracted in parallel by an IsoSurfaceExtractor and its surface appended to the whole one, welded
+// vertices on the faces shared with other bricks are merged again by the grid edge they lie on.
+// Marching cubes and flying edges only, surface nets and adaptive octrees join cells across brick faces
+// and are extracted as marching cubes.
+class BrickedExtractor
+{
+public:
+	BrickedExtractor(BrickedVolume& volume, ThreadPool& pool = ThreadPool::instance());
+
+	// Returns false when the extraction was cancelled or a brick could not be read
+	bool extract(float isoValue, IsoSurface& surface);
+	bool extract(const std::vector<float>& isoValues, std::vector<IsoSurface>& surfaces);
+
+	// Streams the surface to a writer brick by brick instead, only the welded vertices on shared brick faces are
+	// remembered. Writers that keep no shared vertices get triangle soups. The writer is left open.
+	bool extract(float isoValue, MeshWriter& writer);
+
+	void setIndexed(bool enable) { m_indexed = enable; }
+	void setMethod(IsoSurfaceMethod method) { m_method = method; }
+	void setCancelFlag(const std::atomic<bool>* cancel) { m_cancel = cancel; }
+
+	// Fraction of the bricks to extract that are done, safe to poll from other threads
+	float progress() const;
+
+private:
+	// Receives the surface of one brick for iso value level, its vertices are the ones no earlier brick emitted
+	// and its indices count all vertices emitted for the level so far
+	typedef std::function<bool(size_t level, const IsoSurface& chunk)> ChunkFunction;
+
+	bool extractBricks(const std::vector<float>& isoValues, bool indexed, ChunkFunction emit);
+
+	bool cancelled() const { return m_cancel != nullptr && *m_cancel; }
+
+	std::atomic<int> 		m_bricksDone;
+	std::atomic<int> 		m_bricksTotal;
+	const std::atomic<bool>* m_cancel;
+	bool 					m_indexed;
+	IsoSurfaceMethod 		m_method;
+	ThreadPool& 			m_pool;
+	BrickedVolume& 			m_volume;
+};
@@ -0,0 +1,129 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <glm.hpp>
+#include <volume.h>
+
+// Cells along each axis of a brick
+#define BRICK_CELLS 64
+
+// Points stored around every brick for the gradients on its faces, central differences need one
+#define BRICK_GHOST_POINTS 1
+
+#define BRICK_CACHE_MEMORY_BUDGET (256u << 20)
+
+// One brick paged in from the file, volume views its points with the ghost points around them
+struct Brick
+{
+	std::vector<float> values;
+	Volume volume;
+	glm::ivec3 firstPoint;	// Of the brick in the whole volume
+};
+
+// A volume stored as bricks in a file and paged in through a cache bounded by a byte budget, for volumes
+// that do not fit into memory as floats. Neighbouring bricks share the point layer on their common face,
+// so every cell belongs to exactly one brick, and keep BRICK_GHOST_POINTS more layers around that for the
+// gradients. The value range of every brick is kept in memory to skip bricks without loading them.
+// Safe to share between threads.
+class BrickedVolume
+{
+public:
+	// Fills values with the point layer z of the volume, x varies fastest
+	typedef std::function<bool(int z, float* values)> SliceFunction;
+
+	// Writes a volume brick file slice by slice, holding only the slices of one layer of bricks at a time
+	static bool write(
+		const std::string& path,
+		int numPointsX,
+		int numPointsY,
+		int numPointsZ,
+		const glm::vec3& origin,
+		const glm::vec3& spacing,
+		SliceFunction readSlice,
+		int brickCells = BRICK_CELLS);
+
+	BrickedVolume(const std::string& path, size_t memoryBudget = BRICK_CACHE_MEMORY_BUDGET);
+	~BrickedVolume();
+
+	// False when the file could not be opened or is not a volume brick file
+	bool valid() const { return m_file != nullptr; }
+
+	int numPointsX() const { return m_numPoints.x; }
+	int numPointsY() const { return m_numPoints.y; }
+	int numPointsZ() const { return m_numPoints.z; }
+	const glm::vec3& origin() const { return m_origin; }
+	const glm::vec3& spacing() const { return m_spacing; }
+	float min() const { return m_min; }
+	float max() const { return m_max; }
+
+	int brickCells() const { return m_brickCells; }
+	const glm::ivec3& numBricks() const { return m_numBricks; }
+	int brickIndex(int x, int y, int z) const { return x + m_numBricks.x * (y + m_numBricks.y * z); }
+
+	// Value range of the points of a brick without its ghost points
+	float brickMin(int brick) const { return m_bricks[brick].min; }
+	float brickMax(int brick) const { return m_bricks[brick].max; }
+
+	// Returns the brick from the cache or reads it from the file, nullptr when reading fails. Least recently
+	// used bricks are dropped from the cache to stay in the budget, though the brick just read is always kept,
+	// and bricks still held by a caller stay alive until released. The budget can be exceeded by one brick: a
+	// brick is read before older ones are dropped for it, and a budget smaller than a brick still holds that one.
+	std::shared_ptr<const Brick> brick(int brick);
+
+	// Bytes of the bricks held by the cache and the most ever held at once
+	size_t memory();
+	size_t peakMemory();
+
+	// Bricks read from the file so far
+	size_t numReads();
+
+private:
+	// Brick index entry of the file
+	struct BrickInfo
+	{
+		uint64_t offset;
+		int32_t firstPoint[3];	// Of the stored points, ghost points included
+		int32_t numPoints[3];	// Stored along each axis
+		int32_t ghostLow[3];
+		int32_t ghostHigh[3];
+		float min;
+		float max;
+	};
+
+	struct Entry
+	{
+		int brick;
+		std::shared_ptr<const Brick> data;
+		size_t bytes;
+	};
+
+	typedef std::list<Entry> EntryList;
+
+	static BrickInfo brickInfo(const glm::ivec3& numPoints, int brickCells, int x, int y, int z);
+	std::shared_ptr<const Brick> readBrick(int brick);
+
+	int 					m_brickCells;
+	std::vector<BrickInfo> 	m_bricks;
+	EntryList 				m_entries;		// Most recently used first
+	FILE* 					m_file;
+	std::mutex 				m_fileMutex;
+	std::unordered_map<int, EntryList::iterator> m_lookup;
+	float 					m_max;
+	size_t 					m_memory;
+	size_t 					m_memoryBudget;
+	float 					m_min;
+	std::mutex 				m_mutex;
+	glm::ivec3 				m_numBricks;
+	glm::ivec3 				m_numPoints;
+	size_t 					m_numReads;
+	glm::vec3 				m_origin;
+	size_t 					m_peakMemory;
+	glm::vec3 				m_spacing;
+};
@@ -34,13 +34,15 @@ public:
 
 	void incrementHeight(float value);
 
+	// Polygonises the grid into line segments at isoValue, needs no GL context
+	void marchingSquares(float isoValue, std::vector<ContourVertexAttribute>& data);
+
 protected:
 	virtual glm::vec4& getColor(float isoValue, int corners[CORNERS_PER_CELL]) = 0;
 
 private:
 	using UpdatableObject::update;
 
-    void marchingSquares(float isoValue, std::vector<ContourVertexAttribute>& data);
 	void initMovable(const GLuint& vao, const GLuint& vbo) { }
 	void updateMovable(const float& totalTime, const float& frameTime);
     int updateCell(float isoValue, int corners[CORNERS_PER_CELL], ContourVertexAttribute* buffer, glm::vec4& color);
@@ -0,0 +1,39 @@
+#pragma once
+#include <cstdint>
+
+// Computes marching cubes codes for a row of cells at once from the four rows of points along its
+// x edges, with AVX2 or SSE2 when the processor has them and a scalar loop otherwise
+class CubeClassifier
+{
+public:
+	// Writes the codes of cells [0, numCells) to codes. The point rows are (y, z), (y + 1, z), (y, z + 1) and
+	// (y + 1, z + 1) and hold numCells + 1 values each. The x of every cell that is neither entirely inside nor
+	// outside of the surface goes to active, the number of them is returned.
+	static int classifyRow(
+		const float* row0,
+		const float* row1,
+		const float* row2,
+		const float* row3,
+		int numCells,
+		float isoValue,
+		uint8_t* codes,
+		int* active);
+
+	// Classifies the row against several ascending iso values at once. The corners of every cell are reduced to
+	// their value range a single time and only the levels inside it are coded, level l writes its codes to
+	// codes + l * numCells, its active x to active + l * numCells and their number to numActive[l].
+	static void classifyRowLevels(
+		const float* row0,
+		const float* row1,
+		const float* row2,
+		const float* row3,
+		int numCells,
+		const float* isoValues,
+		int numLevels,
+		uint8_t* codes,
+		int* active,
+		int* numActive);
+
+	// Name of the instruction set classifyRow and classifyRowLevels run on
+	static const char* instructionSet();
+};
@@ -0,0 +1,60 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <isosurface_extractor.h>
+
+// Runs the extractions for a stream of iso values on a background thread, one at a time. A new request
+// replaces any waiting one and cancels the running extraction at its next slab, so rapid iso changes
+// cost at most one extraction in flight and only the surface for the latest iso values is delivered.
+// A request with several iso values produces their surfaces one after the other in a single surface.
+class ExtractionScheduler
+{
+public:
+	// Produces the surface for the iso values with the extractor, returns false when it was cancelled
+	typedef std::function<bool(IsoSurfaceExtractor&, const std::vector<float>&, IsoSurface&)> ExtractFunction;
+
+	// extract runs on the background thread in place of a plain extractor.extract, to configure the
+	// extractor or to look the surfaces up somewhere first
+	ExtractionScheduler(IsoSurfaceExtractor& extractor, ExtractFunction extract = nullptr);
+	~ExtractionScheduler();
+
+	void request(const std::vector<float>& isoValues);
+
+	// Drops the waiting request and any surface not polled yet, and cancels the running extraction, for when
+	// the surface came from elsewhere
+	void cancel();
+
+	// Moves the surface of the latest request into surface once it is done, returns false until then
+	bool poll(IsoSurface& surface, std::vector<float>& isoValues);
+
+	// Called from the extract function to hand poll a preview of the running request before it is done,
+	// returns false once a newer request is waiting so the extract function can give up early
+	bool publish(IsoSurface& preview);
+
+	// True while a request is waiting or being extracted
+	bool busy();
+	float progress();
+
+private:
+	void run();
+
+	bool 					m_busy;
+	std::atomic<bool> 		m_cancel;
+	ExtractFunction 		m_extract;
+	IsoSurfaceExtractor& 	m_extractor;
+	bool 					m_hasRequest;
+	bool 					m_hasResult;
+	std::mutex 				m_mutex;
+	std::vector<float> 		m_requestIsoValues;
+	IsoSurface 				m_result;
+	std::vector<float> 		m_resultIsoValues;
+	bool 					m_running;
+	std::vector<float> 		m_runningIsoValues;
+	bool 					m_stop;
+	std::thread 			m_thread;
+	std::condition_variable m_wake;
+};
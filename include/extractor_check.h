@@ -0,0 +1,20 @@
+#pragma once
+#include <string>
+#include <isosurface_extractor.h>
+#include <volume.h>
+
+// Cross-checks of the extractors against each other, run by the benchmark and by extract --verify.
+// Every check prints what differs to stderr and returns false when it finds anything.
+
+// True when both surfaces hold the same triangles in any order, welded or not, with the corners of matching
+// triangles less than tolerance apart along every axis
+bool sameTriangles(const IsoSurface& a, const IsoSurface& b, float tolerance);
+
+// Vertices of a welded surface inside an edge less than tolerance from another one, which welding should have
+// merged. Vertices on a grid point are left out, an iso value equal to its value puts those of all its edges there.
+size_t numDuplicateVertices(const IsoSurface& surface, const Volume& volume, float tolerance);
+
+// Checks at one iso value that flying edges matches marching cubes, that bricked and region extraction match
+// extracting the whole volume at once, that soups match welded surfaces and that no welded surface holds
+// duplicate vertices. The bricks are written to brickPath and removed again.
+bool checkExtractors(const Volume& volume, float isoValue, const std::string& brickPath);
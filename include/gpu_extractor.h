@@ -0,0 +1,61 @@
+#pragma once
+#include <vector>
+#include <glew.h>
+#include <isosurface_extractor.h>
+#include <shader.h>
+#include <volume.h>
+
+// Levels the histogram pyramid may have, enough for 4^15 cells, as in marchingCubesGenerateComputeShader.glsl
+#define GPU_PYRAMID_LEVELS 16
+
+// Marching cubes in compute shaders. The volume sits in a 3D texture, a first pass counts the triangles of
+// every cell into the base of a histogram pyramid whose levels each sum four nodes of the one below, and a
+// last pass runs one invocation per triangle that finds its cell by descending the pyramid and writes the
+// triangle straight into the vertex buffer. Only the number of triangles is read back, to size the buffer, but
+// that waits for the counting passes of every surface to finish, so extract blocks until they have.
+// The surfaces are triangle soups with flat normals, the same as those of IsoSurfaceExtractor without indices.
+class GpuExtractor
+{
+public:
+	// Uploads the volume and builds the shaders, the context has to be current whenever the extractor is used
+	GpuExtractor(const Volume& volume);
+	~GpuExtractor();
+
+	// Compute shaders and storage buffers are core from OpenGL 4.3 on
+	static bool supported();
+
+	// False when the context lacks compute shaders, a shader failed to build or the volume does not fit
+	bool valid() const { return m_valid; }
+
+	// Writes the surfaces of the iso values one after the other into vertexBuffer() as MeshVertexAttribute.
+	// Returns false when one of them is too large for a storage buffer, it has to be extracted on the CPU then.
+	bool extract(const std::vector<float>& isoValues);
+
+	GLuint vertexBuffer() const { return m_vertexBuffer; }
+
+	// Vertices of every surface of the last extraction, in the order of its iso values
+	const std::vector<size_t>& numVertices() const { return m_numVertices; }
+
+	// Reads the last extraction back, to compare it with the CPU
+	void read(std::vector<IsoSurface>& surfaces) const;
+
+private:
+	void reserve(size_t bytes, size_t usedBytes);
+	static void dispatch(size_t numInvocations);
+
+	ComputeShader 			m_classifyShader;
+	ComputeShader 			m_generateShader;
+	std::vector<GLuint> 	m_levelOffsets;
+	std::vector<GLuint> 	m_levelSizes;
+	GLint 					m_maxBlockSize;			// Bytes a storage buffer binding may span
+	std::vector<size_t> 	m_numVertices;
+	GLuint 					m_pyramidBuffer;
+	ComputeShader 			m_reduceShader;
+	GLint 					m_storageAlignment;		// Of the offsets storage buffer ranges are bound at
+	GLuint 					m_triangleTableBuffer;
+	bool 					m_valid;
+	GLuint 					m_vertexBuffer;
+	size_t 					m_vertexCapacity;		// Bytes
+	Volume 					m_volume;
+	GLuint 					m_volumeTexture;
+};
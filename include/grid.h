@@ -1,20 +1,19 @@
 #pragma once
+#include <cstdint>
 #include <functional>
 #include <glm.hpp>
 #include <scalar_attributes.h>
+#include <minmax_octree.h>
 #include <movable.h>
+#include <mutex>
+#include <bricked_volume.h>
+#include <plane.h>
+#include <volume.h>
+#include <volume_pyramid.h>
 
 typedef std::function<float(float, float)> Calculate2DFunction;
 typedef std::function<float(float, float, float)> Calculate3DFunction;
 
-struct Plane
-{
-	float a;
-	float b;
-	float c;
-	float d;
-};
-
 class Grid : public MovableObject
 {
 public:
@@ -63,6 +62,8 @@ protected:
 class Grid3D : public Grid
 {
 public:
+	~Grid3D();
+
 	int findCell(float* p) override;
 	int	getCell(int i, int* c) override;
     void getPoint(int i, float* p) override;
@@ -70,6 +71,19 @@ public:
 	int	numPoints() override { return m_numPointsX * m_numPointsY * m_numPointsZ; }
 	int	numCells() override { return (m_numPointsX - 1) * (m_numPointsY - 1) * (m_numPointsZ - 1); }
 
+	Volume volume();
+
+	// Value range hierarchy over the point scalars for skipping empty space, built on first use from any thread
+	const MinMaxOctree& minMaxOctree();
+
+	// Hash of the point scalars identifying the dataset in the isosurface cache, computed on first use from any thread
+	uint64_t checksum();
+
+	// Reduced copies of the point scalars for coarse previews, built on first use from any thread with the
+	// reduction set before that
+	const VolumePyramid& pyramid();
+	void setPyramidReduction(VolumeReduction reduction) { m_pyramidReduction = reduction; }
+
 protected:
 	Grid3D();
 
@@ -82,6 +96,13 @@ protected:
 	int		m_numPointsX; 	// Number of points along the x-axis
 	int 	m_numPointsY; 	// Number of points along the y−axis
 	int 	m_numPointsZ; 	// Number of points along the z−axis
+	MinMaxOctree* m_minMaxOctree; 	// Value ranges of blocks of cells, built on first use
+	std::once_flag m_minMaxOctreeBuilt;
+	uint64_t m_checksum; 			// Of the point scalars, computed on first use
+	std::once_flag m_checksumComputed;
+	VolumePyramid* m_pyramid; 		// Reduced levels of the point scalars, built on first use
+	std::once_flag m_pyramidBuilt;
+	VolumeReduction m_pyramidReduction;
 };
 
 class CalculateGrid2D : public Grid2D
@@ -158,6 +179,10 @@ public:
 
     float evaluate(float x, float y, float z) override;
 
+	// Converts the dataset into a volume brick file for out-of-core extraction, placed as the grid places
+	// it, see VolumeFile::writeBricks
+	static bool writeBricks(const std::string& pvmFilePath, const std::string& brickFilePath, int brickCells = BRICK_CELLS);
+
 private:
     ScalarAttributes* initScalars(unsigned char* volume, unsigned int bytesPerValue);
 };
\ No newline at end of file
@@ -0,0 +1,77 @@
+#pragma once
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <isosurface_extractor.h>
+#include <volume.h>
+
+#define ISOSURFACE_CACHE_MEMORY_BUDGET (256u << 20)
+#define ISOSURFACE_CACHE_DIRECTORY "isosurface_cache"
+
+// Everything the extracted surface depends on, laid out without padding so it can be hashed and
+// stored as raw bytes in the cache files
+struct IsoSurfaceKey
+{
+	uint64_t checksum;		// Of the point scalars of the grid
+	int32_t numPoints[3];
+	float origin[3];
+	float spacing[3];
+	float isoValue;
+	uint32_t indexed;
+	uint32_t method;		// IsoSurfaceMethod, marching cubes is 0 so files from before it was added still match
+	uint32_t segmented;		// Split into unwelded brick segments by a RegionExtractor
+	uint32_t reserved;		// Keeps the key a multiple of 8 bytes without padding
+
+	IsoSurfaceKey() = default;
+	IsoSurfaceKey(uint64_t checksum, const Volume& volume, float isoValue, bool indexed, IsoSurfaceMethod method = ISOSURFACE_MARCHING_CUBES, bool segmented = false);
+
+	uint64_t hash() const;
+	bool operator==(const IsoSurfaceKey& other) const;
+};
+
+// Two tier cache of extracted surfaces. Recently used surfaces stay in memory up to a byte budget and
+// are evicted least recently used first, every surface is also written to a file in the cache
+// directory that is mapped straight back into memory on a miss, so iso values already visited in
+// earlier runs load without extracting. Segmented surfaces keep their segments, those read from a file get
+// keys derived from the cache key so they never match the segments extracted in this run. Safe to share
+// between threads.
+class IsoSurfaceCache
+{
+public:
+	// An empty directory keeps the cache in memory only
+	IsoSurfaceCache(size_t memoryBudget = ISOSURFACE_CACHE_MEMORY_BUDGET, const std::string& directory = ISOSURFACE_CACHE_DIRECTORY);
+
+	// Copies the cached surface for key into surface, returns false when neither tier has it
+	bool find(const IsoSurfaceKey& key, IsoSurface& surface);
+	void insert(const IsoSurfaceKey& key, const IsoSurface& surface);
+
+	size_t memory();
+
+	static IsoSurfaceCache& instance();
+
+private:
+	struct Entry
+	{
+		IsoSurfaceKey key;
+		IsoSurface surface;
+		size_t bytes;
+	};
+
+	typedef std::list<Entry> EntryList;
+
+	void insertMemory(const IsoSurfaceKey& key, const IsoSurface& surface);
+	bool readFile(const IsoSurfaceKey& key, IsoSurface& surface) const;
+	void writeFile(const IsoSurfaceKey& key, const IsoSurface& surface) const;
+	std::string filePath(const IsoSurfaceKey& key) const;
+
+	static size_t surfaceBytes(const IsoSurface& surface);
+
+	std::string 			m_directory;
+	EntryList 				m_entries;		// Most recently used first
+	std::unordered_map<uint64_t, EntryList::iterator> m_lookup;
+	size_t 					m_memory;
+	size_t 					m_memoryBudget;
+	std::mutex 				m_mutex;
+};
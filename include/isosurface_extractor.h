@@ -0,0 +1,151 @@
+#pragma once
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <marching_cubes.h>
+#include <minmax_octree.h>
+#include <thread_pool.h>
+#include <volume.h>
+
+// Triangles of one brick of a surface kept apart from the others, so they can be replaced on their own. The
+// indices of a segment only reference its own vertices, soups have no indices.
+struct IsoSurfaceSegment
+{
+	uint64_t key;			// Segments with the same key hold the same triangles
+	size_t firstVertex;
+	size_t numVertices;
+	size_t firstIndex;
+	size_t numIndices;
+};
+
+// Extracted surface, either a triangle soup in vertices or, when indices is not empty,
+// welded vertices shared between triangles referenced three at a time by indices
+struct IsoSurface
+{
+	std::vector<MeshVertexAttribute> vertices;
+	std::vector<uint32_t> indices;
+	std::vector<IsoSurfaceSegment> segments;	// Covering the whole surface, or none
+
+	bool indexed() const { return !indices.empty(); }
+
+	// Adds the triangles of another surface of the same kind after the ones already held. The segments are kept
+	// only when both surfaces are split into them, or empty.
+	void append(const IsoSurface& other);
+};
+
+class SliceEdgeCache;
+
+enum IsoSurfaceMethod
+{
+	ISOSURFACE_MARCHING_CUBES,
+	ISOSURFACE_SURFACE_NETS,
+	ISOSURFACE_FLYING_EDGES,
+	ISOSURFACE_ADAPTIVE
+};
+
+// Runs marching cubes or surface nets over a volume in parallel. The cells are split into slabs of whole z layers,
+// a first pass counts the output of every slab so the surface is allocated once at its exact size
+// and a second pass polygonises the slabs straight into their place in it.
+class IsoSurfaceExtractor
+{
+public:
+	IsoSurfaceExtractor(const Volume& volume, ThreadPool& pool = ThreadPool::instance());
+	~IsoSurfaceExtractor();
+
+	// Returns false when the extraction was cancelled, the surface is left unspecified then
+	bool extract(float isoValue, IsoSurface& surface);
+
+	// Extracts the surfaces of several iso values in a single sweep, classifying each cell once for all of them.
+	// surfaces[i] gets the surface of isoValues[i], in any order.
+	bool extract(const std::vector<float>& isoValues, std::vector<IsoSurface>& surfaces);
+
+	// Weld the vertices on shared edges and emit an index buffer, normals then come from the field gradient
+	void setIndexed(bool enable) { m_indexed = enable; }
+
+	// Surface nets place a single vertex in every cell the surface passes through, at the mean of its edge
+	// crossings, and join the four cells around every cut edge with a quad. The result is always welded,
+	// with better shaped triangles than marching cubes, and is only expanded afterwards for a soup.
+	// Flying edges produces the same surface as marching cubes in passes over whole rows of points, see
+	// extractFlyingEdges, and ignores the octree.
+	// Adaptive marching cubes polygonises the leaves of an AdaptiveOctree refined around each surface, with far
+	// fewer triangles where the field is close to trilinear. It is always welded first and uses the min max octree
+	// when one is set, building its own otherwise.
+	void setMethod(IsoSurfaceMethod method) { m_method = method; }
+
+	// Error in cells and spread of the normals in degrees the leaves of adaptive marching cubes may have
+	void setAdaptiveTolerance(float errorCells, float normalAngle) { m_adaptiveError = errorCells; m_adaptiveAngle = normalAngle; }
+
+	// Number of cell layers per slab, 0 picks a depth based on the number of threads
+	void setSlabDepth(int depth) { m_slabDepth = depth; }
+
+	// Skip the blocks of cells the octree rules out, the octree has to outlive the extractor
+	void setMinMaxOctree(const MinMaxOctree* octree) { m_octree = octree; }
+
+	// Checked before every slab, once set the running extraction skips its remaining slabs and returns
+	void setCancelFlag(const std::atomic<bool>* cancel) { m_cancel = cancel; }
+	const std::atomic<bool>* cancelFlag() const { return m_cancel; }
+
+	// Fraction of the running or last extraction that is done, safe to poll from other threads
+	float progress() const;
+
+	// Bytes held at once by the last extraction, the surface and the scratch buffers but not the volume
+	size_t peakMemory() const { return m_peakMemory; }
+
+private:
+	// Output range of one slab in the surface of one iso value, indexed slabs also keep the vertex ids on their
+	// top point plane so the next slab can reference them instead of duplicating the vertices on the shared plane.
+	// Surface nets keep the vertex ids of the cells in their last layer in topX.
+	struct SlabOutput
+	{
+		size_t numVertices;
+		size_t numIndices;
+		size_t vertexOffset;
+		size_t indexOffset;
+		std::vector<uint32_t> topX;
+		std::vector<uint32_t> topY;
+	};
+
+	struct Slab
+	{
+		int beginZ;
+		int endZ;
+		size_t beginBlock;	// Range of the slab in the active blocks
+		size_t endBlock;
+		std::vector<SlabOutput> outputs;	// One per iso value
+	};
+
+	template <typename Visit>
+	void forEachCell(const Slab& slab, Visit visit) const;
+
+	void countSlab(Slab& slab);
+	void fillSlab(const Slab& slab, const std::vector<IsoSurface*>& surfaces);
+	void fillSlabIndexed(Slab& slab, const std::vector<IsoSurface*>& surfaces);
+	void countSlabNets(Slab& slab);
+	void fillSlabNets(Slab& slab, const std::vector<IsoSurface*>& surfaces);
+	bool extractFlyingEdges(float isoValue, IsoSurface& surface);
+	bool extractAdaptive(const std::vector<IsoSurface*>& surfaces);
+	void expandSoup(IsoSurface& surface);
+	void addCellVertex(float isoValue, float colorNorm, int x, int y, int z, const float* values, int code, MeshVertexAttribute& vertex);
+	SliceEdgeCache* acquireEdgeCache();
+	void releaseEdgeCache(SliceEdgeCache* cache);
+	void addEdgeVertex(float isoValue, float colorNorm, const glm::ivec3& p1, const glm::ivec3& p2, MeshVertexAttribute& vertex);
+
+	bool cancelled() const { return m_cancel != nullptr && *m_cancel; }
+
+	std::vector<glm::ivec3> m_activeBlocks;
+	float 					m_adaptiveAngle;
+	float 					m_adaptiveError;
+	const std::atomic<bool>* m_cancel;
+	std::vector<SliceEdgeCache*> m_edgeCaches;	// Idle, kept between extractions
+	std::mutex 				m_edgeCacheMutex;
+	bool 					m_indexed;
+	std::vector<float> 		m_isoValues;	// Of the running extraction, ascending
+	IsoSurfaceMethod 		m_method;
+	size_t 					m_peakMemory;
+	ThreadPool& 			m_pool;
+	int 					m_slabDepth;
+	const MinMaxOctree* 	m_octree;
+	std::atomic<int> 		m_slabsDone;
+	std::atomic<int> 		m_slabsTotal;
+	Volume 					m_volume;
+};
@@ -6,19 +6,65 @@
 #include <grid.h>
 #include <light.h>
 #include <material.h>
+#include <atomic>
+#include <mutex>
+#include <extraction_scheduler.h>
+#include <gpu_extractor.h>
+#include <isosurface_cache.h>
+#include <map>
+#include <mesh_decimator.h>
+#include <range_allocator.h>
+#include <region_extractor.h>
+#include <unordered_map>
 
 #define COLOR_MAP_RESOLUTION 128
-#define MAX_EDGES_PER_CELL 12
-#define VERTICES_PER_EDGE 2
-#define CORNERS_PER_VOXEL 8
 
 typedef std::function<glm::vec4(float)> ColorFunction;
 
-struct MeshVertexAttribute
+// 12 bytes in place of the 28 of MeshVertexAttribute, the position in 16 bit steps across the grid's bounding
+// box and the normal octahedral encoded. The color norm is the same for a whole surface and set per draw.
+struct PackedMeshVertex
+{
+	uint16_t position[3];
+	uint16_t padding;	// Keeps the normal 4 byte aligned
+	int16_t normal[2];
+};
+
+// Triangles drawn with one color norm, as elements or vertices from the start of their level
+struct MeshColorRun
+{
+	int first;
+	int count;
+	float colorNorm;
+};
+
+// A decimated level uploaded after the full resolution surface, in the same vertex and element buffers
+struct MeshLod
+{
+	float error;
+	int baseVertex;
+	int firstIndex;
+	int numIndices;
+};
+
+// A brick segment of the surface, uploaded into ranges of the vertex and element buffers of its own
+struct MeshSegment
+{
+	size_t firstVertex;
+	size_t numVertices;
+	size_t firstIndex;
+	size_t numIndices;
+	float colorNorm;
+};
+
+// Segments drawn with one color norm by a single multi draw call
+struct MeshSegmentBatch
 {
-    glm::vec3 position;
-	glm::vec3 normal;
 	float colorNorm;
+	std::vector<GLsizei> counts;
+	std::vector<GLint> firsts;				// Of soups, in vertices
+	std::vector<const void*> offsets;		// Of welded segments, in bytes into the element buffer
+	std::vector<GLint> baseVertices;
 };
 
 class Mesh : public MovableObject
@@ -30,31 +76,125 @@ public:
 	void wireframe(bool enable);
 	void update(const Camera& camera, const Light& light);
 
-    void setIsoValue(float value) { m_isoValue = value; }
-	float getIsoValue() { return m_isoValue; }
+    void setIsoValue(float value);
+	float getIsoValue() { return m_isoValues[0]; }
+
+	// Draws the surfaces of one or more iso values, extracted together in a single sweep over the grid and
+	// drawn in the given order. setIsoValue moves all of them along with the first one.
+	void setIsoValues(const std::vector<float>& values) { m_isoValues = values; }
+
+	// Draw welded vertices through an index buffer instead of a triangle soup
+	void setIndexed(bool enable);
+
+	// Marching cubes by default, surface nets or adaptive marching cubes for large volumes where the triangle
+	// count matters
+	void setMethod(IsoSurfaceMethod method);
+
+	// Show surfaces from the grid's reduced pyramid levels, coarsest first, while the full resolution
+	// one is being extracted. On by default, surfaces found in the cache are shown right away either way.
+	void setPreview(bool enable) { m_preview = enable; }
+
+	// Decimate every extracted surface into numLevels coarser levels and draw the coarsest one whose error
+	// projects to at most pixelError pixels on screen. Off with 0 levels, the default.
+	void setLevelsOfDetail(int numLevels, float pixelError = 1.0f);
+
+	// Upload packed vertices at less than half the size, drawn one surface at a time for their color norm
+	void setQuantized(bool enable);
+
+	// Extract only the part of the surfaces inside an axis aligned box in the grid's coordinates, see
+	// RegionExtractor. The box can be moved every frame, only the bricks it newly exposes are extracted.
+	void setClipBox(const glm::vec3& min, const glm::vec3& max);
+
+	// Keeps the side of every plane where a x + b y + c z + d >= 0, inside the clip box if one is set
+	void setClipPlanes(const std::vector<Plane>& planes);
+
+	// Extract the whole grid again
+	void clearClip();
+
+	// Extract in bricks as for a clip region, those in the camera's frustum nearest to the eye first, and show
+	// them before the bricks off screen are done. Takes the place of the pyramid previews, off by default.
+	void setViewPriority(bool enable);
+
+	// Extract marching cubes surfaces with compute shaders straight into a vertex buffer, see GpuExtractor, off by
+	// default. The CPU extracts them instead without OpenGL 4.3, with a clip region, for the other methods and for
+	// surfaces too large for the GPU. GPU surfaces are triangle soups of full vertices without levels of detail.
+	// The number of triangles of every surface is read back to size the vertex buffer, which waits for the GPU
+	// to count them, so the frame an iso value changes in stalls until then.
+	void setGpuExtraction(bool enable);
+
+	// Turns false again on the first frame that finds the context lacking OpenGL 4.3 or the shaders failing to build
+	bool gpuExtraction() const { return m_gpuExtraction; }
+
+	// Extraction runs in the background while the last surface keeps being drawn, iso changes made
+	// meanwhile cancel it and only the surface for the latest iso value gets uploaded
+	bool extracting() const { return m_scheduler->busy(); }
+	float extractionProgress() const { return m_scheduler->progress(); }
+
+	// Surfaces of the last extraction found in the isosurface cache, in memory or on disk
+	int numCachedSurfaces() const { return m_numCachedSurfaces; }
 
 private:
 	using UpdatableObject::update;
 
-    void marchingCubes(float isoValue, std::vector<MeshVertexAttribute>& data);
+	bool extractSurface(IsoSurfaceExtractor& extractor, const std::vector<float>& isoValues, IsoSurface& surface);
+	void uploadSurface(const IsoSurface& surface, const std::vector<IsoSurfaceLod>& lods);
+	void uploadSegments(const IsoSurface& surface);
+	void clearSegments();
+	void growBuffer(GLenum target, RangeAllocator& ranges, size_t unitSize, size_t size);
+	void uploadVertices(size_t firstVertex, const MeshVertexAttribute* vertices, size_t numVertices, std::vector<PackedMeshVertex>& packed);
+	void setVertexFormat(bool quantized);
+	bool useGpu();
+	bool extractOnGpu();
+	void setClipRegion(const ClipRegion& region);
+	int selectLevel(const glm::mat4& modelView) const;
 	void initMovable(const GLuint& vao, const GLuint& vbo);
 	void updateMovable(const float& totalTime, const float& frameTime);
-    int updateVoxel(float isoValue, int corners[CORNERS_PER_VOXEL], MeshVertexAttribute* buffer);
-    glm::vec3 vertexInterpolation(float isoValue, glm::vec3& p1, glm::vec3& p2, double p1Value, double p2Value);
 
     glm::vec4& defaultColor(float value) { return m_defaultColor; }
 	inline float computeNorm(float value, float min, float max) { return ((value - min) / (max - min)); }
 
+	glm::vec3 		m_boundsCenter;
+	float 			m_boundsRadius;
 	const Camera* 	m_camera;
+	bool 			m_clipped;
+	std::mutex 		m_clipMutex;						// Guards the clip region and the view
+	ClipRegion 		m_clipRegion;						// Read by the scheduler's thread when m_clipped
+	std::vector<std::vector<MeshColorRun>> m_colorRuns;	// Per level, the full resolution surface first
     ColorFunction 	m_colorFunction;
     GLuint 			m_colorTexture;
     glm::vec4 		m_defaultColor;
+	GLuint 			m_elementBuffer;
+	IsoSurfaceExtractor* m_extractor;
+	bool 			m_gpuExtraction;
+	GpuExtractor* 	m_gpuExtractor;						// Made on the GL thread once GPU extraction is used
 	Grid3D&			m_grid;
-    float           m_isoValue;
+	std::atomic<bool> m_indexed;
+	std::vector<float> m_isoValues;
 	const Light* 	m_light;
+	std::vector<IsoSurfaceLod> m_lodChain;		// Built by the scheduler's thread for m_lodChainIsoValues
+	std::vector<float> m_lodChainIsoValues;
+	std::mutex 		m_lodMutex;
+	std::vector<MeshLod> m_lods;
 	Material		m_material;
+	std::atomic<int> m_method;
+	std::atomic<int> m_numCachedSurfaces;
+	int 			m_numIndices;
+	std::atomic<int> m_numLevels;
     int 			m_numVertices;
-    float           m_prevIsoValue;
+	std::atomic<bool> m_preview;
+	float 			m_pixelError;
+	std::vector<float> m_prevIsoValues;
+	bool 			m_quantized;
+	RegionExtractor* m_regionExtractor;					// Made and used by the scheduler's thread
+	std::vector<MeshSegmentBatch> m_segmentBatches;
+	RangeAllocator 	m_segmentIndexRanges;
+	std::unordered_map<uint64_t, MeshSegment> m_segments;	// Uploaded, by the key of their brick segment
+	RangeAllocator 	m_segmentVertexRanges;
+	size_t 			m_segmentVertexSize;				// Bytes per vertex of the uploaded segments
+	ExtractionScheduler* m_scheduler;
 	ShaderBase* 	m_shader;
+	glm::mat4 		m_viewModelView;					// Of the last frame, bricks are ordered by it
+	std::atomic<bool> m_viewPriority;
+	glm::mat4 		m_viewProjection;
 	GLenum 			m_wireframe;
 };
\ No newline at end of file
@@ -0,0 +1,70 @@
+#pragma once
+#include <atomic>
+#include <vector>
+#include <glm.hpp>
+#include <isosurface_extractor.h>
+#include <thread_pool.h>
+
+// Blocks the vertices are split into per thread, every block is decimated on its own
+#define DECIMATION_BLOCKS_PER_THREAD 8
+
+// One level of detail, error bounds the distance of its vertices to the planes of the full resolution triangles they replace
+struct IsoSurfaceLod
+{
+	IsoSurface surface;
+	float error;
+};
+
+// Quadric error metric decimation in parallel. The bounding box of the surface is cut into blocks and the
+// edges whose vertices and neighbours all lie in one block are collapsed cheapest first by one task per
+// block, so no two tasks ever touch the same triangle. A second pass over blocks shifted by half their
+// size collapses the edges that were held back on the block borders. Open borders of the surface and
+// non-manifold edges are kept in place.
+class MeshDecimator
+{
+public:
+	MeshDecimator(ThreadPool& pool = ThreadPool::instance());
+
+	// Decimates the surface into numLevels levels, the first allowed an error of baseError and every next one
+	// twice the error of the one before, each decimated further from the last. A triangle soup is welded first,
+	// the levels are always indexed. Returns false when cancelled, the levels are left unspecified then.
+	bool buildChain(const IsoSurface& surface, float baseError, int numLevels, std::vector<IsoSurfaceLod>& levels);
+
+	// Checked before every pass, as in IsoSurfaceExtractor
+	void setCancelFlag(const std::atomic<bool>* cancel) { m_cancel = cancel; }
+
+private:
+	// Sum of squared distances to a set of planes, p^T A p + 2 b^T p + c
+	struct Quadric
+	{
+		double a00, a01, a02, a11, a12, a22;
+		double b0, b1, b2;
+		double c;
+
+		void addPlane(const glm::dvec3& normal, double d);
+		void add(const Quadric& other);
+		double error(const glm::dvec3& p) const;
+		bool minimum(glm::dvec3& p) const;
+	};
+
+	void load(const IsoSurface& surface);
+	void buildAdjacency();
+	void decimatePass(float maxError, int pass);
+	void decimateBlock(const uint32_t* blockVertices, int numBlockVertices, double maxCost);
+	double collapseCost(uint32_t v, uint32_t w, glm::vec3& target) const;
+	void compact(IsoSurface& surface);
+
+	bool cancelled() const { return m_cancel != nullptr && *m_cancel; }
+
+	std::vector<uint32_t> 		m_adjacency;		// Triangles around every vertex, from m_adjacencyOffsets[v]
+	std::vector<uint32_t> 		m_adjacencyOffsets;
+	std::vector<uint32_t> 		m_blocks;			// Of the vertices in the running pass
+	const std::atomic<bool>* 	m_cancel;
+	std::vector<uint8_t> 		m_collapsible;		// Vertex lies inside its block and away from open borders
+	std::vector<uint8_t> 		m_dead;
+	std::vector<uint32_t> 		m_indices;			// Three per triangle, removed ones start with REMOVED_TRIANGLE
+	std::vector<uint32_t> 		m_localIndex;		// Of every vertex in the list of its block
+	ThreadPool& 				m_pool;
+	std::vector<Quadric> 		m_quadrics;
+	std::vector<MeshVertexAttribute> m_vertices;
+};
@@ -0,0 +1,128 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <isosurface_extractor.h>
+
+// Bytes gathered in memory before a single write to the file
+#define MESH_WRITER_BUFFER_SIZE (4u << 20)
+
+// Bytes of the binary PLY header, padded with a comment so the counts can be filled in once the mesh is done
+#define PLY_HEADER_SIZE 512
+
+// A file written through a large buffer of its own, stdio buffering is turned off so the bytes are copied once
+class MeshFileStream
+{
+public:
+	MeshFileStream();
+	~MeshFileStream();
+
+	bool open(const std::string& path, const char* mode);
+	bool put(const void* data, size_t bytes);
+	bool flush();
+	bool seek(uint64_t offset);
+	void close();
+
+	FILE* file() const { return m_file; }
+
+private:
+	std::vector<char> 	m_buffer;
+	FILE* 				m_file;
+	size_t 				m_size;
+};
+
+enum MeshFileFormat
+{
+	MESH_FILE_PLY,
+	MESH_FILE_STL,
+	MESH_FILE_OBJ
+};
+
+// Writes an extracted surface to a mesh file chunk by chunk as it is produced, so the whole surface is never
+// held in memory. Binary PLY keeps the welded vertices and the color norm of every vertex, binary STL is a
+// triangle soup with facet normals and OBJ keeps the welded vertices and their normals. The file is written
+// under a temporary name and only renamed to its path once closed.
+class MeshWriter
+{
+public:
+	// Picks the format from the extension of path, .ply, .stl or .obj, nullptr when it is unknown or the file
+	// cannot be created
+	static MeshWriter* create(const std::string& path);
+	static MeshWriter* create(const std::string& path, MeshFileFormat format);
+
+	virtual ~MeshWriter();
+
+	// Appends the triangles of a chunk. A soup chunk holds three vertices per triangle, the indices of an indexed
+	// chunk count the vertices of all chunks written so far from the first, this chunk's included, so later
+	// chunks can reference the vertices they share with earlier ones.
+	bool write(const IsoSurface& chunk);
+
+	// Completes the file and moves it to its path, returns false when any write failed
+	bool close();
+
+	// Whether indexed chunks may reference the vertices of earlier chunks, STL keeps no vertices to
+	// reference and is better fed triangle soups
+	virtual bool sharesVertices() const { return true; }
+
+	size_t numVertices() const { return m_numVertices; }
+	size_t numTriangles() const { return m_numTriangles; }
+
+protected:
+	MeshWriter(const std::string& path);
+
+	bool open();
+
+	virtual bool begin() = 0;
+	virtual bool writeChunk(const IsoSurface& chunk) = 0;
+	virtual bool end() = 0;
+
+	bool 				m_failed;
+	size_t 				m_numTriangles;
+	size_t 				m_numVertices;		// Before the running chunk while it is written
+	std::string 		m_path;
+	MeshFileStream 		m_stream;
+	std::string 		m_tempPath;
+};
+
+// Binary little endian PLY, the faces follow all the vertices in the file so they are kept in a second
+// temporary file until the mesh is done and then appended
+class PlyMeshWriter : public MeshWriter
+{
+public:
+	PlyMeshWriter(const std::string& path);
+	~PlyMeshWriter();
+
+private:
+	bool begin();
+	bool writeChunk(const IsoSurface& chunk);
+	bool end();
+	bool writeHeader();
+
+	MeshFileStream 		m_faces;
+	std::string 		m_facesPath;
+};
+
+class StlMeshWriter : public MeshWriter
+{
+public:
+	StlMeshWriter(const std::string& path);
+
+	bool sharesVertices() const { return false; }
+
+private:
+	bool begin();
+	bool writeChunk(const IsoSurface& chunk);
+	bool end();
+};
+
+class ObjMeshWriter : public MeshWriter
+{
+public:
+	ObjMeshWriter(const std::string& path);
+
+private:
+	bool begin();
+	bool writeChunk(const IsoSurface& chunk);
+	bool end();
+};
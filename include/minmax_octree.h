@@ -0,0 +1,92 @@
+#pragma once
+#include <vector>
+#include <glm.hpp>
+#include <thread_pool.h>
+#include <volume.h>
+
+// Cells per side of the leaf blocks
+#define MINMAX_BLOCK_SIZE 8
+
+struct ValueRange
+{
+	float min;
+	float max;
+
+	// Same rule as a marching cubes cell, some corner below the iso value and some at or above it
+	bool contains(float isoValue) const { return min < isoValue && isoValue <= max; }
+};
+
+// Min and max of the point values under blocks of cells, leaves cover MINMAX_BLOCK_SIZE^3 cells and
+// every level above merges 2x2x2 nodes up to a single root. Lets extraction skip whole blocks the iso
+// value does not pass through and lets slicing or picking prune by value range before touching cells.
+class MinMaxOctree
+{
+public:
+	MinMaxOctree(const Volume& volume, ThreadPool& pool = ThreadPool::instance());
+
+	int numLevels() const { return (int)m_levels.size(); }
+	const glm::ivec3& numNodes(int level) const { return m_numNodes[level]; }
+	const ValueRange& node(int level, int x, int y, int z) const;
+
+	// Cells [begin, end) covered by a node
+	void cellBounds(int level, int x, int y, int z, glm::ivec3& begin, glm::ivec3& end) const;
+
+	// Appends the leaf blocks whose range contains the iso value, ordered by z, y then x
+	void activeBlocks(float isoValue, std::vector<glm::ivec3>& blocks) const;
+
+	// Walks down from the root into every node for which accept(range, begin, end) holds and calls
+	// visit(leaf, begin, end) on the accepted leaves, begin and end bounding the cells of the node
+	template <typename Accept, typename Visit>
+	void traverse(Accept accept, Visit visit) const;
+
+	size_t memory() const;
+
+private:
+	std::vector<std::vector<ValueRange>> 	m_levels;	// Finest level first
+	glm::ivec3 								m_numCells;
+	std::vector<glm::ivec3> 				m_numNodes;
+};
+
+template <typename Accept, typename Visit>
+void MinMaxOctree::traverse(Accept accept, Visit visit) const
+{
+	struct Entry
+	{
+		int level;
+		glm::ivec3 node;
+	};
+
+	std::vector<Entry> stack;
+	stack.push_back({ numLevels() - 1, glm::ivec3(0) });
+
+	while (!stack.empty())
+	{
+		Entry entry = stack.back();
+		stack.pop_back();
+
+		glm::ivec3 begin;
+		glm::ivec3 end;
+		this->cellBounds(entry.level, entry.node.x, entry.node.y, entry.node.z, begin, end);
+		if (!accept(this->node(entry.level, entry.node.x, entry.node.y, entry.node.z), begin, end))
+		{
+			continue;
+		}
+
+		if (entry.level == 0)
+		{
+			visit(entry.node, begin, end);
+			continue;
+		}
+
+		// Push the children in reverse so they pop in z, y, x order
+		const glm::ivec3& numChildren = m_numNodes[entry.level - 1];
+		for (int i = 7; i >= 0; i--)
+		{
+			glm::ivec3 child(2 * entry.node.x + (i & 1), 2 * entry.node.y + ((i >> 1) & 1), 2 * entry.node.z + (i >> 2));
+			if (child.x < numChildren.x && child.y < numChildren.y && child.z < numChildren.z)
+			{
+				stack.push_back({ entry.level - 1, child });
+			}
+		}
+	}
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+// Plane of the points where a x + b y + c z + d = 0
+struct Plane
+{
+	float a;
+	float b;
+	float c;
+	float d;
+};
@@ -0,0 +1,29 @@
+#pragma once
+#include <cstddef>
+#include <map>
+
+// First fit allocator of ranges in a buffer of a given capacity, in any unit. Freed ranges merge with the free
+// ranges beside them, and the buffer can grow at its end.
+class RangeAllocator
+{
+public:
+	RangeAllocator(size_t capacity = 0);
+
+	// Returns false when no free range is large enough, the buffer has to grow first
+	bool allocate(size_t size, size_t& offset);
+	void free(size_t offset, size_t size);
+
+	// Adds the space up to capacity as a free range after the last one
+	void grow(size_t capacity);
+
+	// Frees every range and drops the buffer
+	void clear();
+
+	size_t capacity() const { return m_capacity; }
+	size_t used() const { return m_used; }
+
+private:
+	size_t 					m_capacity;
+	std::map<size_t, size_t> m_free;	// Size of every free range by its offset
+	size_t 					m_used;
+};
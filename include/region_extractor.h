@@ -0,0 +1,101 @@
+#pragma once
+#include <atomic>
+#include <cmath>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+#include <glm.hpp>
+#include <isosurface_extractor.h>
+#include <minmax_octree.h>
+#include <plane.h>
+#include <thread_pool.h>
+#include <volume.h>
+
+// Cells along each axis of the bricks a region of interest is extracted in, a whole number of min max blocks
+#define REGION_BRICK_CELLS 32
+
+// Region of interest in the coordinates of the volume, an axis aligned box cut by half spaces
+struct ClipRegion
+{
+	glm::vec3 min = glm::vec3(-INFINITY);
+	glm::vec3 max = glm::vec3(INFINITY);
+	std::vector<Plane> planes;	// Each keeps the points where a x + b y + c z + d >= 0
+};
+
+// Extracts only the surfaces inside a clip region, at a cost that follows the size of the region rather than
+// the volume. The volume is cut into bricks of REGION_BRICK_CELLS cells and the bricks touching the region are
+// extracted on their own, out of views into the volume whose ghost points give them the normals of the whole
+// one. Their surfaces are kept for as long as they touch the region, so moving it only extracts the bricks it
+// newly exposes. The bricks are welded together and their triangles cut by the faces of the box and the planes.
+// With a view set the missing bricks inside the frustum are extracted first, nearest to the eye first, and
+// can be shown before the ones off screen. Segmented surfaces keep every brick apart instead of welding them,
+// so a brick that stays the same keeps its segment key and does not need to be uploaded again, and one the region
+// cuts keeps its key for as long as the planes cutting it do.
+// Marching cubes and flying edges only, the other methods join cells across brick faces as for BrickedExtractor.
+class RegionExtractor
+{
+public:
+	// Receives the surfaces of the bricks done so far, returns false to cancel the extraction
+	typedef std::function<bool(const std::vector<IsoSurface>& surfaces)> PartialFunction;
+
+	// ranges lets bricks the iso values miss be skipped without extracting them, it has to outlive the extractor
+	RegionExtractor(const Volume& volume, const MinMaxOctree* ranges = nullptr, ThreadPool& pool = ThreadPool::instance());
+
+	void setRegion(const ClipRegion& region) { m_region = region; }
+
+	// Orders the bricks by the frustum of a camera looking at the volume, modelView maps the coordinates of the
+	// volume into the camera's
+	void setView(const glm::mat4& modelView, const glm::mat4& projection);
+	void clearView() { m_viewed = false; }
+
+	// Changing these drops the kept bricks. Surface nets and adaptive marching cubes join cells across brick
+	// faces, they are extracted as marching cubes.
+	void setIndexed(bool enable);
+	void setMethod(IsoSurfaceMethod method);
+	void setSegmented(bool enable);
+
+	void setCancelFlag(const std::atomic<bool>* cancel) { m_cancel = cancel; }
+
+	// surfaces[i] gets the part of the surface of isoValues[i] inside the region. Returns false when cancelled,
+	// the bricks extracted until then are kept. When bricks off screen are still missing once the ones in view
+	// are done, visible gets the surfaces of all bricks done by then.
+	bool extract(const std::vector<float>& isoValues, std::vector<IsoSurface>& surfaces, PartialFunction visible = nullptr);
+
+	// Bricks the last extraction touched, those of them in view and those it had to extract
+	int numBricksTouched() const { return m_numBricksTouched; }
+	int numBricksVisible() const { return m_numBricksVisible; }
+	int numBricksExtracted() const { return m_numBricksExtracted; }
+
+private:
+	glm::ivec3 brickCoordinates(int brick) const;
+	void brickBounds(int brick, glm::vec3& min, glm::vec3& max) const;
+	Volume brickVolume(int brick, glm::ivec3& firstPoint) const;
+	bool touches(int brick) const;
+	bool inside(int brick, const std::vector<Plane>& planes) const;
+	bool visible(int brick) const;
+	void assemble(const std::vector<int>& bricks, std::vector<IsoSurface>& surfaces);
+	bool missesAll(int brick, const std::vector<float>& isoValues) const;
+	std::vector<Plane> clipPlanes() const;
+
+	bool cancelled() const { return m_cancel != nullptr && *m_cancel; }
+
+	std::unordered_map<int, std::vector<IsoSurface>> m_bricks;	// Surfaces of every kept brick, one per iso value, as
+																// single segments when segmented
+	const std::atomic<bool>* m_cancel;
+	glm::vec3 				m_eye;				// In the coordinates of the volume
+	bool 					m_indexed;
+	std::vector<float> 		m_isoValues;		// Of the kept bricks
+	IsoSurfaceMethod 		m_method;
+	uint64_t 				m_nextKey;			// Of the next segment made
+	glm::ivec3 				m_numBricks;
+	int 					m_numBricksExtracted;
+	int 					m_numBricksTouched;
+	int 					m_numBricksVisible;
+	ThreadPool& 			m_pool;
+	const MinMaxOctree* 	m_ranges;
+	ClipRegion 				m_region;
+	bool 					m_segmented;
+	bool 					m_viewed;
+	glm::mat4 				m_viewProjection;	// From the coordinates of the volume to clip space
+	Volume 					m_volume;
+};
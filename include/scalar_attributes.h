@@ -1,4 +1,5 @@
 #pragma once
+#include <cmath>
 #include <vector>
 
 class ScalarAttributes
@@ -11,6 +12,7 @@ public:
 
 	void setC0Scalar(int i, float v);
     float getC0Scalar(int i) { return m_values[i]; }
+	const float* getC0Scalars() { return m_values.data(); }
 	float getMin() { return m_minValue; }
 	float getMax() { return m_maxValue; }
 
@@ -16,6 +16,13 @@ public:
     void setBufferColorNorm(int stride, int offset);
 	void setBufferNormal(int stride, int offset);
 	void setBufferPosition(int stride, int offset);
+
+	// Packed vertices, 16 bit positions decoded with setQuantization and two 16 bit octahedral normal
+	// components. The color norm comes from setColorNorm instead of the buffer.
+	void setBufferNormalOctahedral(int stride, int offset);
+	void setBufferPositionQuantized(int stride, int offset);
+	void setColorNorm(float colorNorm);
+	void setQuantization(bool enable, const glm::vec3& origin = glm::vec3(0.0f), const glm::vec3& scale = glm::vec3(1.0f));
 	void setBufferTextureCoord(int stride, int offset);
 	void setDiffuseColor(const glm::vec3& diffuseColor);
 	void setLightPosition(const glm::vec3& lightPosition);
@@ -27,8 +34,24 @@ public:
 	void setView(const glm::mat4& view);
 
 protected:
-	void setBufferParameter(std::string name, int numAttribs, int stride, int offset);
+	void setBufferParameter(std::string name, int numAttribs, int stride, int offset, GLenum type = GL_FLOAT, GLboolean normalized = GL_FALSE);
+	void disableBufferParameter(std::string name);
+
+	unsigned int m_pid;
+};
+
+// Program of a single compute stage, not valid when the file cannot be read or fails to compile or link
+class ComputeShader
+{
+public:
+	ComputeShader(std::string computeShader);
+	~ComputeShader();
+
+	bool valid() const { return m_pid != 0; }
+	void use() const { glUseProgram(m_pid); }
+	GLint uniform(const char* name) const { return glGetUniformLocation(m_pid, name); }
 
+private:
 	unsigned int m_pid;
 };
 
@@ -25,12 +25,14 @@ public:
 	void wireframe(bool enable);
 	void update(const Camera& camera);
 
+	// Builds two triangles per grid cell lifted to the point scalars, needs no GL context
+	void triangulate(std::vector<SurfaceVertexAttribute>& data);
+
 private:
 	using UpdatableObject::update;
 
 	void initMovable(const GLuint& vao, const GLuint& vbo);
 	void updateMovable(const float& totalTime, const float& frameTime);
-	void triangulate(std::vector<SurfaceVertexAttribute>& data);
 
     glm::vec4& defaultColor(float value) { return m_defaultColor; }
 	inline float computeNorm(float value, float min, float max) { return ((value - min) / (max - min)); }
@@ -0,0 +1,47 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads, each with its own task queue. Idle workers steal
+// from the back of the other queues so uneven tasks still keep every core busy.
+class ThreadPool
+{
+public:
+	typedef std::function<void()> Task;
+	typedef std::function<void(int)> IndexedTask;
+
+	ThreadPool(int numThreads = 0);
+	~ThreadPool();
+
+	// Runs task(0) .. task(count - 1) on the pool and returns once all of them are done,
+	// the calling thread works on queued tasks while it waits
+	void parallelFor(int count, const IndexedTask& task);
+
+	int numThreads() const { return (int)m_threads.size(); }
+
+	static ThreadPool& instance();
+
+private:
+	struct Queue
+	{
+		std::deque<Task> tasks;
+		std::mutex mutex;
+	};
+
+	void push(int queue, Task task);
+	bool pop(int queue, Task& task);
+	bool steal(int thief, Task& task);
+	void run(int queue);
+
+	std::vector<Queue*> 		m_queues;
+	std::vector<std::thread> 	m_threads;
+	std::atomic<int> 			m_numQueued;
+	std::mutex 					m_wakeMutex;
+	std::condition_variable 	m_wake;
+	bool 						m_stop;
+};
@@ -0,0 +1,52 @@
+#pragma once
+#include <glm.hpp>
+
+// Read-only view of the point scalars of a regular 3D grid, x varies fastest
+struct Volume
+{
+	const float* values;
+	int numPointsX;
+	int numPointsY;
+	int numPointsZ;
+	glm::vec3 origin;	// Position of the first point
+	glm::vec3 spacing;	// Distance between neighbouring points along each axis
+	float min;
+	float max;
+
+	// Points stored before and after the volume along each axis that only gradients read, so a brick cut
+	// out of a larger volume gets the normals of the whole one on its faces. values points at the first
+	// point inside, the ghost points sit at negative indices and past the end of every row and layer.
+	glm::ivec3 ghostLow = glm::ivec3(0);
+	glm::ivec3 ghostHigh = glm::ivec3(0);
+
+	int pitchX() const { return numPointsX + ghostLow.x + ghostHigh.x; }
+	int pitchY() const { return numPointsY + ghostLow.y + ghostHigh.y; }
+
+	int numCellsX() const { return numPointsX - 1; }
+	int numCellsY() const { return numPointsY - 1; }
+	int numCellsZ() const { return numPointsZ - 1; }
+
+	int index(int x, int y, int z) const { return x + pitchX() * (y + pitchY() * z); }
+	float value(int x, int y, int z) const { return values[index(x, y, z)]; }
+
+	glm::vec3 point(int x, int y, int z) const
+	{
+		return glm::vec3(origin.x + x * spacing.x, origin.y + y * spacing.y, origin.z + z * spacing.z);
+	}
+
+	// Central differences inside the volume and its ghost points, one sided differences on the faces beyond
+	glm::vec3 gradient(int x, int y, int z) const
+	{
+		int x0 = (x > -ghostLow.x) ? x - 1 : x;
+		int x1 = (x < numPointsX - 1 + ghostHigh.x) ? x + 1 : x;
+		int y0 = (y > -ghostLow.y) ? y - 1 : y;
+		int y1 = (y < numPointsY - 1 + ghostHigh.y) ? y + 1 : y;
+		int z0 = (z > -ghostLow.z) ? z - 1 : z;
+		int z1 = (z < numPointsZ - 1 + ghostHigh.z) ? z + 1 : z;
+
+		return glm::vec3(
+			(value(x1, y, z) - value(x0, y, z)) / ((x1 - x0) * spacing.x),
+			(value(x, y1, z) - value(x, y0, z)) / ((y1 - y0) * spacing.y),
+			(value(x, y, z1) - value(x, y, z0)) / ((z1 - z0) * spacing.z));
+	}
+};
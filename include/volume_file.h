@@ -0,0 +1,46 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <glm.hpp>
+#include <bricked_volume.h>
+#include <volume.h>
+
+// Point scalars of a volume dataset read from disk without any grid or GL state, centred on the origin
+// as PvmGrid3D places them. Values of several bytes are decoded little endian, as the grid does.
+class VolumeFile
+{
+public:
+	// Reads a PVM volume, DDS compressed or not
+	VolumeFile(const std::string& path);
+
+	// Reads a volume without a header of the given size, DDS compressed or raw
+	VolumeFile(
+		const std::string& path,
+		int numPointsX,
+		int numPointsY,
+		int numPointsZ,
+		unsigned int components = 1,
+		const glm::vec3& spacing = glm::vec3(1.0f));
+
+	// False when the file could not be read
+	bool valid() const { return !m_values.empty(); }
+
+	const Volume& volume() const { return m_volume; }
+
+	// Bytes of the values in the file once decompressed
+	size_t bytes() const { return m_bytes; }
+
+	// Turns count values of components bytes each into floats
+	static void decode(const unsigned char* data, unsigned int components, size_t count, float* values);
+
+	// Converts a PVM volume into a volume brick file placed as the volume is. Only the raw values are ever held
+	// in memory, each slice is turned into floats as it is written.
+	static bool writeBricks(const std::string& pvmFilePath, const std::string& brickFilePath, int brickCells = BRICK_CELLS);
+
+private:
+	void init(const unsigned char* data, int numPointsX, int numPointsY, int numPointsZ, unsigned int components, const glm::vec3& spacing);
+
+	size_t 				m_bytes;
+	std::vector<float> 	m_values;
+	Volume 				m_volume;
+};
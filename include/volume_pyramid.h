@@ -0,0 +1,36 @@
+#pragma once
+#include <vector>
+#include <thread_pool.h>
+#include <volume.h>
+
+// Reduced levels built below the source volume, 2x, 4x and 8x
+#define VOLUME_PYRAMID_LEVELS 3
+
+// How the 2x2x2 points under a coarse point are combined. Averaging gives the smoothest preview,
+// the maximum keeps thin features that are above the iso value from vanishing at coarse levels.
+enum VolumeReduction
+{
+	VOLUME_REDUCE_AVERAGE,
+	VOLUME_REDUCE_MAX
+};
+
+// Downsampled copies of a volume for quick previews, every level halves the points along each axis.
+// A coarse point sits at the center of the 2x2x2 points it reduces, so the coarse surfaces line up
+// with the full resolution one, and keeps the value range of the source so colors map the same.
+class VolumePyramid
+{
+public:
+	VolumePyramid(const Volume& volume, VolumeReduction reduction = VOLUME_REDUCE_AVERAGE, int maxLevels = VOLUME_PYRAMID_LEVELS, ThreadPool& pool = ThreadPool::instance());
+
+	// Level 0 is the source volume, level i is reduced 2^i times along each axis. Fewer levels than
+	// asked for are built once an axis would drop below two points.
+	int numLevels() const { return (int)m_levels.size(); }
+	const Volume& level(int level) const { return m_levels[level]; }
+
+	// Bytes held by the reduced levels
+	size_t memory() const;
+
+private:
+	std::vector<Volume> 			 m_levels;
+	std::vector<std::vector<float>>	 m_values;	// Of the reduced levels, level i + 1 in m_values[i]
+};
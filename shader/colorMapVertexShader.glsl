@@ -10,19 +10,37 @@ uniform mat4 mView;
 uniform mat4 mModelView;
 uniform mat4 mModelViewProj;
 
+// Packed vertices, positions in 16 bit steps across a box and octahedral normals, one color norm per draw
+uniform bool bQuantized;
+uniform vec3 vQuantizationOrigin;
+uniform vec3 vQuantizationScale;
+uniform float fMeshColorNorm;
+
 smooth out vec3 vEyeSpaceNormal;
 smooth out vec3 vEyeSpacePosition;
 smooth out vec3 vEyeSpaceLightPosition;
 smooth out float fFragColorNorm;
 
+// Unfolds the lower half of the octahedron the normal was projected on
+vec3 octahedralDecode(vec2 e)
+{
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0);
+	n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+	return normalize(n);
+}
+
 void main()
 {
-	vec4 hvPosition = vec4(vPosition, 1.0);
+	vec3 position = bQuantized ? vQuantizationOrigin + vPosition * vQuantizationScale : vPosition;
+	vec3 normal = bQuantized ? octahedralDecode(vNormal.xy) : vNormal;
+
+	vec4 hvPosition = vec4(position, 1.0);
 	gl_Position = mModelViewProj * hvPosition;
 
 	vEyeSpacePosition = (mModelView * hvPosition).xyz;
-	vEyeSpaceNormal = mat3(transpose(inverse(mModelView))) * vNormal;
+	vEyeSpaceNormal = mat3(transpose(inverse(mModelView))) * normal;
 	vEyeSpaceLightPosition = (mView * vec4(vLightPosition, 1)).xyz;
 
-	fFragColorNorm = fColorNorm;
+	fFragColorNorm = bQuantized ? fMeshColorNorm : fColorNorm;
 }
\ No newline at end of file
@@ -0,0 +1,28 @@
+#version 430 core
+
+// Builds the next level of the histogram pyramid, every node holds the sum of four consecutive nodes below
+layout(local_size_x = 64) in;
+
+layout(std430, binding = 1) buffer Pyramid { uint pyramid[]; };
+
+uniform uint uSourceOffset;
+uniform uint uSourceSize;
+uniform uint uTargetOffset;
+uniform uint uTargetSize;
+
+void main()
+{
+	uint node = gl_GlobalInvocationID.x + gl_GlobalInvocationID.y * gl_NumWorkGroups.x * gl_WorkGroupSize.x;
+	if (node >= uTargetSize)
+	{
+		return;
+	}
+
+	uint sum = 0u;
+	for (uint child = 4u * node; child < min(4u * node + 4u, uSourceSize); child++)
+	{
+		sum += pyramid[uSourceOffset + child];
+	}
+
+	pyramid[uTargetOffset + node] = sum;
+}
@@ -0,0 +1,38 @@
+#version 430 core
+
+// Counts the marching cubes triangles of every cell into the first level of the histogram pyramid
+layout(local_size_x = 4, local_size_y = 4, local_size_z = 4) in;
+
+layout(std430, binding = 0) readonly buffer TriangleTable { int triangleTable[]; };	// 16 entries per case
+layout(std430, binding = 1) writeonly buffer Pyramid { uint pyramid[]; };
+
+uniform sampler3D sVolume;
+uniform float fIsoValue;
+uniform ivec3 iNumCells;
+
+const ivec3 cornerOffsets[8] = ivec3[8](
+	ivec3(0, 0, 0), ivec3(1, 0, 0), ivec3(1, 1, 0), ivec3(0, 1, 0),
+	ivec3(0, 0, 1), ivec3(1, 0, 1), ivec3(1, 1, 1), ivec3(0, 1, 1));
+
+void main()
+{
+	ivec3 cell = ivec3(gl_GlobalInvocationID);
+	if (any(greaterThanEqual(cell, iNumCells)))
+	{
+		return;
+	}
+
+	int code = 0;
+	for (int i = 0; i < 8; i++)
+	{
+		code |= (texelFetch(sVolume, cell + cornerOffsets[i], 0).r < fIsoValue) ? (1 << i) : 0;
+	}
+
+	uint numTriangles = 0u;
+	while (numTriangles < 5u && triangleTable[16 * code + 3 * int(numTriangles)] != -1)
+	{
+		numTriangles++;
+	}
+
+	pyramid[cell.x + iNumCells.x * (cell.y + iNumCells.y * cell.z)] = numTriangles;
+}
@@ -0,0 +1,107 @@
+#version 430 core
+
+// Writes one marching cubes triangle per invocation, found by descending the histogram pyramid, as the
+// positions, flat normal and color norm of its three vertices, the layout of MeshVertexAttribute
+layout(local_size_x = 64) in;
+
+#define MAX_PYRAMID_LEVELS 16
+
+layout(std430, binding = 0) readonly buffer TriangleTable { int triangleTable[]; };	// 16 entries per case
+layout(std430, binding = 1) readonly buffer Pyramid { uint pyramid[]; };
+layout(std430, binding = 2) writeonly buffer Vertices { float vertices[]; };
+
+uniform sampler3D sVolume;
+uniform float fIsoValue;
+uniform float fColorNorm;
+uniform ivec3 iNumCells;
+uniform vec3 vOrigin;
+uniform vec3 vSpacing;
+
+uniform uint uLevelOffsets[MAX_PYRAMID_LEVELS];
+uniform uint uLevelSizes[MAX_PYRAMID_LEVELS];
+uniform int iNumLevels;
+uniform uint uNumTriangles;
+uniform uint uFirstFloat;	// Of the surface in the bound range of the vertex buffer
+
+const ivec3 cornerOffsets[8] = ivec3[8](
+	ivec3(0, 0, 0), ivec3(1, 0, 0), ivec3(1, 1, 0), ivec3(0, 1, 0),
+	ivec3(0, 0, 1), ivec3(1, 0, 1), ivec3(1, 1, 1), ivec3(0, 1, 1));
+
+const ivec2 edgeCorners[12] = ivec2[12](
+	ivec2(0, 1), ivec2(1, 2), ivec2(2, 3), ivec2(3, 0),
+	ivec2(4, 5), ivec2(5, 6), ivec2(6, 7), ivec2(7, 4),
+	ivec2(0, 4), ivec2(1, 5), ivec2(2, 6), ivec2(3, 7));
+
+// As MarchingCubes::vertexInterpolation
+vec3 interpolate(ivec3 p1, ivec3 p2, float value1, float value2)
+{
+	float mu = 0.0;
+	if (abs(fIsoValue - value1) < 0.00001) { mu = 0.0; }
+	else if (abs(fIsoValue - value2) < 0.00001) { mu = 1.0; }
+	else if (abs(value1 - value2) < 0.00001) { mu = 0.0; }
+	else { mu = (fIsoValue - value1) / (value2 - value1); }
+
+	vec3 position1 = vOrigin + vSpacing * vec3(p1);
+	vec3 position2 = vOrigin + vSpacing * vec3(p2);
+	return position1 + mu * (position2 - position1);
+}
+
+void main()
+{
+	uint triangle = gl_GlobalInvocationID.x + gl_GlobalInvocationID.y * gl_NumWorkGroups.x * gl_WorkGroupSize.x;
+	if (triangle >= uNumTriangles)
+	{
+		return;
+	}
+
+	// From the top down into the child whose run of triangles holds the one left, the first level holds cells
+	uint node = 0u;
+	uint remaining = triangle;
+	for (int level = iNumLevels - 2; level >= 0; level--)
+	{
+		uint child = 4u * node;
+		uint last = min(child + 4u, uLevelSizes[level]) - 1u;
+		for (; child < last; child++)
+		{
+			uint count = pyramid[uLevelOffsets[level] + child];
+			if (remaining < count)
+			{
+				break;
+			}
+
+			remaining -= count;
+		}
+
+		node = child;
+	}
+
+	ivec3 cell = ivec3(int(node % uint(iNumCells.x)), int((node / uint(iNumCells.x)) % uint(iNumCells.y)), int(node / uint(iNumCells.x * iNumCells.y)));
+	float values[8];
+	int code = 0;
+	for (int i = 0; i < 8; i++)
+	{
+		values[i] = texelFetch(sVolume, cell + cornerOffsets[i], 0).r;
+		code |= (values[i] < fIsoValue) ? (1 << i) : 0;
+	}
+
+	vec3 positions[3];
+	for (int i = 0; i < 3; i++)
+	{
+		ivec2 corners = edgeCorners[triangleTable[16 * code + 3 * int(remaining) + i]];
+		positions[i] = interpolate(cell + cornerOffsets[corners.x], cell + cornerOffsets[corners.y], values[corners.x], values[corners.y]);
+	}
+
+	vec3 normal = normalize(cross(positions[1] - positions[0], positions[2] - positions[0]));
+	uint first = uFirstFloat + 21u * triangle;
+	for (int i = 0; i < 3; i++)
+	{
+		uint vertex = first + 7u * uint(i);
+		vertices[vertex + 0u] = positions[i].x;
+		vertices[vertex + 1u] = positions[i].y;
+		vertices[vertex + 2u] = positions[i].z;
+		vertices[vertex + 3u] = normal.x;
+		vertices[vertex + 4u] = normal.y;
+		vertices[vertex + 5u] = normal.z;
+		vertices[vertex + 6u] = fColorNorm;
+	}
+}
@@ -0,0 +1,700 @@
+#pragma once
+#include <adaptive_octree.h>
+#include <marching_cubes.h>
+#include <algorithm>
+#include <cmath>
+#include <map>
+
+// Nodes classified by one task while refining a level
+#define ADAPTIVE_NODES_PER_TASK 64
+
+// Faces of a cell are -x, +x, -y, +y, -z and +z, the leaves across them are found from the cell just beyond
+#define FACES_PER_VOXEL 6
+
+static const int s_cornerOffsets[CORNERS_PER_VOXEL][3] = {
+	{0, 0, 0}, {1, 0, 0}, {1, 1, 0}, {0, 1, 0},
+	{0, 0, 1}, {1, 0, 1}, {1, 1, 1}, {0, 1, 1}
+};
+
+// Bit mask of the faces each edge lies on
+static std::vector<int> edgeFaces()
+{
+	std::vector<int> faces(EDGES_PER_VOXEL, 0);
+	for (int edge = 0; edge < EDGES_PER_VOXEL; edge++)
+	{
+		const int* c0 = s_cornerOffsets[MarchingCubesTables::edgeCorners[edge][0]];
+		const int* c1 = s_cornerOffsets[MarchingCubesTables::edgeCorners[edge][1]];
+		for (int axis = 0; axis < 3; axis++)
+		{
+			if (c0[axis] == c1[axis])
+			{
+				faces[edge] |= 1 << (2 * axis + c0[axis]);
+			}
+		}
+	}
+
+	return faces;
+}
+
+static const std::vector<int> s_edgeFaces = edgeFaces();
+
+// Offsets of the 6 face and 12 edge neighbours, the ones leaves are balanced against
+static std::vector<glm::ivec3> neighbourDirections()
+{
+	std::vector<glm::ivec3> directions;
+	for (int z = -1; z <= 1; z++)
+	{
+		for (int y = -1; y <= 1; y++)
+		{
+			for (int x = -1; x <= 1; x++)
+			{
+				int numAxes = (x != 0) + (y != 0) + (z != 0);
+				if (numAxes == 1 || numAxes == 2)
+				{
+					directions.push_back(glm::ivec3(x, y, z));
+				}
+			}
+		}
+	}
+
+	return directions;
+}
+
+static const std::vector<glm::ivec3> s_neighbourDirections = neighbourDirections();
+
+AdaptiveOctree::AdaptiveOctree(const Volume& volume, const MinMaxOctree& ranges, ThreadPool& pool)
+	: m_colorNorm(0.0f),
+	  m_errorTolerance(ADAPTIVE_ERROR_TOLERANCE),
+	  m_isoValue(0.0f),
+	  m_maxNormalAngle(ADAPTIVE_NORMAL_ANGLE),
+	  m_numLeaves(0),
+	  m_numTransitionTriangles(0),
+	  m_pool(pool),
+	  m_ranges(ranges),
+	  m_volume(volume) { }
+
+bool AdaptiveOctree::build(float isoValue, const std::atomic<bool>* cancel)
+{
+	m_isoValue = isoValue;
+	m_colorNorm = (isoValue - m_volume.min) / (m_volume.max - m_volume.min);
+	m_nodes.clear();
+	m_pointValues.clear();
+	m_numLeaves = 0;
+
+	// The root is the smallest power of two covering every cell, nodes are aligned to their size
+	int numCells = std::max(m_volume.numCellsX(), std::max(m_volume.numCellsY(), m_volume.numCellsZ()));
+	int rootSize = 1;
+	while (rootSize < numCells)
+	{
+		rootSize *= 2;
+	}
+
+	m_nodes.push_back({ glm::ivec3(0), rootSize, -1, NODE_LEAF });
+
+	// Refined a level at a time, the nodes of a level are classified in parallel and split afterwards
+	std::vector<int> level(1, 0);
+	std::vector<int> states;
+	while (!level.empty())
+	{
+		if (cancel != nullptr && *cancel)
+		{
+			return false;
+		}
+
+		states.resize(level.size());
+		int numTasks = (int)((level.size() + ADAPTIVE_NODES_PER_TASK - 1) / ADAPTIVE_NODES_PER_TASK);
+		m_pool.parallelFor(numTasks, [&](int task)
+		{
+			size_t end = std::min(level.size(), (size_t)(task + 1) * ADAPTIVE_NODES_PER_TASK);
+			for (size_t i = (size_t)task * ADAPTIVE_NODES_PER_TASK; i < end; i++)
+			{
+				states[i] = this->classify(m_nodes[level[i]], true);
+			}
+		});
+
+		std::vector<int> next;
+		for (size_t i = 0; i < level.size(); i++)
+		{
+			m_nodes[level[i]].state = states[i];
+			if (states[i] == NODE_SPLIT)
+			{
+				this->split(level[i]);
+				for (int child = 0; child < 8; child++)
+				{
+					next.push_back(m_nodes[level[i]].children + child);
+				}
+			}
+		}
+
+		level.swap(next);
+	}
+
+	this->balance();
+
+	for (const Node& node : m_nodes)
+	{
+		m_numLeaves += (node.state == NODE_LEAF);
+	}
+
+	return true;
+}
+
+size_t AdaptiveOctree::memory() const
+{
+	return m_nodes.capacity() * sizeof(Node) +
+		m_pointValues.size() * (sizeof(uint32_t) + sizeof(PointValue) + sizeof(void*)) +
+		m_vertices.size() * (sizeof(uint64_t) + sizeof(uint32_t) + sizeof(void*));
+}
+
+// Nodes reaching past the volume are clipped to it rather than split, so a volume of 2^n + 1 points does not end
+// up with a layer of single cell leaves along its far faces. Without refine nodes are only told apart from the
+// ones outside, as for the leaves balancing adds.
+int AdaptiveOctree::classify(const Node& node, bool refine) const
+{
+	if (node.origin.x >= m_volume.numCellsX() || node.origin.y >= m_volume.numCellsY() || node.origin.z >= m_volume.numCellsZ())
+	{
+		return NODE_OUTSIDE;
+	}
+
+	if (!refine || node.size == 1 || !this->range(node).contains(m_isoValue))
+	{
+		return NODE_LEAF;
+	}
+
+	return this->needsRefinement(node) ? NODE_SPLIT : NODE_LEAF;
+}
+
+// A node the surface passes through is split when the gradients at its corners spread further than the normal
+// angle, or when any of its points lies further from the trilinear interpolation of the corners than the error
+// tolerance, measured in cells along the gradient of that interpolation
+bool AdaptiveOctree::needsRefinement(const Node& node) const
+{
+	glm::ivec3 extent = this->end(node) - node.origin;
+	float values[CORNERS_PER_VOXEL];
+	glm::vec3 normals[CORNERS_PER_VOXEL];
+	glm::vec3 mean(0.0f);
+	for (int i = 0; i < CORNERS_PER_VOXEL; i++)
+	{
+		int x = node.origin.x + extent.x * s_cornerOffsets[i][0];
+		int y = node.origin.y + extent.y * s_cornerOffsets[i][1];
+		int z = node.origin.z + extent.z * s_cornerOffsets[i][2];
+		values[i] = m_volume.value(x, y, z);
+
+		glm::vec3 gradient = m_volume.gradient(x, y, z);
+		float length = glm::length(gradient);
+		normals[i] = (length > 0.0f) ? gradient / length : glm::vec3(0.0f);
+		mean += normals[i];
+	}
+
+	float meanLength = glm::length(mean);
+	if (meanLength == 0.0f)
+	{
+		return true;
+	}
+
+	float minCosine = cosf(glm::radians(m_maxNormalAngle));
+	for (int i = 0; i < CORNERS_PER_VOXEL; i++)
+	{
+		if (glm::length(normals[i]) > 0.0f && glm::dot(normals[i], mean / meanLength) < minCosine)
+		{
+			return true;
+		}
+	}
+
+	glm::vec3 gradient(
+		((values[1] - values[0]) + (values[2] - values[3]) + (values[5] - values[4]) + (values[6] - values[7])) / extent.x,
+		((values[3] - values[0]) + (values[2] - values[1]) + (values[7] - values[4]) + (values[6] - values[5])) / extent.y,
+		((values[4] - values[0]) + (values[5] - values[1]) + (values[7] - values[3]) + (values[6] - values[2])) / extent.z);
+	float maxError = m_errorTolerance * glm::length(gradient) / 4.0f;
+	if (maxError <= 0.0f)
+	{
+		return true;
+	}
+
+	// Along a row the interpolation is linear between its values at the two x faces
+	glm::vec3 scale = glm::vec3(1.0f) / glm::vec3(extent);
+	for (int k = 0; k <= extent.z; k++)
+	{
+		float w = k * scale.z;
+		for (int j = 0; j <= extent.y; j++)
+		{
+			float v = j * scale.y;
+			float low0 = values[0] + v * (values[3] - values[0]);
+			float low1 = values[4] + v * (values[7] - values[4]);
+			float high0 = values[1] + v * (values[2] - values[1]);
+			float high1 = values[5] + v * (values[6] - values[5]);
+			float low = low0 + w * (low1 - low0);
+			float high = high0 + w * (high1 - high0);
+
+			const float* row = m_volume.values + m_volume.index(node.origin.x, node.origin.y + j, node.origin.z + k);
+			for (int i = 0; i <= extent.x; i++)
+			{
+				if (std::abs(row[i] - (low + i * scale.x * (high - low))) > maxError)
+				{
+					return true;
+				}
+			}
+		}
+	}
+
+	return false;
+}
+
+// Nodes of whole min max blocks take their range from the min max octree, smaller ones read their points
+ValueRange AdaptiveOctree::range(const Node& node) const
+{
+	if (node.size >= MINMAX_BLOCK_SIZE)
+	{
+		int level = 0;
+		while ((MINMAX_BLOCK_SIZE << level) < node.size)
+		{
+			level++;
+		}
+
+		return m_ranges.node(level, node.origin.x / node.size, node.origin.y / node.size, node.origin.z / node.size);
+	}
+
+	glm::ivec3 end = this->end(node);
+	ValueRange range = { INFINITY, -INFINITY };
+	for (int z = node.origin.z; z <= end.z; z++)
+	{
+		for (int y = node.origin.y; y <= end.y; y++)
+		{
+			const float* row = m_volume.values + m_volume.index(0, y, z);
+			for (int x = node.origin.x; x <= end.x; x++)
+			{
+				range.min = std::min(range.min, row[x]);
+				range.max = std::max(range.max, row[x]);
+			}
+		}
+	}
+
+	return range;
+}
+
+// Children are ordered by x, then y, then z being in the upper half, as locate picks them
+void AdaptiveOctree::split(int node)
+{
+	Node parent = m_nodes[node];
+	int half = parent.size / 2;
+
+	m_nodes[node].children = (int)m_nodes.size();
+	m_nodes[node].state = NODE_SPLIT;
+	for (int i = 0; i < 8; i++)
+	{
+		glm::ivec3 origin = parent.origin + half * glm::ivec3(i & 1, (i >> 1) & 1, i >> 2);
+		m_nodes.push_back({ origin, half, -1, NODE_LEAF });
+	}
+}
+
+void AdaptiveOctree::splitLeaf(int node, std::vector<int>& leaves)
+{
+	this->split(node);
+	int children = m_nodes[node].children;
+	for (int child = children; child < children + 8; child++)
+	{
+		m_nodes[child].state = this->classify(m_nodes[child], false);
+		if (m_nodes[child].state == NODE_LEAF)
+		{
+			leaves.push_back(child);
+		}
+	}
+}
+
+// Every leaf checks the leaf beyond each of its faces and edges, one more than twice its size is split and both
+// are checked again. A larger leaf sharing any part of a face or edge covers all of it, so one cell beyond
+// each is enough.
+void AdaptiveOctree::balance()
+{
+	std::vector<int> queue;
+	for (int i = 0; i < (int)m_nodes.size(); i++)
+	{
+		if (m_nodes[i].state == NODE_LEAF)
+		{
+			queue.push_back(i);
+		}
+	}
+
+	while (!queue.empty())
+	{
+		int leaf = queue.back();
+		queue.pop_back();
+		if (m_nodes[leaf].state != NODE_LEAF)
+		{
+			continue;
+		}
+
+		Node node = m_nodes[leaf];
+		for (const glm::ivec3& direction : s_neighbourDirections)
+		{
+			glm::ivec3 cell = node.origin;
+			for (int axis = 0; axis < 3; axis++)
+			{
+				cell[axis] += (direction[axis] < 0) ? -1 : (direction[axis] > 0) ? node.size : 0;
+			}
+
+			int neighbour = this->locate(cell);
+			if (neighbour >= 0 && m_nodes[neighbour].size > 2 * node.size)
+			{
+				this->splitLeaf(neighbour, queue);
+				queue.push_back(leaf);
+				break;
+			}
+		}
+	}
+}
+
+int AdaptiveOctree::locate(const glm::ivec3& cell) const
+{
+	if (cell.x < 0 || cell.y < 0 || cell.z < 0 ||
+		cell.x >= m_volume.numCellsX() || cell.y >= m_volume.numCellsY() || cell.z >= m_volume.numCellsZ())
+	{
+		return -1;
+	}
+
+	int node = 0;
+	while (m_nodes[node].state == NODE_SPLIT)
+	{
+		const Node& parent = m_nodes[node];
+		int half = parent.size / 2;
+		node = parent.children +
+			(cell.x >= parent.origin.x + half) +
+			2 * (cell.y >= parent.origin.y + half) +
+			4 * (cell.z >= parent.origin.z + half);
+	}
+
+	return (m_nodes[node].state == NODE_LEAF) ? node : -1;
+}
+
+// Only the corners of leaves beside a coarser one can lie inside the boundary of another leaf
+bool AdaptiveOctree::hasCoarserNeighbour(const Node& node) const
+{
+	for (const glm::ivec3& direction : s_neighbourDirections)
+	{
+		glm::ivec3 cell = node.origin;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			cell[axis] += (direction[axis] < 0) ? -1 : (direction[axis] > 0) ? node.size : 0;
+		}
+
+		int neighbour = this->locate(cell);
+		if (neighbour >= 0 && m_nodes[neighbour].size > node.size)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+glm::ivec3 AdaptiveOctree::point(uint32_t index) const
+{
+	int x = (int)(index % m_volume.numPointsX);
+	int y = (int)((index / m_volume.numPointsX) % m_volume.numPointsY);
+	int z = (int)(index / ((uint32_t)m_volume.numPointsX * m_volume.numPointsY));
+
+	return glm::ivec3(x, y, z);
+}
+
+// The largest leaf around the point that does not have it as a corner decides its value, interpolated linearly
+// along the edge or bilinearly over the face the point lies inside. Its corners can in turn lie on an even larger
+// leaf, so they are resolved the same way first.
+const AdaptiveOctree::PointValue& AdaptiveOctree::pointValue(const glm::ivec3& p)
+{
+	uint32_t index = this->pointIndex(p);
+	auto found = m_pointValues.find(index);
+	if (found != m_pointValues.end())
+	{
+		return found->second;
+	}
+
+	int coarsest = -1;
+	for (int i = 0; i < CORNERS_PER_VOXEL; i++)
+	{
+		int leaf = this->locate(p - glm::ivec3(i & 1, (i >> 1) & 1, i >> 2));
+		if (leaf < 0)
+		{
+			continue;
+		}
+
+		glm::ivec3 origin = m_nodes[leaf].origin;
+		glm::ivec3 end = this->end(m_nodes[leaf]);
+		bool corner = (p.x == origin.x || p.x == end.x) && (p.y == origin.y || p.y == end.y) && (p.z == origin.z || p.z == end.z);
+		if (!corner && (coarsest < 0 || m_nodes[leaf].size > m_nodes[coarsest].size))
+		{
+			coarsest = leaf;
+		}
+	}
+
+	PointValue value = { m_volume.value(p.x, p.y, p.z), -1, 0, 0 };
+	if (coarsest >= 0)
+	{
+		glm::ivec3 origin = m_nodes[coarsest].origin;
+		glm::ivec3 extent = this->end(m_nodes[coarsest]) - origin;
+		int axes[2];
+		int numAxes = 0;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			if (p[axis] != origin[axis] && p[axis] != origin[axis] + extent[axis])
+			{
+				axes[numAxes++] = axis;
+			}
+		}
+
+		if (numAxes == 1)
+		{
+			glm::ivec3 begin = p;
+			glm::ivec3 end = p;
+			begin[axes[0]] = origin[axes[0]];
+			end[axes[0]] = origin[axes[0]] + extent[axes[0]];
+
+			float t = (float)(p[axes[0]] - begin[axes[0]]) / extent[axes[0]];
+			float beginValue = this->pointValue(begin).value;
+			float endValue = this->pointValue(end).value;
+
+			value.value = beginValue + t * (endValue - beginValue);
+			value.axis = axes[0];
+			value.edgeBegin = this->pointIndex(begin);
+			value.edgeEnd = this->pointIndex(end);
+		}
+		else
+		{
+			float values[4];
+			for (int i = 0; i < 4; i++)
+			{
+				glm::ivec3 corner = p;
+				corner[axes[0]] = origin[axes[0]] + (i & 1) * extent[axes[0]];
+				corner[axes[1]] = origin[axes[1]] + (i >> 1) * extent[axes[1]];
+				values[i] = this->pointValue(corner).value;
+			}
+
+			float s = (float)(p[axes[0]] - origin[axes[0]]) / extent[axes[0]];
+			float t = (float)(p[axes[1]] - origin[axes[1]]) / extent[axes[1]];
+			float low = values[0] + s * (values[1] - values[0]);
+			float high = values[2] + s * (values[3] - values[2]);
+			value.value = low + t * (high - low);
+		}
+	}
+
+	return m_pointValues.emplace(index, value).first->second;
+}
+
+// Vertex where the surface cuts a leaf edge. An edge inside the edge of a coarser leaf is interpolated over that
+// whole edge, so the leaves on both sides of the coarse one weld to the same vertex.
+uint32_t AdaptiveOctree::edgeVertex(
+	glm::ivec3 p1,
+	glm::ivec3 p2,
+	float value1,
+	float value2,
+	int axis,
+	const PointValue* point1,
+	const PointValue* point2,
+	IsoSurface& surface)
+{
+	const PointValue* edge = (point1 != nullptr && point1->axis == axis) ? point1 : (point2 != nullptr && point2->axis == axis) ? point2 : nullptr;
+	if (edge != nullptr)
+	{
+		p1 = this->point(edge->edgeBegin);
+		p2 = this->point(edge->edgeEnd);
+		value1 = this->pointValue(p1).value;
+		value2 = this->pointValue(p2).value;
+	}
+
+	uint64_t key = ((uint64_t)this->pointIndex(p1) << 32) | this->pointIndex(p2);
+	auto found = m_vertices.find(key);
+	if (found != m_vertices.end())
+	{
+		return found->second;
+	}
+
+	const Volume& volume = m_volume;
+	float mu = (float)MarchingCubes::interpolationWeight(m_isoValue, value1, value2);
+
+	glm::vec3 position1 = volume.point(p1.x, p1.y, p1.z);
+	glm::vec3 position2 = volume.point(p2.x, p2.y, p2.z);
+	glm::vec3 gradient1 = volume.gradient(p1.x, p1.y, p1.z);
+	glm::vec3 gradient2 = volume.gradient(p2.x, p2.y, p2.z);
+
+	// The surface faces towards lower values, as in IsoSurfaceExtractor::addEdgeVertex
+	glm::vec3 normal = -(gradient1 + mu * (gradient2 - gradient1));
+	float length = glm::length(normal);
+
+	MeshVertexAttribute vertex;
+	vertex.position = position1 + mu * (position2 - position1);
+	vertex.normal = (length > 0.0f) ? normal / length : glm::normalize(position1 - position2);
+	vertex.colorNorm = m_colorNorm;
+
+	uint32_t index = (uint32_t)surface.vertices.size();
+	surface.vertices.push_back(vertex);
+	m_vertices.emplace(key, index);
+
+	return index;
+}
+
+void AdaptiveOctree::extract(IsoSurface& surface)
+{
+	surface.vertices.clear();
+	surface.indices.clear();
+	m_vertices.clear();
+	m_numTransitionTriangles = 0;
+
+	std::vector<LeafOutput> outputs;
+	std::vector<int> leafOutputs(m_nodes.size(), -1);
+	for (int leaf = 0; leaf < (int)m_nodes.size(); leaf++)
+	{
+		Node node = m_nodes[leaf];
+		if (node.state != NODE_LEAF)
+		{
+			continue;
+		}
+
+		glm::ivec3 extent = this->end(node) - node.origin;
+		// Leaves with no coarser neighbour read their corners straight from the volume
+		bool constrained = this->hasCoarserNeighbour(node);
+		glm::ivec3 corners[CORNERS_PER_VOXEL];
+		float values[CORNERS_PER_VOXEL];
+		const PointValue* points[CORNERS_PER_VOXEL];
+		int code = 0;
+		for (int i = 0; i < CORNERS_PER_VOXEL; i++)
+		{
+			corners[i] = node.origin + extent * glm::ivec3(s_cornerOffsets[i][0], s_cornerOffsets[i][1], s_cornerOffsets[i][2]);
+			points[i] = constrained ? &this->pointValue(corners[i]) : nullptr;
+			values[i] = constrained ? points[i]->value : m_volume.value(corners[i].x, corners[i].y, corners[i].z);
+			code |= (values[i] < m_isoValue) << i;
+		}
+
+		if (code == 0 || code == MARCHING_CUBES_CASES - 1)
+		{
+			continue;
+		}
+
+		int edges = MarchingCubesTables::edgeTable[code];
+		uint32_t edgeVertices[EDGES_PER_VOXEL];
+		for (int edge = 0; edge < EDGES_PER_VOXEL; edge++)
+		{
+			if ((edges & (1 << edge)) == 0)
+			{
+				continue;
+			}
+
+			// Always from the lower to the upper point so every leaf on the edge keys it the same
+			int c1 = MarchingCubesTables::edgeCorners[edge][0];
+			int c2 = MarchingCubesTables::edgeCorners[edge][1];
+			if (corners[c2].x + corners[c2].y + corners[c2].z < corners[c1].x + corners[c1].y + corners[c1].z)
+			{
+				std::swap(c1, c2);
+			}
+
+			int axis = (corners[c1].x != corners[c2].x) ? 0 : (corners[c1].y != corners[c2].y) ? 1 : 2;
+			edgeVertices[edge] = this->edgeVertex(corners[c1], corners[c2], values[c1], values[c2], axis, points[c1], points[c2], surface);
+		}
+
+		leafOutputs[leaf] = (int)outputs.size();
+		outputs.push_back({ leaf, code, (uint32_t)surface.indices.size() });
+		for (int i = 0; i < MarchingCubes::numVertices(code); i++)
+		{
+			surface.indices.push_back(edgeVertices[MarchingCubesTables::triangleTable[code][i]]);
+		}
+	}
+
+	// The four leaves beside a face of a coarser leaf follow the bilinear contour across it while the coarse leaf
+	// cuts straight from edge to edge, the outlines of both sides are gathered per coarse face and the cracks
+	// between them closed
+	std::map<uint64_t, std::vector<std::pair<uint32_t, uint32_t>>> cracks;
+	for (const LeafOutput& output : outputs)
+	{
+		const Node& node = m_nodes[output.node];
+		for (int face = 0; face < FACES_PER_VOXEL; face++)
+		{
+			glm::ivec3 cell = node.origin;
+			cell[face / 2] += (face & 1) ? node.size : -1;
+
+			int neighbour = this->locate(cell);
+			if (neighbour >= 0 && m_nodes[neighbour].size > node.size)
+			{
+				this->faceSegments(output, face, surface, cracks[((uint64_t)neighbour << 3) | (face ^ 1)]);
+			}
+		}
+	}
+
+	for (auto& crack : cracks)
+	{
+		int coarse = leafOutputs[crack.first >> 3];
+		if (coarse >= 0)
+		{
+			this->faceSegments(outputs[coarse], (int)(crack.first & 7), surface, crack.second);
+		}
+
+		this->closeCrack(crack.second, surface);
+	}
+}
+
+// Triangle edges of a leaf used only once lie on its boundary, the ones on the given face are appended reversed
+// so the outline turns the way a transition polygon joined to them has to
+void AdaptiveOctree::faceSegments(const LeafOutput& leaf, int face, const IsoSurface& surface, std::vector<std::pair<uint32_t, uint32_t>>& segments) const
+{
+	const int* edges = MarchingCubesTables::triangleTable[leaf.code];
+	int numIndices = MarchingCubes::numVertices(leaf.code);
+	for (int i = 0; i < numIndices; i++)
+	{
+		int next = 3 * (i / 3) + (i + 1) % 3;
+		if ((s_edgeFaces[edges[i]] & s_edgeFaces[edges[next]] & (1 << face)) == 0)
+		{
+			continue;
+		}
+
+		int uses = 0;
+		for (int j = 0; j < numIndices; j++)
+		{
+			int other = 3 * (j / 3) + (j + 1) % 3;
+			uses += (edges[j] == edges[i] && edges[other] == edges[next]) || (edges[j] == edges[next] && edges[other] == edges[i]);
+		}
+
+		if (uses == 1)
+		{
+			segments.push_back({ surface.indices[leaf.firstIndex + next], surface.indices[leaf.firstIndex + i] });
+		}
+	}
+}
+
+// Every vertex of a crack outline starts exactly one segment, following them gives closed loops that are fanned
+// into transition triangles. An outline that does not close up is left open rather than patched wrongly.
+void AdaptiveOctree::closeCrack(const std::vector<std::pair<uint32_t, uint32_t>>& segments, IsoSurface& surface)
+{
+	std::map<uint32_t, uint32_t> next;
+	for (const std::pair<uint32_t, uint32_t>& segment : segments)
+	{
+		if (!next.emplace(segment.first, segment.second).second)
+		{
+			return;
+		}
+	}
+
+	std::vector<uint32_t> loop;
+	while (!next.empty())
+	{
+		uint32_t first = next.begin()->first;
+		uint32_t vertex = first;
+		loop.clear();
+		do
+		{
+			auto found = next.find(vertex);
+			if (found == next.end())
+			{
+				return;
+			}
+
+			loop.push_back(vertex);
+			vertex = found->second;
+			next.erase(found);
+		} while (vertex != first);
+
+		for (size_t i = 1; i + 1 < loop.size(); i++)
+		{
+			surface.indices.push_back(loop[0]);
+			surface.indices.push_back(loop[i]);
+			surface.indices.push_back(loop[i + 1]);
+			m_numTransitionTriangles++;
+		}
+	}
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <brick_welder.h>
+#include <algorithm>
+#include <cmath>
+
+// Distance from the nearest grid point below which a vertex is taken to sit on that point
+#define BRICK_WELD_TOLERANCE 1.0e-3f
+
+BrickWelder::BrickWelder(const glm::ivec3& numPoints)
+	: m_numPoints(numPoints),
+	  m_numVertices(0) { }
+
+uint64_t BrickWelder::edgeKey(const glm::vec3& point) const
+{
+	glm::vec3 nearest = glm::floor(point + 0.5f);
+	glm::vec3 distance = glm::abs(point - nearest);
+	int axis = 3;
+	if (std::max(distance.x, std::max(distance.y, distance.z)) >= BRICK_WELD_TOLERANCE)
+	{
+		axis = (distance.x >= distance.y && distance.x >= distance.z) ? 0 : (distance.y >= distance.z) ? 1 : 2;
+		nearest[axis] = floor(point[axis]);
+	}
+
+	glm::ivec3 p = glm::ivec3(nearest);
+	return 4 * ((uint64_t)p.x + (uint64_t)m_numPoints.x * ((uint64_t)p.y + (uint64_t)m_numPoints.y * p.z)) + axis;
+}
+
+void BrickWelder::weld(const IsoSurface& brickSurface, const Volume& brick, const glm::ivec3& firstPoint, IsoSurface& chunk)
+{
+	// Faces of the brick that another brick shares, only vertices on those can have a twin
+	glm::ivec3 lastPoint = glm::ivec3(brick.numPointsX, brick.numPointsY, brick.numPointsZ) - 1;
+	bool sharedLow[3];
+	bool sharedHigh[3];
+	for (int axis = 0; axis < 3; axis++)
+	{
+		sharedLow[axis] = firstPoint[axis] > 0;
+		sharedHigh[axis] = firstPoint[axis] + lastPoint[axis] < m_numPoints[axis] - 1;
+	}
+
+	chunk.vertices.clear();
+	chunk.indices.clear();
+	m_remap.resize(brickSurface.vertices.size());
+	for (size_t v = 0; v < brickSurface.vertices.size(); v++)
+	{
+		const MeshVertexAttribute& vertex = brickSurface.vertices[v];
+		glm::vec3 point = (vertex.position - brick.origin) / brick.spacing;
+		bool onSharedFace = false;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			onSharedFace = onSharedFace ||
+				(sharedLow[axis] && point[axis] < BRICK_WELD_TOLERANCE) ||
+				(sharedHigh[axis] && point[axis] > lastPoint[axis] - BRICK_WELD_TOLERANCE);
+		}
+
+		uint32_t index = (uint32_t)(m_numVertices + chunk.vertices.size());
+		if (onSharedFace)
+		{
+			auto inserted = m_welded.insert(std::make_pair(this->edgeKey(point + glm::vec3(firstPoint)), index));
+			if (!inserted.second)
+			{
+				m_remap[v] = inserted.first->second;
+				continue;
+			}
+		}
+
+		m_remap[v] = index;
+		chunk.vertices.push_back(vertex);
+	}
+
+	for (uint32_t index : brickSurface.indices)
+	{
+		chunk.indices.push_back(m_remap[index]);
+	}
+
+	m_numVertices += chunk.vertices.size();
+}
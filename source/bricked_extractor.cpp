@@ -0,0 +1,134 @@
+#pragma once
+#include <bricked_extractor.h>
+#include <brick_welder.h>
+#include <cstdio>
+
+BrickedExtractor::BrickedExtractor(BrickedVolume& volume, ThreadPool& pool)
+	: m_bricksDone(0),
+	  m_bricksTotal(0),
+	  m_cancel(nullptr),
+	  m_indexed(false),
+	  m_method(ISOSURFACE_MARCHING_CUBES),
+	  m_pool(pool),
+	  m_volume(volume) { }
+
+float BrickedExtractor::progress() const
+{
+	int total = m_bricksTotal;
+	return (total > 0) ? (float)m_bricksDone / total : 0.0f;
+}
+
+bool BrickedExtractor::extract(float isoValue, IsoSurface& surface)
+{
+	std::vector<IsoSurface> surfaces;
+	bool completed = this->extract(std::vector<float>(1, isoValue), surfaces);
+	surface.vertices.swap(surfaces[0].vertices);
+	surface.indices.swap(surfaces[0].indices);
+
+	return completed;
+}
+
+bool BrickedExtractor::extract(const std::vector<float>& isoValues, std::vector<IsoSurface>& surfaces)
+{
+	surfaces.assign(isoValues.size(), IsoSurface());
+	return this->extractBricks(isoValues, m_indexed, [&](size_t level, const IsoSurface& chunk)
+	{
+		IsoSurface& surface = surfaces[level];
+		surface.vertices.insert(surface.vertices.end(), chunk.vertices.begin(), chunk.vertices.end());
+		surface.indices.insert(surface.indices.end(), chunk.indices.begin(), chunk.indices.end());
+		return true;
+	});
+}
+
+bool BrickedExtractor::extract(float isoValue, MeshWriter& writer)
+{
+	return this->extractBricks(std::vector<float>(1, isoValue), m_indexed && writer.sharesVertices(), [&](size_t, const IsoSurface& chunk)
+	{
+		return writer.write(chunk);
+	});
+}
+
+bool BrickedExtractor::extractBricks(const std::vector<float>& isoValues, bool indexed, ChunkFunction emit)
+{
+	m_bricksDone = 0;
+
+	IsoSurfaceMethod method = m_method;
+	if (method == ISOSURFACE_SURFACE_NETS)
+	{
+		fprintf(stderr, "Surface nets are not extracted per brick, using marching cubes\n");
+		method = ISOSURFACE_MARCHING_CUBES;
+	}
+	else if (method == ISOSURFACE_ADAPTIVE)
+	{
+		fprintf(stderr, "Adaptive octrees do not cross bricks, using marching cubes\n");
+		method = ISOSURFACE_MARCHING_CUBES;
+	}
+
+	// A brick holds a cell of a surface when its value range does, as for single cells
+	const glm::ivec3& numBricks = m_volume.numBricks();
+	std::vector<int> active;
+	for (int brick = 0; brick < numBricks.x * numBricks.y * numBricks.z; brick++)
+	{
+		for (float isoValue : isoValues)
+		{
+			if (m_volume.brickMin(brick) < isoValue && isoValue <= m_volume.brickMax(brick))
+			{
+				active.push_back(brick);
+				break;
+			}
+		}
+	}
+
+	m_bricksTotal = (int)active.size();
+
+	glm::ivec3 numPoints(m_volume.numPointsX(), m_volume.numPointsY(), m_volume.numPointsZ());
+	std::vector<BrickWelder> welders(isoValues.size(), BrickWelder(numPoints));
+	std::vector<IsoSurface> brickSurfaces;
+	IsoSurface chunk;
+	for (int brick : active)
+	{
+		if (this->cancelled())
+		{
+			return false;
+		}
+
+		std::shared_ptr<const Brick> data = m_volume.brick(brick);
+		if (data == nullptr)
+		{
+			return false;
+		}
+
+		IsoSurfaceExtractor extractor(data->volume, m_pool);
+		extractor.setIndexed(indexed);
+		extractor.setMethod(method);
+		extractor.setCancelFlag(m_cancel);
+		if (!extractor.extract(isoValues, brickSurfaces))
+		{
+			return false;
+		}
+
+		for (size_t level = 0; level < isoValues.size(); level++)
+		{
+			IsoSurface& brickSurface = brickSurfaces[level];
+			if (!brickSurface.indexed())
+			{
+				if (!brickSurface.vertices.empty() && !emit(level, brickSurface))
+				{
+					return false;
+				}
+
+				continue;
+			}
+
+			welders[level].weld(brickSurface, data->volume, data->firstPoint, chunk);
+			if (!emit(level, chunk))
+			{
+				return false;
+			}
+		}
+
+		m_bricksDone++;
+	}
+
+	return true;
+}
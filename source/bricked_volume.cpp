@@ -0,0 +1,321 @@
+#pragma once
+#include <bricked_volume.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#define BRICK_FILE_MAGIC 0x564b5242u	// "BRKV"
+#define BRICK_FILE_VERSION 1
+
+// Brick file layout, the header is followed by the values of every brick with its ghost points, x fastest,
+// and then by the brick index at indexOffset
+struct BrickFileHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	int32_t numPoints[3];
+	int32_t brickCells;
+	float origin[3];
+	float spacing[3];
+	float min;
+	float max;
+	uint64_t numBricks;
+	uint64_t indexOffset;
+};
+
+static int seekFile(FILE* file, uint64_t offset)
+{
+#ifdef _WIN32
+	return _fseeki64(file, (long long)offset, SEEK_SET);
+#else
+	return fseeko(file, (off_t)offset, SEEK_SET);
+#endif
+}
+
+// Brick x, y, z owns the cells from x * brickCells on, the last brick of an axis the cells that are left
+BrickedVolume::BrickInfo BrickedVolume::brickInfo(const glm::ivec3& numPoints, int brickCells, int x, int y, int z)
+{
+	BrickInfo info;
+	memset(&info, 0, sizeof(BrickInfo));
+
+	int brick[3] = { x, y, z };
+	for (int axis = 0; axis < 3; axis++)
+	{
+		int first = brick[axis] * brickCells;
+		int last = std::min(first + brickCells, numPoints[axis] - 1);
+		info.ghostLow[axis] = std::min(BRICK_GHOST_POINTS, first);
+		info.ghostHigh[axis] = std::min(BRICK_GHOST_POINTS, numPoints[axis] - 1 - last);
+		info.firstPoint[axis] = first - info.ghostLow[axis];
+		info.numPoints[axis] = last + info.ghostHigh[axis] - info.firstPoint[axis] + 1;
+	}
+
+	return info;
+}
+
+bool BrickedVolume::write(
+	const std::string& path,
+	int numPointsX,
+	int numPointsY,
+	int numPointsZ,
+	const glm::vec3& origin,
+	const glm::vec3& spacing,
+	SliceFunction readSlice,
+	int brickCells)
+{
+	glm::ivec3 numPoints(numPointsX, numPointsY, numPointsZ);
+	glm::ivec3 numBricks = glm::max((numPoints - 2) / brickCells + 1, glm::ivec3(1));
+
+	BrickFileHeader header;
+	memset(&header, 0, sizeof(BrickFileHeader));
+	header.magic = BRICK_FILE_MAGIC;
+	header.version = BRICK_FILE_VERSION;
+	header.brickCells = brickCells;
+	header.min = INFINITY;
+	header.max = -INFINITY;
+	header.numBricks = (uint64_t)numBricks.x * numBricks.y * numBricks.z;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		header.numPoints[axis] = numPoints[axis];
+		header.origin[axis] = origin[axis];
+		header.spacing[axis] = spacing[axis];
+	}
+
+	// Written under a temporary name and renamed as the isosurface cache files are
+	std::string tempPath = path + ".tmp";
+	FILE* file = fopen(tempPath.c_str(), "wb");
+	if (file == nullptr)
+	{
+		fprintf(stderr, "Failed to write volume brick file %s\n", tempPath.c_str());
+		return false;
+	}
+
+	bool written = fwrite(&header, sizeof(BrickFileHeader), 1, file) == 1;
+	uint64_t offset = sizeof(BrickFileHeader);
+	size_t sliceSize = (size_t)numPointsX * numPointsY;
+	std::vector<BrickInfo> bricks;
+	std::vector<float> slices;
+	std::vector<float> values;
+	for (int z = 0; z < numBricks.z && written; z++)
+	{
+		// Every brick of the layer stores the same point layers, ghost points included
+		BrickInfo layer = brickInfo(numPoints, brickCells, 0, 0, z);
+		slices.resize(sliceSize * layer.numPoints[2]);
+		for (int slice = 0; slice < layer.numPoints[2] && written; slice++)
+		{
+			written = readSlice(layer.firstPoint[2] + slice, slices.data() + slice * sliceSize);
+		}
+
+		for (int y = 0; y < numBricks.y && written; y++)
+		{
+			for (int x = 0; x < numBricks.x && written; x++)
+			{
+				BrickInfo info = brickInfo(numPoints, brickCells, x, y, z);
+				info.offset = offset;
+				info.min = INFINITY;
+				info.max = -INFINITY;
+
+				values.resize((size_t)info.numPoints[0] * info.numPoints[1] * info.numPoints[2]);
+				float* value = values.data();
+				for (int k = 0; k < info.numPoints[2]; k++)
+				{
+					bool ghostZ = k < info.ghostLow[2] || k >= info.numPoints[2] - info.ghostHigh[2];
+					for (int j = 0; j < info.numPoints[1]; j++)
+					{
+						bool ghostY = j < info.ghostLow[1] || j >= info.numPoints[1] - info.ghostHigh[1];
+						const float* row = slices.data() + k * sliceSize + (size_t)(info.firstPoint[1] + j) * numPointsX + info.firstPoint[0];
+						memcpy(value, row, info.numPoints[0] * sizeof(float));
+						if (!ghostZ && !ghostY)
+						{
+							for (int i = info.ghostLow[0]; i < info.numPoints[0] - info.ghostHigh[0]; i++)
+							{
+								info.min = std::min(info.min, row[i]);
+								info.max = std::max(info.max, row[i]);
+							}
+						}
+
+						value += info.numPoints[0];
+					}
+				}
+
+				written = fwrite(values.data(), sizeof(float), values.size(), file) == values.size();
+				offset += values.size() * sizeof(float);
+				header.min = std::min(header.min, info.min);
+				header.max = std::max(header.max, info.max);
+				bricks.push_back(info);
+			}
+		}
+	}
+
+	header.indexOffset = offset;
+	written = written &&
+		fwrite(bricks.data(), sizeof(BrickInfo), bricks.size(), file) == bricks.size() &&
+		seekFile(file, 0) == 0 &&
+		fwrite(&header, sizeof(BrickFileHeader), 1, file) == 1;
+	fclose(file);
+
+	remove(path.c_str());
+	if (!written || rename(tempPath.c_str(), path.c_str()) != 0)
+	{
+		fprintf(stderr, "Failed to write volume brick file %s\n", path.c_str());
+		remove(tempPath.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+BrickedVolume::BrickedVolume(const std::string& path, size_t memoryBudget)
+	: m_brickCells(0),
+	  m_file(nullptr),
+	  m_max(0),
+	  m_memory(0),
+	  m_memoryBudget(memoryBudget),
+	  m_min(0),
+	  m_numBricks(0),
+	  m_numPoints(0),
+	  m_numReads(0),
+	  m_origin(0.0f),
+	  m_peakMemory(0),
+	  m_spacing(0.0f)
+{
+	FILE* file = fopen(path.c_str(), "rb");
+	if (file == nullptr)
+	{
+		fprintf(stderr, "Failed to open volume brick file %s\n", path.c_str());
+		return;
+	}
+
+	BrickFileHeader header;
+	bool read = fread(&header, sizeof(BrickFileHeader), 1, file) == 1 &&
+		header.magic == BRICK_FILE_MAGIC && header.version == BRICK_FILE_VERSION;
+	if (read)
+	{
+		m_bricks.resize(header.numBricks);
+		read = seekFile(file, header.indexOffset) == 0 &&
+			fread(m_bricks.data(), sizeof(BrickInfo), m_bricks.size(), file) == m_bricks.size();
+	}
+
+	if (!read)
+	{
+		fprintf(stderr, "Ignoring invalid volume brick file %s\n", path.c_str());
+		m_bricks.clear();
+		fclose(file);
+		return;
+	}
+
+	m_brickCells = header.brickCells;
+	m_numPoints = glm::ivec3(header.numPoints[0], header.numPoints[1], header.numPoints[2]);
+	m_numBricks = glm::max((m_numPoints - 2) / m_brickCells + 1, glm::ivec3(1));
+	m_origin = glm::vec3(header.origin[0], header.origin[1], header.origin[2]);
+	m_spacing = glm::vec3(header.spacing[0], header.spacing[1], header.spacing[2]);
+	m_min = header.min;
+	m_max = header.max;
+	m_file = file;
+}
+
+BrickedVolume::~BrickedVolume()
+{
+	if (m_file != nullptr)
+	{
+		fclose(m_file);
+	}
+}
+
+std::shared_ptr<const Brick> BrickedVolume::brick(int brick)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto found = m_lookup.find(brick);
+		if (found != m_lookup.end())
+		{
+			m_entries.splice(m_entries.begin(), m_entries, found->second);
+			return found->second->data;
+		}
+	}
+
+	// Read without holding the cache so other threads keep finding their bricks meanwhile
+	std::shared_ptr<const Brick> data = this->readBrick(brick);
+	if (data == nullptr)
+	{
+		return nullptr;
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto found = m_lookup.find(brick);
+	if (found != m_lookup.end())
+	{
+		m_entries.splice(m_entries.begin(), m_entries, found->second);
+		return found->second->data;
+	}
+
+	size_t bytes = data->values.size() * sizeof(float);
+	while (!m_entries.empty() && m_memory + bytes > m_memoryBudget)
+	{
+		m_memory -= m_entries.back().bytes;
+		m_lookup.erase(m_entries.back().brick);
+		m_entries.pop_back();
+	}
+
+	m_entries.push_front(Entry{ brick, data, bytes });
+	m_lookup[brick] = m_entries.begin();
+	m_memory += bytes;
+	m_peakMemory = std::max(m_peakMemory, m_memory);
+
+	return data;
+}
+
+std::shared_ptr<const Brick> BrickedVolume::readBrick(int brick)
+{
+	const BrickInfo& info = m_bricks[brick];
+	std::shared_ptr<Brick> data = std::make_shared<Brick>();
+	data->values.resize((size_t)info.numPoints[0] * info.numPoints[1] * info.numPoints[2]);
+	{
+		std::lock_guard<std::mutex> lock(m_fileMutex);
+		m_numReads++;
+		if (m_file == nullptr || seekFile(m_file, info.offset) != 0 ||
+			fread(data->values.data(), sizeof(float), data->values.size(), m_file) != data->values.size())
+		{
+			fprintf(stderr, "Failed to read volume brick %d\n", brick);
+			return nullptr;
+		}
+	}
+
+	glm::ivec3 ghostLow(info.ghostLow[0], info.ghostLow[1], info.ghostLow[2]);
+	glm::ivec3 ghostHigh(info.ghostHigh[0], info.ghostHigh[1], info.ghostHigh[2]);
+	glm::ivec3 numPoints(info.numPoints[0], info.numPoints[1], info.numPoints[2]);
+	data->firstPoint = glm::ivec3(info.firstPoint[0], info.firstPoint[1], info.firstPoint[2]) + ghostLow;
+
+	Volume& volume = data->volume;
+	volume.numPointsX = numPoints.x - ghostLow.x - ghostHigh.x;
+	volume.numPointsY = numPoints.y - ghostLow.y - ghostHigh.y;
+	volume.numPointsZ = numPoints.z - ghostLow.z - ghostHigh.z;
+	volume.ghostLow = ghostLow;
+	volume.ghostHigh = ghostHigh;
+	volume.values = data->values.data() + ghostLow.x + numPoints.x * (ghostLow.y + numPoints.y * ghostLow.z);
+	volume.origin = m_origin + glm::vec3(data->firstPoint) * m_spacing;
+	volume.spacing = m_spacing;
+
+	// The whole range keeps the color norms of all bricks on the same scale
+	volume.min = m_min;
+	volume.max = m_max;
+
+	return data;
+}
+
+size_t BrickedVolume::memory()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_memory;
+}
+
+size_t BrickedVolume::peakMemory()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_peakMemory;
+}
+
+size_t BrickedVolume::numReads()
+{
+	std::lock_guard<std::mutex> lock(m_fileMutex);
+	return m_numReads;
+}
@@ -0,0 +1,372 @@
+#pragma once
+#include <cube_classifier.h>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define CUBE_CLASSIFIER_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// GCC and Clang only emit AVX2 instructions in functions marked for it, MSVC emits them anywhere
+#if defined(CUBE_CLASSIFIER_X86) && (defined(__GNUC__) || defined(__clang__))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#else
+#define TARGET_AVX2
+#define TARGET_SSE2
+#endif
+
+typedef int (*ClassifyRowFunction)(const float*, const float*, const float*, const float*, int, float, uint8_t*, int*);
+typedef void (*ClassifyRowLevelsFunction)(const float*, const float*, const float*, const float*, int, const float*, int, uint8_t*, int*, int*);
+
+// Corner bits follow the corner numbering of the marching cubes tables
+static inline int classifyCell(const float* row0, const float* row1, const float* row2, const float* row3, int x, float isoValue)
+{
+	return (row0[x] < isoValue)
+		| (row0[x + 1] < isoValue) << 1
+		| (row1[x + 1] < isoValue) << 2
+		| (row1[x] < isoValue) << 3
+		| (row2[x] < isoValue) << 4
+		| (row2[x + 1] < isoValue) << 5
+		| (row3[x + 1] < isoValue) << 6
+		| (row3[x] < isoValue) << 7;
+}
+
+// Classifies cells [begin, numCells) one at a time and collects the non trivial ones without branching
+static int classifyScalar(const float* row0, const float* row1, const float* row2, const float* row3, int begin, int numCells, float isoValue, uint8_t* codes, int* active, int numActive)
+{
+	for (int x = begin; x < numCells; x++)
+	{
+		codes[x] = (uint8_t)classifyCell(row0, row1, row2, row3, x, isoValue);
+		active[numActive] = x;
+		numActive += (uint8_t)(codes[x] - 1) < 254;
+	}
+
+	return numActive;
+}
+
+static int classifyRowScalar(const float* row0, const float* row1, const float* row2, const float* row3, int numCells, float isoValue, uint8_t* codes, int* active)
+{
+	return classifyScalar(row0, row1, row2, row3, 0, numCells, isoValue, codes, active, 0);
+}
+
+// Reduces each of the cells [begin, numCells) to its value range once and only codes the levels inside it
+static void classifyLevelsScalar(const float* row0, const float* row1, const float* row2, const float* row3, int begin, int numCells, const float* isoValues, int numLevels, uint8_t* codes, int* active, int* numActive)
+{
+	for (int x = begin; x < numCells; x++)
+	{
+		float values[] = { row0[x], row0[x + 1], row1[x + 1], row1[x], row2[x], row2[x + 1], row3[x + 1], row3[x] };
+		float min = values[0];
+		float max = values[0];
+		for (int i = 1; i < 8; i++)
+		{
+			min = (values[i] < min) ? values[i] : min;
+			max = (values[i] > max) ? values[i] : max;
+		}
+
+		for (int level = 0; level < numLevels && isoValues[level] <= max; level++)
+		{
+			if (min < isoValues[level])
+			{
+				codes[level * numCells + x] = (uint8_t)classifyCell(row0, row1, row2, row3, x, isoValues[level]);
+				active[level * numCells + numActive[level]++] = x;
+			}
+		}
+	}
+}
+
+static void classifyRowLevelsScalar(const float* row0, const float* row1, const float* row2, const float* row3, int numCells, const float* isoValues, int numLevels, uint8_t* codes, int* active, int* numActive)
+{
+	memset(numActive, 0, numLevels * sizeof(int));
+	classifyLevelsScalar(row0, row1, row2, row3, 0, numCells, isoValues, numLevels, codes, active, numActive);
+}
+
+#ifdef CUBE_CLASSIFIER_X86
+// Four cells per step, each comparison mask is reduced to the corner bit and or'ed into the codes
+TARGET_SSE2 static int classifyRowSse2(const float* row0, const float* row1, const float* row2, const float* row3, int numCells, float isoValue, uint8_t* codes, int* active)
+{
+	const __m128 iso = _mm_set1_ps(isoValue);
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i full = _mm_set1_epi32(0xFF);
+
+	int numActive = 0;
+	int x = 0;
+	for (; x + 4 <= numCells; x += 4)
+	{
+		__m128i code = _mm_and_si128(_mm_castps_si128(_mm_cmplt_ps(_mm_loadu_ps(row0 + x), iso)), _mm_set1_epi32(1 << 0));
+		code = _mm_or_si128(code, _mm_and_si128(_mm_castps_si128(_mm_cmplt_ps(_mm_loadu_ps(row0 + x + 1), iso)), _mm_set1_epi32(1 << 1)));
+		code = _mm_or_si128(code, _mm_and_si128(_mm_castps_si128(_mm_cmplt_ps(_mm_loadu_ps(row1 + x + 1), iso)), _mm_set1_epi32(1 << 2)));
+		code = _mm_or_si128(code, _mm_and_si128(_mm_castps_si128(_mm_cmplt_ps(_mm_loadu_ps(row1 + x), iso)), _mm_set1_epi32(1 << 3)));
+		code = _mm_or_si128(code, _mm_and_si128(_mm_castps_si128(_mm_cmplt_ps(_mm_loadu_ps(row2 + x), iso)), _mm_set1_epi32(1 << 4)));
+		code = _mm_or_si128(code, _mm_and_si128(_mm_castps_si128(_mm_cmplt_ps(_mm_loadu_ps(row2 + x + 1), iso)), _mm_set1_epi32(1 << 5)));
+		code = _mm_or_si128(code, _mm_and_si128(_mm_castps_si128(_mm_cmplt_ps(_mm_loadu_ps(row3 + x + 1), iso)), _mm_set1_epi32(1 << 6)));
+		code = _mm_or_si128(code, _mm_and_si128(_mm_castps_si128(_mm_cmplt_ps(_mm_loadu_ps(row3 + x), iso)), _mm_set1_epi32(1 << 7)));
+
+		int32_t packed = _mm_cvtsi128_si32(_mm_packus_epi16(_mm_packs_epi32(code, zero), zero));
+		memcpy(codes + x, &packed, sizeof(packed));
+
+		// Most of a volume is entirely in or out, skip the active test for those steps
+		__m128i trivial = _mm_or_si128(_mm_cmpeq_epi32(code, zero), _mm_cmpeq_epi32(code, full));
+		if (_mm_movemask_ps(_mm_castsi128_ps(trivial)) != 0xF)
+		{
+			for (int i = x; i < x + 4; i++)
+			{
+				active[numActive] = i;
+				numActive += (uint8_t)(codes[i] - 1) < 254;
+			}
+		}
+	}
+
+	return classifyScalar(row0, row1, row2, row3, x, numCells, isoValue, codes, active, numActive);
+}
+
+// Four cells per step, a level only costs two comparisons for the steps its iso value is outside of
+TARGET_SSE2 static void classifyRowLevelsSse2(const float* row0, const float* row1, const float* row2, const float* row3, int numCells, const float* isoValues, int numLevels, uint8_t* codes, int* active, int* numActive)
+{
+	memset(numActive, 0, numLevels * sizeof(int));
+
+	int x = 0;
+	for (; x + 4 <= numCells; x += 4)
+	{
+		__m128 c0 = _mm_loadu_ps(row0 + x);
+		__m128 c1 = _mm_loadu_ps(row0 + x + 1);
+		__m128 c2 = _mm_loadu_ps(row1 + x + 1);
+		__m128 c3 = _mm_loadu_ps(row1 + x);
+		__m128 c4 = _mm_loadu_ps(row2 + x);
+		__m128 c5 = _mm_loadu_ps(row2 + x + 1);
+		__m128 c6 = _mm_loadu_ps(row3 + x + 1);
+		__m128 c7 = _mm_loadu_ps(row3 + x);
+
+		__m128 min = _mm_min_ps(_mm_min_ps(_mm_min_ps(c0, c1), _mm_min_ps(c2, c3)), _mm_min_ps(_mm_min_ps(c4, c5), _mm_min_ps(c6, c7)));
+		__m128 max = _mm_max_ps(_mm_max_ps(_mm_max_ps(c0, c1), _mm_max_ps(c2, c3)), _mm_max_ps(_mm_max_ps(c4, c5), _mm_max_ps(c6, c7)));
+
+		for (int level = 0; level < numLevels; level++)
+		{
+			__m128 iso = _mm_set1_ps(isoValues[level]);
+			int mask = _mm_movemask_ps(_mm_and_ps(_mm_cmplt_ps(min, iso), _mm_cmple_ps(iso, max)));
+			if (mask == 0)
+			{
+				continue;
+			}
+
+			__m128i code = _mm_and_si128(_mm_castps_si128(_mm_cmplt_ps(c0, iso)), _mm_set1_epi32(1 << 0));
+			code = _mm_or_si128(code, _mm_and_si128(_mm_castps_si128(_mm_cmplt_ps(c1, iso)), _mm_set1_epi32(1 << 1)));
+			code = _mm_or_si128(code, _mm_and_si128(_mm_castps_si128(_mm_cmplt_ps(c2, iso)), _mm_set1_epi32(1 << 2)));
+			code = _mm_or_si128(code, _mm_and_si128(_mm_castps_si128(_mm_cmplt_ps(c3, iso)), _mm_set1_epi32(1 << 3)));
+			code = _mm_or_si128(code, _mm_and_si128(_mm_castps_si128(_mm_cmplt_ps(c4, iso)), _mm_set1_epi32(1 << 4)));
+			code = _mm_or_si128(code, _mm_and_si128(_mm_castps_si128(_mm_cmplt_ps(c5, iso)), _mm_set1_epi32(1 << 5)));
+			code = _mm_or_si128(code, _mm_and_si128(_mm_castps_si128(_mm_cmplt_ps(c6, iso)), _mm_set1_epi32(1 << 6)));
+			code = _mm_or_si128(code, _mm_and_si128(_mm_castps_si128(_mm_cmplt_ps(c7, iso)), _mm_set1_epi32(1 << 7)));
+
+			int32_t packed = _mm_cvtsi128_si32(_mm_packus_epi16(_mm_packs_epi32(code, _mm_setzero_si128()), _mm_setzero_si128()));
+			memcpy(codes + level * numCells + x, &packed, sizeof(packed));
+
+			for (int i = 0; i < 4; i++)
+			{
+				active[level * numCells + numActive[level]] = x + i;
+				numActive[level] += (mask >> i) & 1;
+			}
+		}
+	}
+
+	classifyLevelsScalar(row0, row1, row2, row3, x, numCells, isoValues, numLevels, codes, active, numActive);
+}
+
+// Eight cells per step
+TARGET_AVX2 static int classifyRowAvx2(const float* row0, const float* row1, const float* row2, const float* row3, int numCells, float isoValue, uint8_t* codes, int* active)
+{
+	const __m256 iso = _mm256_set1_ps(isoValue);
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i full = _mm256_set1_epi32(0xFF);
+
+	int numActive = 0;
+	int x = 0;
+	for (; x + 8 <= numCells; x += 8)
+	{
+		__m256i code = _mm256_and_si256(_mm256_castps_si256(_mm256_cmp_ps(_mm256_loadu_ps(row0 + x), iso, _CMP_LT_OQ)), _mm256_set1_epi32(1 << 0));
+		code = _mm256_or_si256(code, _mm256_and_si256(_mm256_castps_si256(_mm256_cmp_ps(_mm256_loadu_ps(row0 + x + 1), iso, _CMP_LT_OQ)), _mm256_set1_epi32(1 << 1)));
+		code = _mm256_or_si256(code, _mm256_and_si256(_mm256_castps_si256(_mm256_cmp_ps(_mm256_loadu_ps(row1 + x + 1), iso, _CMP_LT_OQ)), _mm256_set1_epi32(1 << 2)));
+		code = _mm256_or_si256(code, _mm256_and_si256(_mm256_castps_si256(_mm256_cmp_ps(_mm256_loadu_ps(row1 + x), iso, _CMP_LT_OQ)), _mm256_set1_epi32(1 << 3)));
+		code = _mm256_or_si256(code, _mm256_and_si256(_mm256_castps_si256(_mm256_cmp_ps(_mm256_loadu_ps(row2 + x), iso, _CMP_LT_OQ)), _mm256_set1_epi32(1 << 4)));
+		code = _mm256_or_si256(code, _mm256_and_si256(_mm256_castps_si256(_mm256_cmp_ps(_mm256_loadu_ps(row2 + x + 1), iso, _CMP_LT_OQ)), _mm256_set1_epi32(1 << 5)));
+		code = _mm256_or_si256(code, _mm256_and_si256(_mm256_castps_si256(_mm256_cmp_ps(_mm256_loadu_ps(row3 + x + 1), iso, _CMP_LT_OQ)), _mm256_set1_epi32(1 << 6)));
+		code = _mm256_or_si256(code, _mm256_and_si256(_mm256_castps_si256(_mm256_cmp_ps(_mm256_loadu_ps(row3 + x), iso, _CMP_LT_OQ)), _mm256_set1_epi32(1 << 7)));
+
+		__m128i words = _mm_packus_epi32(_mm256_castsi256_si128(code), _mm256_extracti128_si256(code, 1));
+		_mm_storel_epi64((__m128i*)(codes + x), _mm_packus_epi16(words, words));
+
+		__m256i trivial = _mm256_or_si256(_mm256_cmpeq_epi32(code, zero), _mm256_cmpeq_epi32(code, full));
+		if (_mm256_movemask_ps(_mm256_castsi256_ps(trivial)) != 0xFF)
+		{
+			for (int i = x; i < x + 8; i++)
+			{
+				active[numActive] = i;
+				numActive += (uint8_t)(codes[i] - 1) < 254;
+			}
+		}
+	}
+
+	return classifyScalar(row0, row1, row2, row3, x, numCells, isoValue, codes, active, numActive);
+}
+
+// Eight cells per step
+TARGET_AVX2 static void classifyRowLevelsAvx2(const float* row0, const float* row1, const float* row2, const float* row3, int numCells, const float* isoValues, int numLevels, uint8_t* codes, int* active, int* numActive)
+{
+	memset(numActive, 0, numLevels * sizeof(int));
+
+	int x = 0;
+	for (; x + 8 <= numCells; x += 8)
+	{
+		__m256 c0 = _mm256_loadu_ps(row0 + x);
+		__m256 c1 = _mm256_loadu_ps(row0 + x + 1);
+		__m256 c2 = _mm256_loadu_ps(row1 + x + 1);
+		__m256 c3 = _mm256_loadu_ps(row1 + x);
+		__m256 c4 = _mm256_loadu_ps(row2 + x);
+		__m256 c5 = _mm256_loadu_ps(row2 + x + 1);
+		__m256 c6 = _mm256_loadu_ps(row3 + x + 1);
+		__m256 c7 = _mm256_loadu_ps(row3 + x);
+
+		__m256 min = _mm256_min_ps(_mm256_min_ps(_mm256_min_ps(c0, c1), _mm256_min_ps(c2, c3)), _mm256_min_ps(_mm256_min_ps(c4, c5), _mm256_min_ps(c6, c7)));
+		__m256 max = _mm256_max_ps(_mm256_max_ps(_mm256_max_ps(c0, c1), _mm256_max_ps(c2, c3)), _mm256_max_ps(_mm256_max_ps(c4, c5), _mm256_max_ps(c6, c7)));
+
+		for (int level = 0; level < numLevels; level++)
+		{
+			__m256 iso = _mm256_set1_ps(isoValues[level]);
+			int mask = _mm256_movemask_ps(_mm256_and_ps(_mm256_cmp_ps(min, iso, _CMP_LT_OQ), _mm256_cmp_ps(iso, max, _CMP_LE_OQ)));
+			if (mask == 0)
+			{
+				continue;
+			}
+
+			__m256i code = _mm256_and_si256(_mm256_castps_si256(_mm256_cmp_ps(c0, iso, _CMP_LT_OQ)), _mm256_set1_epi32(1 << 0));
+			code = _mm256_or_si256(code, _mm256_and_si256(_mm256_castps_si256(_mm256_cmp_ps(c1, iso, _CMP_LT_OQ)), _mm256_set1_epi32(1 << 1)));
+			code = _mm256_or_si256(code, _mm256_and_si256(_mm256_castps_si256(_mm256_cmp_ps(c2, iso, _CMP_LT_OQ)), _mm256_set1_epi32(1 << 2)));
+			code = _mm256_or_si256(code, _mm256_and_si256(_mm256_castps_si256(_mm256_cmp_ps(c3, iso, _CMP_LT_OQ)), _mm256_set1_epi32(1 << 3)));
+			code = _mm256_or_si256(code, _mm256_and_si256(_mm256_castps_si256(_mm256_cmp_ps(c4, iso, _CMP_LT_OQ)), _mm256_set1_epi32(1 << 4)));
+			code = _mm256_or_si256(code, _mm256_and_si256(_mm256_castps_si256(_mm256_cmp_ps(c5, iso, _CMP_LT_OQ)), _mm256_set1_epi32(1 << 5)));
+			code = _mm256_or_si256(code, _mm256_and_si256(_mm256_castps_si256(_mm256_cmp_ps(c6, iso, _CMP_LT_OQ)), _mm256_set1_epi32(1 << 6)));
+			code = _mm256_or_si256(code, _mm256_and_si256(_mm256_castps_si256(_mm256_cmp_ps(c7, iso, _CMP_LT_OQ)), _mm256_set1_epi32(1 << 7)));
+
+			__m128i words = _mm_packus_epi32(_mm256_castsi256_si128(code), _mm256_extracti128_si256(code, 1));
+			_mm_storel_epi64((__m128i*)(codes + level * numCells + x), _mm_packus_epi16(words, words));
+
+			for (int i = 0; i < 8; i++)
+			{
+				active[level * numCells + numActive[level]] = x + i;
+				numActive[level] += (mask >> i) & 1;
+			}
+		}
+	}
+
+	classifyLevelsScalar(row0, row1, row2, row3, x, numCells, isoValues, numLevels, codes, active, numActive);
+}
+
+static bool hasAvx2()
+{
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7)
+	{
+		return false;
+	}
+
+	// The OS has to save the ymm registers as well
+	__cpuid(info, 1);
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool avx = (info[2] & (1 << 28)) != 0;
+	if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+	{
+		return false;
+	}
+
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+
+static bool hasSse2()
+{
+#if defined(_M_X64) || defined(__x86_64__)
+	return true;
+#elif defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 1);
+	return (info[3] & (1 << 26)) != 0;
+#else
+	return __builtin_cpu_supports("sse2");
+#endif
+}
+#endif
+
+struct ClassifierDispatch
+{
+	ClassifyRowFunction function;
+	ClassifyRowLevelsFunction levelsFunction;
+	const char* name;
+
+	ClassifierDispatch()
+		: function(classifyRowScalar),
+		  levelsFunction(classifyRowLevelsScalar),
+		  name("scalar")
+	{
+#ifdef CUBE_CLASSIFIER_X86
+		if (hasAvx2())
+		{
+			function = classifyRowAvx2;
+			levelsFunction = classifyRowLevelsAvx2;
+			name = "avx2";
+		}
+		else if (hasSse2())
+		{
+			function = classifyRowSse2;
+			levelsFunction = classifyRowLevelsSse2;
+			name = "sse2";
+		}
+#endif
+	}
+};
+
+static const ClassifierDispatch& dispatch()
+{
+	static const ClassifierDispatch s_dispatch;
+	return s_dispatch;
+}
+
+int CubeClassifier::classifyRow(
+	const float* row0,
+	const float* row1,
+	const float* row2,
+	const float* row3,
+	int numCells,
+	float isoValue,
+	uint8_t* codes,
+	int* active)
+{
+	return dispatch().function(row0, row1, row2, row3, numCells, isoValue, codes, active);
+}
+
+void CubeClassifier::classifyRowLevels(
+	const float* row0,
+	const float* row1,
+	const float* row2,
+	const float* row3,
+	int numCells,
+	const float* isoValues,
+	int numLevels,
+	uint8_t* codes,
+	int* active,
+	int* numActive)
+{
+	dispatch().levelsFunction(row0, row1, row2, row3, numCells, isoValues, numLevels, codes, active, numActive);
+}
+
+const char* CubeClassifier::instructionSet()
+{
+	return dispatch().name;
+}
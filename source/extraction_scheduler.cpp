@@ -0,0 +1,153 @@
+#pragma once
+#include <extraction_scheduler.h>
+
+ExtractionScheduler::ExtractionScheduler(IsoSurfaceExtractor& extractor, ExtractFunction extract)
+	: m_busy(false),
+	  m_cancel(false),
+	  m_extract(extract),
+	  m_extractor(extractor),
+	  m_hasRequest(false),
+	  m_hasResult(false),
+	  m_running(false),
+	  m_stop(false)
+{
+	m_extractor.setCancelFlag(&m_cancel);
+	m_thread = std::thread(&ExtractionScheduler::run, this);
+}
+
+ExtractionScheduler::~ExtractionScheduler()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+		m_cancel = true;
+	}
+
+	m_wake.notify_one();
+	m_thread.join();
+	m_extractor.setCancelFlag(nullptr);
+}
+
+void ExtractionScheduler::request(const std::vector<float>& isoValues)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_requestIsoValues = isoValues;
+		m_hasRequest = true;
+		m_busy = true;
+
+		// A finished surface for an older iso value is superseded as well
+		m_hasResult = false;
+		m_cancel = true;
+	}
+
+	m_wake.notify_one();
+}
+
+void ExtractionScheduler::cancel()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_hasRequest = false;
+	m_hasResult = false;
+	m_busy = m_running;
+	m_cancel = true;
+}
+
+bool ExtractionScheduler::poll(IsoSurface& surface, std::vector<float>& isoValues)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (!m_hasResult)
+	{
+		return false;
+	}
+
+	surface = std::move(m_result);
+	isoValues = m_resultIsoValues;
+	m_result = IsoSurface();
+	m_hasResult = false;
+
+	return true;
+}
+
+bool ExtractionScheduler::publish(IsoSurface& preview)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_hasRequest || m_cancel)
+	{
+		return false;
+	}
+
+	m_result = std::move(preview);
+	m_resultIsoValues = m_runningIsoValues;
+	m_hasResult = true;
+	preview = IsoSurface();
+
+	return true;
+}
+
+bool ExtractionScheduler::busy()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_busy;
+}
+
+float ExtractionScheduler::progress()
+{
+	return this->busy() ? m_extractor.progress() : 1.0f;
+}
+
+// Surfaces of several iso values extracted in one sweep and appended in the order of the iso values
+static bool extractAll(IsoSurfaceExtractor& extractor, const std::vector<float>& isoValues, IsoSurface& surface)
+{
+	std::vector<IsoSurface> surfaces;
+	if (!extractor.extract(isoValues, surfaces))
+	{
+		return false;
+	}
+
+	surface = IsoSurface();
+	for (const IsoSurface& levelSurface : surfaces)
+	{
+		surface.append(levelSurface);
+	}
+
+	return true;
+}
+
+void ExtractionScheduler::run()
+{
+	IsoSurface surface;
+	while (true)
+	{
+		std::vector<float> isoValues;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_wake.wait(lock, [this]() { return m_stop || m_hasRequest; });
+			if (m_stop)
+			{
+				return;
+			}
+
+			// Taking the request under the lock means a cancel can only be aimed at this extraction or a later one
+			isoValues = m_requestIsoValues;
+			m_runningIsoValues = isoValues;
+			m_hasRequest = false;
+			m_running = true;
+			m_cancel = false;
+		}
+
+		bool completed = (m_extract != nullptr) ? m_extract(m_extractor, isoValues, surface) : extractAll(m_extractor, isoValues, surface);
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (completed && !m_hasRequest && !m_cancel)
+		{
+			m_result = std::move(surface);
+			m_resultIsoValues = isoValues;
+			m_hasResult = true;
+			surface = IsoSurface();
+		}
+
+		m_running = false;
+		m_busy = m_hasRequest;
+	}
+}
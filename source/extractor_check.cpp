@@ -0,0 +1,239 @@
+#pragma once
+#include <extractor_check.h>
+#include <bricked_extractor.h>
+#include <bricked_volume.h>
+#include <region_extractor.h>
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <iterator>
+#include <unordered_map>
+
+// Distance in cells the corners of matching triangles may be apart, far below a cell but above rounding
+#define CHECK_TOLERANCE_CELLS 1.0e-3f
+
+// Bricks per axis the volume is written in, so the bricked extraction has brick faces to weld across
+#define CHECK_BRICKS_PER_AXIS 4
+
+// Numbers the positions added to it, positions less than tolerance apart along every axis get the same number
+class PositionTable
+{
+public:
+	PositionTable(float tolerance)
+		: m_numPositions(0),
+		  m_tolerance(tolerance) { }
+
+	uint32_t number(const glm::vec3& position)
+	{
+		// A match lies in the cell of the position or a neighbouring one
+		glm::ivec3 cell = glm::ivec3(glm::floor(position / m_tolerance));
+		for (int z = -1; z <= 1; z++)
+		{
+			for (int y = -1; y <= 1; y++)
+			{
+				for (int x = -1; x <= 1; x++)
+				{
+					auto found = m_cells.find(key(cell + glm::ivec3(x, y, z)));
+					if (found == m_cells.end())
+					{
+						continue;
+					}
+
+					for (const std::pair<glm::vec3, uint32_t>& entry : found->second)
+					{
+						glm::vec3 distance = glm::abs(entry.first - position);
+						if (std::max(distance.x, std::max(distance.y, distance.z)) < m_tolerance)
+						{
+							return entry.second;
+						}
+					}
+				}
+			}
+		}
+
+		m_cells[key(cell)].push_back(std::make_pair(position, m_numPositions));
+
+		return m_numPositions++;
+	}
+
+private:
+	static uint64_t key(const glm::ivec3& cell)
+	{
+		return ((uint64_t)(cell.x & 0x1FFFFF) << 42) | ((uint64_t)(cell.y & 0x1FFFFF) << 21) | (uint64_t)(cell.z & 0x1FFFFF);
+	}
+
+	std::unordered_map<uint64_t, std::vector<std::pair<glm::vec3, uint32_t>>> m_cells;
+	uint32_t 				m_numPositions;
+	float 					m_tolerance;
+};
+
+typedef std::array<uint32_t, 3> CheckTriangle;
+
+// Every triangle as the numbers of its corners, rotated to start at the smallest one, which keeps the winding, then sorted
+static std::vector<CheckTriangle> sortedTriangles(const IsoSurface& surface, PositionTable& positions)
+{
+	size_t numCorners = surface.indexed() ? surface.indices.size() : surface.vertices.size();
+	std::vector<CheckTriangle> triangles(numCorners / 3);
+	for (size_t i = 0; i < triangles.size(); i++)
+	{
+		uint32_t corners[3];
+		for (int c = 0; c < 3; c++)
+		{
+			size_t corner = 3 * i + c;
+			corners[c] = positions.number(surface.vertices[surface.indexed() ? surface.indices[corner] : corner].position);
+		}
+
+		int first = (corners[1] < corners[0]) ? 1 : 0;
+		first = (corners[2] < corners[first]) ? 2 : first;
+		for (int c = 0; c < 3; c++)
+		{
+			triangles[i][c] = corners[(first + c) % 3];
+		}
+	}
+
+	std::sort(triangles.begin(), triangles.end());
+
+	return triangles;
+}
+
+bool sameTriangles(const IsoSurface& a, const IsoSurface& b, float tolerance)
+{
+	PositionTable positions(tolerance);
+	std::vector<CheckTriangle> trianglesA = sortedTriangles(a, positions);
+	std::vector<CheckTriangle> trianglesB = sortedTriangles(b, positions);
+
+	std::vector<CheckTriangle> differing;
+	std::set_symmetric_difference(trianglesA.begin(), trianglesA.end(), trianglesB.begin(), trianglesB.end(), std::back_inserter(differing));
+	if (!differing.empty())
+	{
+		fprintf(stderr, "  %zu triangles against %zu, %zu found in only one of them\n", trianglesA.size(), trianglesB.size(), differing.size());
+	}
+
+	return differing.empty();
+}
+
+size_t numDuplicateVertices(const IsoSurface& surface, const Volume& volume, float tolerance)
+{
+	PositionTable positions(tolerance);
+	uint32_t numNumbered = 0;
+	size_t numDuplicates = 0;
+	for (const MeshVertexAttribute& vertex : surface.vertices)
+	{
+		// Vertices on a grid point are shared by all of its edges, only one inside an edge has a single edge
+		glm::vec3 point = (vertex.position - volume.origin) / volume.spacing;
+		glm::vec3 distance = glm::abs(point - glm::floor(point + 0.5f)) * volume.spacing;
+		if (std::max(distance.x, std::max(distance.y, distance.z)) < tolerance)
+		{
+			continue;
+		}
+
+		if (positions.number(vertex.position) < numNumbered)
+		{
+			numDuplicates++;
+		}
+		else
+		{
+			numNumbered++;
+		}
+	}
+
+	return numDuplicates;
+}
+
+// Compares a surface against the reference one and checks a welded one for duplicates
+static bool checkSurface(const char* name, const IsoSurface& surface, const IsoSurface& reference, const Volume& volume, float tolerance)
+{
+	bool matches = sameTriangles(surface, reference, tolerance);
+	if (!matches)
+	{
+		fprintf(stderr, "  %s differs from marching cubes\n", name);
+	}
+
+	size_t numDuplicates = surface.indexed() ? numDuplicateVertices(surface, volume, tolerance) : 0;
+	if (numDuplicates > 0)
+	{
+		fprintf(stderr, "  %s holds %zu duplicate vertices\n", name, numDuplicates);
+	}
+
+	return matches && numDuplicates == 0;
+}
+
+bool checkExtractors(const Volume& volume, float isoValue, const std::string& brickPath)
+{
+	float tolerance = CHECK_TOLERANCE_CELLS * std::min(volume.spacing.x, std::min(volume.spacing.y, volume.spacing.z));
+	MinMaxOctree octree(volume);
+
+	// Whole volume marching cubes without the octree is the reference every other extraction is held against
+	IsoSurface reference;
+	IsoSurfaceExtractor referenceExtractor(volume);
+	referenceExtractor.setIndexed(true);
+	if (!referenceExtractor.extract(isoValue, reference))
+	{
+		return false;
+	}
+
+	size_t numDuplicates = numDuplicateVertices(reference, volume, tolerance);
+	if (numDuplicates > 0)
+	{
+		fprintf(stderr, "  welded marching cubes holds %zu duplicate vertices\n", numDuplicates);
+	}
+
+	bool matches = numDuplicates == 0;
+	for (int method = 0; method < 2; method++)
+	{
+		IsoSurfaceMethod extractorMethod = (method == 0) ? ISOSURFACE_MARCHING_CUBES : ISOSURFACE_FLYING_EDGES;
+		const char* methodName = (method == 0) ? "marching cubes" : "flying edges";
+		for (int indexed = 0; indexed < 2; indexed++)
+		{
+			std::string name = std::string(indexed ? "welded " : "") + methodName;
+			IsoSurface surface;
+
+			IsoSurfaceExtractor extractor(volume);
+			extractor.setIndexed(indexed != 0);
+			extractor.setMethod(extractorMethod);
+			extractor.setMinMaxOctree(&octree);
+			matches = extractor.extract(isoValue, surface) && checkSurface((name + " over the octree").c_str(), surface, reference, volume, tolerance) && matches;
+
+			RegionExtractor regionExtractor(volume, &octree);
+			regionExtractor.setIndexed(indexed != 0);
+			regionExtractor.setMethod(extractorMethod);
+			std::vector<IsoSurface> surfaces;
+			matches = regionExtractor.extract({ isoValue }, surfaces) && checkSurface(("region " + name).c_str(), surfaces[0], reference, volume, tolerance) && matches;
+		}
+	}
+
+	// The bricks share their face points, a point layer is copied at a time as a volume file would be read
+	int numCells = std::min(volume.numCellsX(), std::min(volume.numCellsY(), volume.numCellsZ()));
+	auto readSlice = [&](int z, float* values)
+	{
+		for (int y = 0; y < volume.numPointsY; y++)
+		{
+			for (int x = 0; x < volume.numPointsX; x++)
+			{
+				*values++ = volume.value(x, y, z);
+			}
+		}
+
+		return true;
+	};
+
+	if (!BrickedVolume::write(brickPath, volume.numPointsX, volume.numPointsY, volume.numPointsZ, volume.origin, volume.spacing, readSlice, std::max(numCells / CHECK_BRICKS_PER_AXIS, 4)))
+	{
+		return false;
+	}
+
+	{
+		BrickedVolume bricks(brickPath);
+		for (int indexed = 0; indexed < 2; indexed++)
+		{
+			BrickedExtractor extractor(bricks);
+			extractor.setIndexed(indexed != 0);
+			IsoSurface surface;
+			matches = extractor.extract(isoValue, surface) && checkSurface(indexed ? "welded bricks" : "bricks", surface, reference, volume, tolerance) && matches;
+		}
+	}
+
+	remove(brickPath.c_str());
+
+	return matches;
+}
@@ -0,0 +1,238 @@
+#pragma once
+#include <gpu_extractor.h>
+#include <algorithm>
+#include <cstdio>
+
+// Invocations per work group of the one dimensional passes, as in their shaders
+#define GPU_WORK_GROUP_SIZE 64
+
+// Invocations per work group along each axis of the classification pass, as in its shader
+#define GPU_CELL_GROUP_SIZE 4
+
+// Work groups a dispatch may have along x, every dimension is guaranteed at least this many
+#define GPU_MAX_WORK_GROUPS 65535
+
+// Floats of a MeshVertexAttribute as the generation pass writes it
+#define GPU_VERTEX_FLOATS 7
+
+GpuExtractor::GpuExtractor(const Volume& volume)
+	: m_classifyShader("shader/marchingCubesClassifyComputeShader.glsl"),
+	  m_generateShader("shader/marchingCubesGenerateComputeShader.glsl"),
+	  m_maxBlockSize(0),
+	  m_pyramidBuffer(0),
+	  m_reduceShader("shader/histogramPyramidComputeShader.glsl"),
+	  m_storageAlignment(1),
+	  m_triangleTableBuffer(0),
+	  m_valid(false),
+	  m_vertexBuffer(0),
+	  m_vertexCapacity(0),
+	  m_volume(volume),
+	  m_volumeTexture(0)
+{
+	static_assert(sizeof(MeshVertexAttribute) == GPU_VERTEX_FLOATS * sizeof(float), "The generation pass writes tightly packed vertices");
+
+	if (!m_classifyShader.valid() || !m_reduceShader.valid() || !m_generateShader.valid())
+	{
+		return;
+	}
+
+	// One level per four times fewer nodes down to the single node holding the number of triangles
+	size_t numCells = (size_t)volume.numCellsX() * volume.numCellsY() * volume.numCellsZ();
+	size_t levelSize = numCells;
+	size_t pyramidSize = 0;
+	while (m_levelSizes.empty() || m_levelSizes.back() > 1)
+	{
+		m_levelOffsets.push_back((GLuint)pyramidSize);
+		m_levelSizes.push_back((GLuint)levelSize);
+		pyramidSize += levelSize;
+		levelSize = (levelSize + 3) / 4;
+	}
+
+	GLint maxTextureSize;
+	glGetIntegerv(GL_MAX_3D_TEXTURE_SIZE, &maxTextureSize);
+	glGetIntegerv(GL_MAX_SHADER_STORAGE_BLOCK_SIZE, &m_maxBlockSize);
+	glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &m_storageAlignment);
+	if (numCells == 0
+		|| m_levelSizes.size() > GPU_PYRAMID_LEVELS
+		|| std::max(volume.numPointsX, std::max(volume.numPointsY, volume.numPointsZ)) > maxTextureSize
+		|| pyramidSize * sizeof(GLuint) > (size_t)m_maxBlockSize)
+	{
+		fprintf(stderr, "Volume of %d x %d x %d points does not fit the GPU extraction\n", volume.numPointsX, volume.numPointsY, volume.numPointsZ);
+		return;
+	}
+
+	// Ghost points are skipped through the pitch of the rows and layers
+	glGenTextures(1, &m_volumeTexture);
+	glBindTexture(GL_TEXTURE_3D, m_volumeTexture);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAX_LEVEL, 0);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, volume.pitchX());
+	glPixelStorei(GL_UNPACK_IMAGE_HEIGHT, volume.pitchY());
+	glTexImage3D(GL_TEXTURE_3D, 0, GL_R32F, volume.numPointsX, volume.numPointsY, volume.numPointsZ, 0, GL_RED, GL_FLOAT, volume.values);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	glPixelStorei(GL_UNPACK_IMAGE_HEIGHT, 0);
+
+	glGenBuffers(1, &m_triangleTableBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_triangleTableBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(MarchingCubesTables::triangleTable), MarchingCubesTables::triangleTable, GL_STATIC_DRAW);
+
+	glGenBuffers(1, &m_pyramidBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_pyramidBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, pyramidSize * sizeof(GLuint), nullptr, GL_DYNAMIC_COPY);
+
+	glGenBuffers(1, &m_vertexBuffer);
+	m_valid = glGetError() == GL_NO_ERROR;
+	if (!m_valid)
+	{
+		fprintf(stderr, "Failed to allocate the GPU extraction of a %d x %d x %d volume\n", volume.numPointsX, volume.numPointsY, volume.numPointsZ);
+	}
+}
+
+GpuExtractor::~GpuExtractor()
+{
+	glDeleteTextures(1, &m_volumeTexture);
+	glDeleteBuffers(1, &m_triangleTableBuffer);
+	glDeleteBuffers(1, &m_pyramidBuffer);
+	glDeleteBuffers(1, &m_vertexBuffer);
+}
+
+bool GpuExtractor::supported()
+{
+	return GLEW_VERSION_4_3;
+}
+
+bool GpuExtractor::extract(const std::vector<float>& isoValues)
+{
+	const Volume& volume = m_volume;
+	glm::ivec3 numCells(volume.numCellsX(), volume.numCellsY(), volume.numCellsZ());
+	int numLevels = (int)m_levelSizes.size();
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_3D, m_volumeTexture);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_triangleTableBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_pyramidBuffer);
+
+	m_numVertices.clear();
+	size_t usedBytes = 0;
+	for (float isoValue : isoValues)
+	{
+		m_classifyShader.use();
+		glUniform1i(m_classifyShader.uniform("sVolume"), 0);
+		glUniform1f(m_classifyShader.uniform("fIsoValue"), isoValue);
+		glUniform3i(m_classifyShader.uniform("iNumCells"), numCells.x, numCells.y, numCells.z);
+		glDispatchCompute(
+			(numCells.x + GPU_CELL_GROUP_SIZE - 1) / GPU_CELL_GROUP_SIZE,
+			(numCells.y + GPU_CELL_GROUP_SIZE - 1) / GPU_CELL_GROUP_SIZE,
+			(numCells.z + GPU_CELL_GROUP_SIZE - 1) / GPU_CELL_GROUP_SIZE);
+
+		m_reduceShader.use();
+		for (int level = 1; level < numLevels; level++)
+		{
+			glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+			glUniform1ui(m_reduceShader.uniform("uSourceOffset"), m_levelOffsets[level - 1]);
+			glUniform1ui(m_reduceShader.uniform("uSourceSize"), m_levelSizes[level - 1]);
+			glUniform1ui(m_reduceShader.uniform("uTargetOffset"), m_levelOffsets[level]);
+			glUniform1ui(m_reduceShader.uniform("uTargetSize"), m_levelSizes[level]);
+			dispatch(m_levelSizes[level]);
+		}
+
+		// The top of the pyramid is the one value read back, the vertex buffer is sized from it
+		GLuint numTriangles = 0;
+		glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_pyramidBuffer);
+		glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint) * m_levelOffsets.back(), sizeof(GLuint), &numTriangles);
+
+		// Storage ranges start on aligned offsets, the surface starts that many floats into its range
+		size_t bytes = (size_t)numTriangles * 3 * sizeof(MeshVertexAttribute);
+		size_t rangeOffset = usedBytes - usedBytes % m_storageAlignment;
+		if (usedBytes + bytes - rangeOffset > (size_t)m_maxBlockSize)
+		{
+			fprintf(stderr, "Surface of %u triangles is too large for the GPU extraction\n", numTriangles);
+			return false;
+		}
+
+		m_numVertices.push_back(3 * (size_t)numTriangles);
+		if (numTriangles == 0)
+		{
+			continue;
+		}
+
+		this->reserve(usedBytes + bytes, usedBytes);
+		glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 2, m_vertexBuffer, rangeOffset, usedBytes + bytes - rangeOffset);
+
+		m_generateShader.use();
+		glUniform1i(m_generateShader.uniform("sVolume"), 0);
+		glUniform1f(m_generateShader.uniform("fIsoValue"), isoValue);
+		glUniform1f(m_generateShader.uniform("fColorNorm"), (isoValue - volume.min) / (volume.max - volume.min));
+		glUniform3i(m_generateShader.uniform("iNumCells"), numCells.x, numCells.y, numCells.z);
+		glUniform3fv(m_generateShader.uniform("vOrigin"), 1, &volume.origin[0]);
+		glUniform3fv(m_generateShader.uniform("vSpacing"), 1, &volume.spacing[0]);
+		glUniform1uiv(m_generateShader.uniform("uLevelOffsets"), numLevels, m_levelOffsets.data());
+		glUniform1uiv(m_generateShader.uniform("uLevelSizes"), numLevels, m_levelSizes.data());
+		glUniform1i(m_generateShader.uniform("iNumLevels"), numLevels);
+		glUniform1ui(m_generateShader.uniform("uNumTriangles"), numTriangles);
+		glUniform1ui(m_generateShader.uniform("uFirstFloat"), (GLuint)((usedBytes - rangeOffset) / sizeof(float)));
+		dispatch(numTriangles);
+
+		// The pyramid is rebuilt by the next surface
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+		usedBytes += bytes;
+	}
+
+	glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+	return true;
+}
+
+void GpuExtractor::read(std::vector<IsoSurface>& surfaces) const
+{
+	surfaces.resize(m_numVertices.size());
+	glBindBuffer(GL_COPY_READ_BUFFER, m_vertexBuffer);
+	size_t firstVertex = 0;
+	for (size_t i = 0; i < m_numVertices.size(); i++)
+	{
+		surfaces[i] = IsoSurface();
+		surfaces[i].vertices.resize(m_numVertices[i]);
+		if (m_numVertices[i] > 0)
+		{
+			glGetBufferSubData(GL_COPY_READ_BUFFER, sizeof(MeshVertexAttribute) * firstVertex, sizeof(MeshVertexAttribute) * m_numVertices[i], surfaces[i].vertices.data());
+		}
+
+		firstVertex += m_numVertices[i];
+	}
+}
+
+// Grows the vertex buffer to hold at least bytes, by half again so the next surfaces rarely grow it, and
+// copies over the surfaces written so far
+void GpuExtractor::reserve(size_t bytes, size_t usedBytes)
+{
+	if (bytes <= m_vertexCapacity)
+	{
+		return;
+	}
+
+	size_t capacity = std::max(bytes, m_vertexCapacity + m_vertexCapacity / 2);
+	GLuint buffer;
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, capacity, nullptr, GL_DYNAMIC_COPY);
+	if (usedBytes > 0)
+	{
+		glBindBuffer(GL_COPY_READ_BUFFER, m_vertexBuffer);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, usedBytes);
+	}
+
+	glDeleteBuffers(1, &m_vertexBuffer);
+	m_vertexBuffer = buffer;
+	m_vertexCapacity = capacity;
+}
+
+// Runs numInvocations invocations of the bound one dimensional pass, in rows of work groups when they are
+// more than a dispatch may have along x
+void GpuExtractor::dispatch(size_t numInvocations)
+{
+	size_t numGroups = (numInvocations + GPU_WORK_GROUP_SIZE - 1) / GPU_WORK_GROUP_SIZE;
+	size_t numGroupsX = std::min(numGroups, (size_t)GPU_MAX_WORK_GROUPS);
+	glDispatchCompute((GLuint)numGroupsX, (GLuint)((numGroups + numGroupsX - 1) / numGroupsX), 1);
+}
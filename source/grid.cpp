@@ -1,6 +1,8 @@
 #pragma once
 #include <ddsbase.h>
 #include <grid.h>
+#include <volume_file.h>
+#include <cstring>
 #include <glm\gtx\matrix_decompose.hpp>
 
 Grid2D::Grid2D()
@@ -173,7 +175,17 @@ Grid3D::Grid3D()
 	  m_minZ(0),
 	  m_cellWidth(0),
 	  m_cellHeight(0),
-	  m_cellDepth(0) { }
+	  m_cellDepth(0),
+	  m_minMaxOctree(nullptr),
+	  m_checksum(0),
+	  m_pyramid(nullptr),
+	  m_pyramidReduction(VOLUME_REDUCE_AVERAGE) { }
+
+Grid3D::~Grid3D()
+{
+	delete m_pyramid;
+	delete m_minMaxOctree;
+}
 
 int Grid3D::findCell(float* p)
 {
@@ -225,6 +237,57 @@ void Grid3D::getPoint(int i, float* p)
     p[2] = m_minZ + i * m_cellDepth;
 }
 
+Volume Grid3D::volume()
+{
+	Volume volume;
+	volume.values = m_scalars->getC0Scalars();
+	volume.numPointsX = m_numPointsX;
+	volume.numPointsY = m_numPointsY;
+	volume.numPointsZ = m_numPointsZ;
+	volume.origin = glm::vec3(m_minX, m_minY, m_minZ);
+	volume.spacing = glm::vec3(m_cellWidth, m_cellHeight, m_cellDepth);
+	volume.min = m_scalars->getMin();
+	volume.max = m_scalars->getMax();
+
+	return volume;
+}
+
+const MinMaxOctree& Grid3D::minMaxOctree()
+{
+	std::call_once(m_minMaxOctreeBuilt, [this]() { m_minMaxOctree = new MinMaxOctree(this->volume()); });
+
+	return *m_minMaxOctree;
+}
+
+// FNV-1a over the bits of every point scalar, a word at a time
+uint64_t Grid3D::checksum()
+{
+	std::call_once(m_checksumComputed, [this]()
+	{
+		const float* values = m_scalars->getC0Scalars();
+		int numPoints = this->numPoints();
+
+		uint64_t hash = 0xcbf29ce484222325ull;
+		for (int i = 0; i < numPoints; i++)
+		{
+			uint32_t bits;
+			memcpy(&bits, &values[i], sizeof(bits));
+			hash = (hash ^ bits) * 0x100000001b3ull;
+		}
+
+		m_checksum = hash;
+	});
+
+	return m_checksum;
+}
+
+const VolumePyramid& Grid3D::pyramid()
+{
+	std::call_once(m_pyramidBuilt, [this]() { m_pyramid = new VolumePyramid(this->volume(), m_pyramidReduction); });
+
+	return *m_pyramid;
+}
+
 CalculateGrid3D::CalculateGrid3D(
 	Calculate3DFunction calcFunction,
 	int numPointsX,
@@ -334,6 +397,11 @@ float PvmGrid3D::evaluate(float x, float y, float z)
 	// }
 }
 
+bool PvmGrid3D::writeBricks(const std::string& pvmFilePath, const std::string& brickFilePath, int brickCells)
+{
+	return VolumeFile::writeBricks(pvmFilePath, brickFilePath, brickCells);
+}
+
 ScalarAttributes* PvmGrid3D::initScalars(unsigned char* volume, unsigned int bytesPerValue)
 {
 	ScalarAttributes* scalars = new ScalarAttributes(m_numPointsX * m_numPointsY * m_numPointsZ);
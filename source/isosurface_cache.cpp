@@ -0,0 +1,361 @@
+#pragma once
+#include <isosurface_cache.h>
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <direct.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define ISOSURFACE_FILE_MAGIC 0x534f5349u	// "ISOS"
+#define ISOSURFACE_FILE_VERSION 2
+
+// Cache file layout, the header is followed by the vertices, the indices and the segments as they are laid
+// out in memory so a mapped file can be copied or uploaded without any parsing
+struct IsoSurfaceFileHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	IsoSurfaceKey key;
+	uint64_t numVertices;
+	uint64_t numIndices;
+	uint64_t numSegments;
+};
+
+// Read-only view of a whole file mapped into memory
+class MappedFile
+{
+public:
+	MappedFile(const std::string& path);
+	~MappedFile();
+
+	const uint8_t* data() const { return m_data; }
+	size_t size() const { return m_size; }
+
+private:
+	const uint8_t* 	m_data;
+	size_t 			m_size;
+#ifdef _WIN32
+	HANDLE 			m_file;
+	HANDLE 			m_mapping;
+#endif
+};
+
+#ifdef _WIN32
+MappedFile::MappedFile(const std::string& path)
+	: m_data(nullptr),
+	  m_size(0),
+	  m_mapping(NULL)
+{
+	m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (m_file == INVALID_HANDLE_VALUE)
+	{
+		return;
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(m_file, &size) || size.QuadPart == 0)
+	{
+		return;
+	}
+
+	m_mapping = CreateFileMappingA(m_file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (m_mapping == NULL)
+	{
+		return;
+	}
+
+	m_data = (const uint8_t*)MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+	m_size = (m_data != nullptr) ? (size_t)size.QuadPart : 0;
+}
+
+MappedFile::~MappedFile()
+{
+	if (m_data != nullptr)
+	{
+		UnmapViewOfFile(m_data);
+	}
+
+	if (m_mapping != NULL)
+	{
+		CloseHandle(m_mapping);
+	}
+
+	if (m_file != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(m_file);
+	}
+}
+#else
+MappedFile::MappedFile(const std::string& path)
+	: m_data(nullptr),
+	  m_size(0)
+{
+	int file = open(path.c_str(), O_RDONLY);
+	if (file < 0)
+	{
+		return;
+	}
+
+	struct stat status;
+	if (fstat(file, &status) == 0 && status.st_size > 0)
+	{
+		void* data = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+		if (data != MAP_FAILED)
+		{
+			m_data = (const uint8_t*)data;
+			m_size = status.st_size;
+		}
+	}
+
+	close(file);
+}
+
+MappedFile::~MappedFile()
+{
+	if (m_data != nullptr)
+	{
+		munmap((void*)m_data, m_size);
+	}
+}
+#endif
+
+static void makeDirectory(const std::string& path)
+{
+#ifdef _WIN32
+	_mkdir(path.c_str());
+#else
+	mkdir(path.c_str(), 0755);
+#endif
+}
+
+IsoSurfaceKey::IsoSurfaceKey(uint64_t checksum, const Volume& volume, float isoValue, bool indexed, IsoSurfaceMethod method, bool segmented)
+{
+	// Zero everything first so no padding ever carries garbage into the hash or the files
+	memset(this, 0, sizeof(IsoSurfaceKey));
+
+	this->checksum = checksum;
+	this->numPoints[0] = volume.numPointsX;
+	this->numPoints[1] = volume.numPointsY;
+	this->numPoints[2] = volume.numPointsZ;
+	this->origin[0] = volume.origin.x;
+	this->origin[1] = volume.origin.y;
+	this->origin[2] = volume.origin.z;
+	this->spacing[0] = volume.spacing.x;
+	this->spacing[1] = volume.spacing.y;
+	this->spacing[2] = volume.spacing.z;
+	this->isoValue = isoValue;
+	this->indexed = indexed ? 1 : 0;
+	this->method = (uint32_t)method;
+	this->segmented = segmented ? 1 : 0;
+}
+
+// FNV-1a over the raw bytes of the key
+uint64_t IsoSurfaceKey::hash() const
+{
+	const uint8_t* bytes = (const uint8_t*)this;
+	uint64_t hash = 0xcbf29ce484222325ull;
+	for (size_t i = 0; i < sizeof(IsoSurfaceKey); i++)
+	{
+		hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+	}
+
+	return hash;
+}
+
+bool IsoSurfaceKey::operator==(const IsoSurfaceKey& other) const
+{
+	return memcmp(this, &other, sizeof(IsoSurfaceKey)) == 0;
+}
+
+IsoSurfaceCache::IsoSurfaceCache(size_t memoryBudget, const std::string& directory)
+	: m_directory(directory),
+	  m_memory(0),
+	  m_memoryBudget(memoryBudget)
+{
+	if (!m_directory.empty())
+	{
+		makeDirectory(m_directory);
+	}
+}
+
+IsoSurfaceCache& IsoSurfaceCache::instance()
+{
+	static IsoSurfaceCache cache;
+	return cache;
+}
+
+bool IsoSurfaceCache::find(const IsoSurfaceKey& key, IsoSurface& surface)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto found = m_lookup.find(key.hash());
+		if (found != m_lookup.end() && found->second->key == key)
+		{
+			m_entries.splice(m_entries.begin(), m_entries, found->second);
+			surface = found->second->surface;
+			return true;
+		}
+	}
+
+	// The file is read outside the lock so other meshes keep hitting the memory tier meanwhile
+	if (m_directory.empty() || !this->readFile(key, surface))
+	{
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	this->insertMemory(key, surface);
+
+	return true;
+}
+
+void IsoSurfaceCache::insert(const IsoSurfaceKey& key, const IsoSurface& surface)
+{
+	if (!m_directory.empty())
+	{
+		this->writeFile(key, surface);
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	this->insertMemory(key, surface);
+}
+
+size_t IsoSurfaceCache::memory()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_memory;
+}
+
+// Called with the lock held
+void IsoSurfaceCache::insertMemory(const IsoSurfaceKey& key, const IsoSurface& surface)
+{
+	uint64_t hash = key.hash();
+	auto found = m_lookup.find(hash);
+	if (found != m_lookup.end())
+	{
+		m_memory -= found->second->bytes;
+		m_entries.erase(found->second);
+		m_lookup.erase(found);
+	}
+
+	// Surfaces larger than the whole budget only go to disk
+	size_t bytes = surfaceBytes(surface);
+	if (bytes > m_memoryBudget)
+	{
+		return;
+	}
+
+	while (m_memory + bytes > m_memoryBudget)
+	{
+		const Entry& oldest = m_entries.back();
+		m_memory -= oldest.bytes;
+		m_lookup.erase(oldest.key.hash());
+		m_entries.pop_back();
+	}
+
+	m_entries.push_front(Entry{ key, surface, bytes });
+	m_lookup[hash] = m_entries.begin();
+	m_memory += bytes;
+}
+
+bool IsoSurfaceCache::readFile(const IsoSurfaceKey& key, IsoSurface& surface) const
+{
+	MappedFile file(this->filePath(key));
+	if (file.size() < sizeof(IsoSurfaceFileHeader))
+	{
+		return false;
+	}
+
+	IsoSurfaceFileHeader header;
+	memcpy(&header, file.data(), sizeof(IsoSurfaceFileHeader));
+
+	// A different key means two keys share a file name, the newer surface overwrites the file on insert
+	if (header.magic != ISOSURFACE_FILE_MAGIC || header.version != ISOSURFACE_FILE_VERSION || !(header.key == key))
+	{
+		return false;
+	}
+
+	size_t vertexBytes = header.numVertices * sizeof(MeshVertexAttribute);
+	size_t indexBytes = header.numIndices * sizeof(uint32_t);
+	size_t segmentBytes = header.numSegments * sizeof(IsoSurfaceSegment);
+	if (file.size() != sizeof(IsoSurfaceFileHeader) + vertexBytes + indexBytes + segmentBytes)
+	{
+		fprintf(stderr, "Ignoring truncated isosurface cache file %s\n", this->filePath(key).c_str());
+		return false;
+	}
+
+	const MeshVertexAttribute* vertices = (const MeshVertexAttribute*)(file.data() + sizeof(IsoSurfaceFileHeader));
+	const uint32_t* indices = (const uint32_t*)(file.data() + sizeof(IsoSurfaceFileHeader) + vertexBytes);
+	surface.vertices.assign(vertices, vertices + header.numVertices);
+	surface.indices.assign(indices, indices + header.numIndices);
+
+	// Segment keys only identify triangles within one run, the keys of that run may be handed out again in this one
+	const IsoSurfaceSegment* segments = (const IsoSurfaceSegment*)(file.data() + sizeof(IsoSurfaceFileHeader) + vertexBytes + indexBytes);
+	surface.segments.assign(segments, segments + header.numSegments);
+	uint64_t hash = key.hash();
+	for (size_t i = 0; i < surface.segments.size(); i++)
+	{
+		surface.segments[i].key = (hash + (i + 1) * 0x9e3779b97f4a7c15ull) | (1ull << 63);
+	}
+
+	return true;
+}
+
+void IsoSurfaceCache::writeFile(const IsoSurfaceKey& key, const IsoSurface& surface) const
+{
+	IsoSurfaceFileHeader header;
+	memset(&header, 0, sizeof(IsoSurfaceFileHeader));
+	header.magic = ISOSURFACE_FILE_MAGIC;
+	header.version = ISOSURFACE_FILE_VERSION;
+	header.key = key;
+	header.numVertices = surface.vertices.size();
+	header.numIndices = surface.indices.size();
+	header.numSegments = surface.segments.size();
+
+	// Written under a temporary name and renamed so a reader never maps a half written file
+	std::string path = this->filePath(key);
+	std::string tempPath = path + ".tmp";
+	FILE* file = fopen(tempPath.c_str(), "wb");
+	if (file == nullptr)
+	{
+		fprintf(stderr, "Failed to write isosurface cache file %s\n", tempPath.c_str());
+		return;
+	}
+
+	bool written =
+		fwrite(&header, sizeof(IsoSurfaceFileHeader), 1, file) == 1 &&
+		fwrite(surface.vertices.data(), sizeof(MeshVertexAttribute), surface.vertices.size(), file) == surface.vertices.size() &&
+		fwrite(surface.indices.data(), sizeof(uint32_t), surface.indices.size(), file) == surface.indices.size() &&
+		fwrite(surface.segments.data(), sizeof(IsoSurfaceSegment), surface.segments.size(), file) == surface.segments.size();
+	fclose(file);
+
+	remove(path.c_str());
+	if (!written || rename(tempPath.c_str(), path.c_str()) != 0)
+	{
+		fprintf(stderr, "Failed to write isosurface cache file %s\n", path.c_str());
+		remove(tempPath.c_str());
+	}
+}
+
+std::string IsoSurfaceCache::filePath(const IsoSurfaceKey& key) const
+{
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.iso", (unsigned long long)key.hash());
+
+	return m_directory + "/" + name;
+}
+
+size_t IsoSurfaceCache::surfaceBytes(const IsoSurface& surface)
+{
+	return sizeof(Entry) + surface.vertices.size() * sizeof(MeshVertexAttribute) + surface.indices.size() * sizeof(uint32_t) +
+		surface.segments.size() * sizeof(IsoSurfaceSegment);
+}
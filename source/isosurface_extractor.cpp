@@ -0,0 +1,1347 @@
+#pragma once
+#include <isosurface_extractor.h>
+#include <adaptive_octree.h>
+#include <cube_classifier.h>
+#include <algorithm>
+#include <bitset>
+
+// Slabs handed to each thread, more slabs than threads lets work stealing even out dense and empty regions
+#define SLABS_PER_THREAD 4
+
+#define NO_VERTEX 0xFFFFFFFFu
+
+// Marks an index referring to a vertex on the top plane of the previous slab, resolved when the slabs are joined
+#define PREVIOUS_SLAB_VERTEX 0x80000000u
+
+static const int s_cornerOffsets[CORNERS_PER_VOXEL][3] = {
+	{0, 0, 0}, {1, 0, 0}, {1, 1, 0}, {0, 1, 0},
+	{0, 0, 1}, {1, 0, 1}, {1, 1, 1}, {0, 1, 1}
+};
+
+// Point planes held by a slice edge cache
+#define SLICE_EDGE_CACHE_PLANES 5
+
+// Vertex ids of the edges on the bottom and top point planes of the current cell layer and of the
+// z edges between them. The top plane of one layer becomes the bottom plane of the next so every
+// edge crossing in a slab is interpolated exactly once. Each slot carries the stamp of the layer
+// that wrote it, moving to the next layer or slab only hands out new stamps instead of clearing
+// planes, so a layer costs as much as the surface crossing it rather than the area of the volume
+// and one cache serves any number of slabs.
+class SliceEdgeCache
+{
+public:
+	SliceEdgeCache(int numPointsX, int numPointsY)
+		: m_numPointsX(numPointsX),
+		  m_nextStamp(0)
+	{
+		for (Plane& plane : m_planes)
+		{
+			plane.vertices.assign(numPointsX * numPointsY, NO_VERTEX);
+			plane.stamps.assign(numPointsX * numPointsY, 0);
+			plane.stamp = ++m_nextStamp;
+		}
+	}
+
+	uint32_t find(int edge, int x, int y) const
+	{
+		const Plane& plane = m_planes[m_order[edgeSlots[edge][0]]];
+		int i = slotIndex(edge, x, y);
+		return (plane.stamps[i] == plane.stamp) ? plane.vertices[i] : NO_VERTEX;
+	}
+
+	void insert(int edge, int x, int y, uint32_t vertex)
+	{
+		Plane& plane = m_planes[m_order[edgeSlots[edge][0]]];
+		int i = slotIndex(edge, x, y);
+		plane.vertices[i] = vertex;
+		plane.stamps[i] = plane.stamp;
+	}
+
+	// Empties every plane for a new slab
+	void clear()
+	{
+		for (Plane& plane : m_planes)
+		{
+			plane.stamp = ++m_nextStamp;
+		}
+	}
+
+	// Point the bottom plane at the vertices of the previous slab rather than creating them again
+	void referencePreviousSlab()
+	{
+		Plane& bottomX = m_planes[m_order[BOTTOM_X]];
+		Plane& bottomY = m_planes[m_order[BOTTOM_Y]];
+		for (size_t i = 0; i < bottomX.vertices.size(); i++)
+		{
+			bottomX.vertices[i] = PREVIOUS_SLAB_VERTEX | (uint32_t)(2 * i);
+			bottomX.stamps[i] = bottomX.stamp;
+			bottomY.vertices[i] = PREVIOUS_SLAB_VERTEX | (uint32_t)(2 * i + 1);
+			bottomY.stamps[i] = bottomY.stamp;
+		}
+	}
+
+	// After the last layer of a slab the bottom plane holds the vertices on the top plane of the slab
+	void exportPlane(std::vector<uint32_t>& planeX, std::vector<uint32_t>& planeY)
+	{
+		exportPlane(m_planes[m_order[BOTTOM_X]], planeX);
+		exportPlane(m_planes[m_order[BOTTOM_Y]], planeY);
+	}
+
+	void nextLayer()
+	{
+		std::swap(m_order[BOTTOM_X], m_order[TOP_X]);
+		std::swap(m_order[BOTTOM_Y], m_order[TOP_Y]);
+		m_planes[m_order[TOP_X]].stamp = ++m_nextStamp;
+		m_planes[m_order[TOP_Y]].stamp = ++m_nextStamp;
+		m_planes[m_order[Z]].stamp = ++m_nextStamp;
+	}
+
+private:
+	enum PlaneSlot { BOTTOM_X, BOTTOM_Y, TOP_X, TOP_Y, Z };
+
+	struct Plane
+	{
+		std::vector<uint32_t> vertices;
+		std::vector<uint32_t> stamps;
+		uint32_t stamp;		// Slots holding any other stamp are empty
+	};
+
+	// Edge plane and offset of its first point relative to the first corner of the cell
+	static constexpr int edgeSlots[EDGES_PER_VOXEL][3] = {
+		{BOTTOM_X, 0, 0}, {BOTTOM_Y, 1, 0}, {BOTTOM_X, 0, 1}, {BOTTOM_Y, 0, 0},
+		{TOP_X, 0, 0}, {TOP_Y, 1, 0}, {TOP_X, 0, 1}, {TOP_Y, 0, 0},
+		{Z, 0, 0}, {Z, 1, 0}, {Z, 1, 1}, {Z, 0, 1}
+	};
+
+	int slotIndex(int edge, int x, int y) const
+	{
+		return (x + edgeSlots[edge][1]) + (y + edgeSlots[edge][2]) * m_numPointsX;
+	}
+
+	static void exportPlane(const Plane& plane, std::vector<uint32_t>& vertices)
+	{
+		vertices.resize(plane.vertices.size());
+		for (size_t i = 0; i < plane.vertices.size(); i++)
+		{
+			vertices[i] = (plane.stamps[i] == plane.stamp) ? plane.vertices[i] : NO_VERTEX;
+		}
+	}
+
+	int 		m_numPointsX;
+	uint32_t 	m_nextStamp;
+	Plane 		m_planes[SLICE_EDGE_CACHE_PLANES];
+	int 		m_order[SLICE_EDGE_CACHE_PLANES] = { BOTTOM_X, BOTTOM_Y, TOP_X, TOP_Y, Z };	// Plane in each slot
+};
+
+constexpr int SliceEdgeCache::edgeSlots[EDGES_PER_VOXEL][3];
+
+void IsoSurface::append(const IsoSurface& other)
+{
+	bool segmented = (vertices.empty() || !segments.empty()) && (other.vertices.empty() || !other.segments.empty());
+	if (!segmented)
+	{
+		segments.clear();
+	}
+	else
+	{
+		for (IsoSurfaceSegment segment : other.segments)
+		{
+			segment.firstVertex += vertices.size();
+			segment.firstIndex += indices.size();
+			segments.push_back(segment);
+		}
+	}
+
+	uint32_t base = (uint32_t)vertices.size();
+	vertices.insert(vertices.end(), other.vertices.begin(), other.vertices.end());
+
+	indices.reserve(indices.size() + other.indices.size());
+	for (uint32_t index : other.indices)
+	{
+		indices.push_back(base + index);
+	}
+}
+
+IsoSurfaceExtractor::IsoSurfaceExtractor(const Volume& volume, ThreadPool& pool)
+	: m_adaptiveAngle(ADAPTIVE_NORMAL_ANGLE),
+	  m_adaptiveError(ADAPTIVE_ERROR_TOLERANCE),
+	  m_cancel(nullptr),
+	  m_indexed(false),
+	  m_method(ISOSURFACE_MARCHING_CUBES),
+	  m_peakMemory(0),
+	  m_pool(pool),
+	  m_slabDepth(0),
+	  m_octree(nullptr),
+	  m_slabsDone(0),
+	  m_slabsTotal(0),
+	  m_volume(volume) { }
+
+IsoSurfaceExtractor::~IsoSurfaceExtractor()
+{
+	for (SliceEdgeCache* cache : m_edgeCaches)
+	{
+		delete cache;
+	}
+}
+
+float IsoSurfaceExtractor::progress() const
+{
+	int total = m_slabsTotal;
+	return (total > 0) ? (float)m_slabsDone / total : 0.0f;
+}
+
+// Calls visit(x, y, z, corner, level, code) for the cells of a slab each surface passes through, layer by layer, with
+// corner pointing at the value of their first corner and level indexing the sorted iso values. Rows of cells are
+// classified at once, with an octree only the rows inside its active blocks. A row is read once for all the iso values.
+template <typename Visit>
+void IsoSurfaceExtractor::forEachCell(const Slab& slab, Visit visit) const
+{
+	const Volume& volume = m_volume;
+	int numCellsX = volume.numCellsX();
+	int numCellsY = volume.numCellsY();
+	int numLevels = (int)m_isoValues.size();
+
+	// A row is classified against all of its levels in one go, from a single read of its four point rows
+	std::vector<uint8_t> codes(numLevels * numCellsX);
+	std::vector<int> active(numLevels * numCellsX);
+	std::vector<int> numActive(numLevels);
+	auto visitRow = [&](int y, int z, int beginX, int endX, int firstLevel, int endLevel)
+	{
+		const float* row = volume.values + volume.index(0, y, z);
+		const float* rows[] = { row + beginX, row + volume.index(beginX, 1, 0), row + volume.index(beginX, 0, 1), row + volume.index(beginX, 1, 1) };
+		int numCells = endX - beginX;
+		if (endLevel - firstLevel == 1)
+		{
+			numActive[0] = CubeClassifier::classifyRow(rows[0], rows[1], rows[2], rows[3], numCells, m_isoValues[firstLevel], codes.data(), active.data());
+		}
+		else if (endLevel > firstLevel)
+		{
+			CubeClassifier::classifyRowLevels(rows[0], rows[1], rows[2], rows[3], numCells, m_isoValues.data() + firstLevel, endLevel - firstLevel, codes.data(), active.data(), numActive.data());
+		}
+
+		for (int level = firstLevel; level < endLevel; level++)
+		{
+			const uint8_t* levelCodes = codes.data() + (level - firstLevel) * numCells;
+			const int* levelActive = active.data() + (level - firstLevel) * numCells;
+			for (int i = 0; i < numActive[level - firstLevel]; i++)
+			{
+				int x = beginX + levelActive[i];
+				visit(x, y, z, row + x, level, levelCodes[levelActive[i]]);
+			}
+		}
+	};
+
+	if (m_octree != nullptr)
+	{
+		// Sweep each layer of blocks one cell layer at a time so the cells still arrive in layer order
+		size_t layerBegin = slab.beginBlock;
+		while (layerBegin < slab.endBlock)
+		{
+			size_t layerEnd = layerBegin;
+			while (layerEnd < slab.endBlock && m_activeBlocks[layerEnd].z == m_activeBlocks[layerBegin].z)
+			{
+				layerEnd++;
+			}
+
+			// The cell layers of this layer of blocks, kept apart from the cells of each block below
+			glm::ivec3 layerBeginCell;
+			glm::ivec3 layerEndCell;
+			m_octree->cellBounds(0, 0, 0, m_activeBlocks[layerBegin].z, layerBeginCell, layerEndCell);
+			for (int z = layerBeginCell.z; z < layerEndCell.z; z++)
+			{
+				for (size_t i = layerBegin; i < layerEnd; i++)
+				{
+					// Only the levels inside the value range of the block can cut it
+					const glm::ivec3& block = m_activeBlocks[i];
+					const ValueRange& range = m_octree->node(0, block.x, block.y, block.z);
+					int firstLevel = (int)(std::upper_bound(m_isoValues.begin(), m_isoValues.end(), range.min) - m_isoValues.begin());
+					int endLevel = (int)(std::upper_bound(m_isoValues.begin(), m_isoValues.end(), range.max) - m_isoValues.begin());
+
+					glm::ivec3 blockBeginCell;
+					glm::ivec3 blockEndCell;
+					m_octree->cellBounds(0, block.x, block.y, block.z, blockBeginCell, blockEndCell);
+					for (int y = blockBeginCell.y; y < blockEndCell.y; y++)
+					{
+						visitRow(y, z, blockBeginCell.x, blockEndCell.x, firstLevel, endLevel);
+					}
+				}
+			}
+
+			layerBegin = layerEnd;
+		}
+	}
+	else
+	{
+		for (int z = slab.beginZ; z < slab.endZ; z++)
+		{
+			for (int y = 0; y < numCellsY; y++)
+			{
+				visitRow(y, z, 0, numCellsX, 0, numLevels);
+			}
+		}
+	}
+}
+
+bool IsoSurfaceExtractor::extract(float isoValue, IsoSurface& surface)
+{
+	std::vector<IsoSurface> surfaces(1);
+	surfaces[0].vertices.swap(surface.vertices);
+	surfaces[0].indices.swap(surface.indices);
+
+	bool completed = this->extract(std::vector<float>(1, isoValue), surfaces);
+	surface.vertices.swap(surfaces[0].vertices);
+	surface.indices.swap(surfaces[0].indices);
+
+	return completed;
+}
+
+bool IsoSurfaceExtractor::extract(const std::vector<float>& isoValues, std::vector<IsoSurface>& surfaces)
+{
+	m_slabsTotal = 0;
+	m_slabsDone = 0;
+
+	// Levels are handled in ascending order of iso value, outputs[level] is where each one goes
+	int numLevels = (int)isoValues.size();
+	std::vector<int> order(numLevels);
+	for (int i = 0; i < numLevels; i++)
+	{
+		order[i] = i;
+	}
+
+	std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return isoValues[a] < isoValues[b]; });
+	surfaces.resize(numLevels);
+	m_isoValues.resize(numLevels);
+	std::vector<IsoSurface*> outputs(numLevels);
+	for (int level = 0; level < numLevels; level++)
+	{
+		m_isoValues[level] = isoValues[order[level]];
+		outputs[level] = &surfaces[order[level]];
+		outputs[level]->vertices.clear();
+		outputs[level]->indices.clear();
+	}
+
+	int numCellsZ = m_volume.numCellsZ();
+	int slabDepth = m_slabDepth;
+	if (slabDepth <= 0)
+	{
+		slabDepth = std::max(1, numCellsZ / (SLABS_PER_THREAD * m_pool.numThreads()));
+	}
+
+	if (m_method == ISOSURFACE_FLYING_EDGES)
+	{
+		// Three passes over the layers of every level, each surface welded and then expanded for a soup
+		m_slabsTotal = numLevels * (3 * m_volume.numPointsZ - 2);
+		size_t peakMemory = 0;
+		size_t outputBytes = 0;
+		for (int level = 0; level < numLevels; level++)
+		{
+			// Leaves the peak of the level itself in m_peakMemory
+			IsoSurface& surface = *outputs[level];
+			if (!this->extractFlyingEdges(m_isoValues[level], surface))
+			{
+				return false;
+			}
+
+			size_t levelPeak = m_peakMemory;
+			size_t levelBytes = surface.vertices.size() * sizeof(MeshVertexAttribute) + surface.indices.size() * sizeof(uint32_t);
+			if (!m_indexed)
+			{
+				levelPeak = std::max(levelPeak, levelBytes + surface.indices.size() * sizeof(MeshVertexAttribute));
+				this->expandSoup(surface);
+				levelBytes = surface.vertices.size() * sizeof(MeshVertexAttribute);
+			}
+
+			peakMemory = std::max(peakMemory, outputBytes + levelPeak);
+			outputBytes += levelBytes;
+		}
+
+		m_peakMemory = peakMemory;
+		return true;
+	}
+
+	if (m_method == ISOSURFACE_ADAPTIVE)
+	{
+		return this->extractAdaptive(outputs);
+	}
+
+	// Sorting the active blocks puts them in layer order, which the slabs and the edge cache rely on.
+	// With several levels the blocks active for any of them are merged into one list.
+	m_activeBlocks.clear();
+	if (m_octree != nullptr)
+	{
+		for (float isoValue : m_isoValues)
+		{
+			m_octree->activeBlocks(isoValue, m_activeBlocks);
+		}
+
+		if (numLevels > 1)
+		{
+			std::sort(m_activeBlocks.begin(), m_activeBlocks.end(), [](const glm::ivec3& a, const glm::ivec3& b)
+			{
+				return (a.z != b.z) ? a.z < b.z : ((a.y != b.y) ? a.y < b.y : a.x < b.x);
+			});
+			m_activeBlocks.erase(std::unique(m_activeBlocks.begin(), m_activeBlocks.end()), m_activeBlocks.end());
+		}
+
+		// Slabs hold whole layers of blocks
+		slabDepth = ((slabDepth + MINMAX_BLOCK_SIZE - 1) / MINMAX_BLOCK_SIZE) * MINMAX_BLOCK_SIZE;
+	}
+
+	if (numLevels == 0 || (m_octree != nullptr && m_activeBlocks.empty()))
+	{
+		m_peakMemory = 0;
+		m_slabsTotal = 1;
+		m_slabsDone = 1;
+		return true;
+	}
+
+	// Every slab is counted and then filled
+	int numSlabs = (numCellsZ + slabDepth - 1) / slabDepth;
+	m_slabsTotal = 2 * numSlabs;
+	std::vector<Slab> slabs(numSlabs);
+	for (int i = 0; i < numSlabs; i++)
+	{
+		slabs[i].beginZ = i * slabDepth;
+		slabs[i].endZ = std::min(slabs[i].beginZ + slabDepth, numCellsZ);
+		slabs[i].beginBlock = std::lower_bound(m_activeBlocks.begin(), m_activeBlocks.end(), slabs[i].beginZ / MINMAX_BLOCK_SIZE,
+			[](const glm::ivec3& block, int z) { return block.z < z; }) - m_activeBlocks.begin();
+		slabs[i].endBlock = std::lower_bound(m_activeBlocks.begin(), m_activeBlocks.end(), (slabs[i].endZ + MINMAX_BLOCK_SIZE - 1) / MINMAX_BLOCK_SIZE,
+			[](const glm::ivec3& block, int z) { return block.z < z; }) - m_activeBlocks.begin();
+		slabs[i].outputs.resize(numLevels);
+	}
+
+	// Surface nets are always welded first, a soup is expanded from the indices at the end
+	bool nets = (m_method == ISOSURFACE_SURFACE_NETS);
+	bool welded = m_indexed || nets;
+	m_pool.parallelFor(numSlabs, [&](int slab)
+	{
+		if (!this->cancelled())
+		{
+			if (nets)
+			{
+				this->countSlabNets(slabs[slab]);
+			}
+			else
+			{
+				this->countSlab(slabs[slab]);
+			}
+
+			m_slabsDone++;
+		}
+	});
+
+	if (this->cancelled())
+	{
+		return false;
+	}
+
+	size_t numVertices = 0;
+	size_t numIndices = 0;
+	for (int level = 0; level < numLevels; level++)
+	{
+		size_t levelVertices = 0;
+		size_t levelIndices = 0;
+		for (Slab& slab : slabs)
+		{
+			slab.outputs[level].vertexOffset = levelVertices;
+			slab.outputs[level].indexOffset = levelIndices;
+			levelVertices += slab.outputs[level].numVertices;
+			levelIndices += slab.outputs[level].numIndices;
+		}
+
+		outputs[level]->vertices.resize(levelVertices);
+		outputs[level]->indices.resize(levelIndices);
+		numVertices += levelVertices;
+		numIndices += levelIndices;
+	}
+
+	m_pool.parallelFor(numSlabs, [&](int slab)
+	{
+		if (this->cancelled())
+		{
+			return;
+		}
+
+		if (nets)
+		{
+			this->fillSlabNets(slabs[slab], outputs);
+		}
+		else if (m_indexed)
+		{
+			this->fillSlabIndexed(slabs[slab], outputs);
+		}
+		else
+		{
+			this->fillSlab(slabs[slab], outputs);
+		}
+
+		m_slabsDone++;
+	});
+
+	if (this->cancelled())
+	{
+		return false;
+	}
+
+	size_t planeBytes = (nets ? m_volume.numCellsX() * m_volume.numCellsY() : m_volume.numPointsX * m_volume.numPointsY) * sizeof(uint32_t);
+	m_peakMemory = numVertices * sizeof(MeshVertexAttribute) + numIndices * sizeof(uint32_t) + numSlabs * (sizeof(Slab) + numLevels * sizeof(SlabOutput))
+		+ m_activeBlocks.capacity() * sizeof(glm::ivec3);
+
+	if (welded)
+	{
+		// Resolve the references to the top plane of the previous slab now that all of them are filled
+		m_pool.parallelFor((numSlabs - 1) * numLevels, [&](int i)
+		{
+			int level = i % numLevels;
+			const SlabOutput& previous = slabs[i / numLevels].outputs[level];
+			const SlabOutput& slab = slabs[i / numLevels + 1].outputs[level];
+			uint32_t* indices = outputs[level]->indices.data() + slab.indexOffset;
+			for (size_t j = 0; j < slab.numIndices; j++)
+			{
+				if (indices[j] & PREVIOUS_SLAB_VERTEX)
+				{
+					uint32_t plane = indices[j] & ~PREVIOUS_SLAB_VERTEX;
+					indices[j] = ((plane & 1) ? previous.topY : previous.topX)[plane >> 1];
+				}
+			}
+		});
+
+		if (nets)
+		{
+			// The kept layer of every slab and level and the layer below it while the slab is filled
+			m_peakMemory += (numSlabs * numLevels + m_pool.numThreads() * numLevels) * planeBytes;
+		}
+		else
+		{
+			// Two kept planes per slab and level and the edge caches with their stamps
+			std::lock_guard<std::mutex> lock(m_edgeCacheMutex);
+			m_peakMemory += (2 * numSlabs * numLevels + 2 * m_edgeCaches.size() * SLICE_EDGE_CACHE_PLANES) * planeBytes;
+		}
+	}
+
+	if (welded && !m_indexed)
+	{
+		// The welded surface of a level is held alongside its soup while it is expanded
+		size_t largestSoup = 0;
+		for (int level = 0; level < numLevels; level++)
+		{
+			largestSoup = std::max(largestSoup, outputs[level]->indices.size());
+			this->expandSoup(*outputs[level]);
+		}
+
+		m_peakMemory += largestSoup * sizeof(MeshVertexAttribute);
+	}
+
+	return true;
+}
+
+void IsoSurfaceExtractor::countSlab(Slab& slab)
+{
+	const Volume& volume = m_volume;
+	int lastX = volume.numCellsX() - 1;
+	int lastY = volume.numCellsY() - 1;
+	int numLevels = (int)m_isoValues.size();
+
+	// Each cut edge is counted by one of the cells sharing it: the cell it starts at along x and y, except on the
+	// last cells of a row or column, and the cell below it along z so the first plane of a slab belongs to the
+	// slab before, as in fillSlabIndexed. Indexed by the cell being last in x, last in y and in the first layer.
+	int ownedEdges[8] = { 0 };
+	for (int i = 0; i < 8; i++)
+	{
+		for (int edge = 0; edge < EDGES_PER_VOXEL; edge++)
+		{
+			const int* c0 = s_cornerOffsets[MarchingCubesTables::edgeCorners[edge][0]];
+			const int* c1 = s_cornerOffsets[MarchingCubesTables::edgeCorners[edge][1]];
+			bool alongZ = c0[2] != c1[2];
+			bool ownedX = std::min(c0[0], c1[0]) == 0 || (i & 1);
+			bool ownedY = std::min(c0[1], c1[1]) == 0 || (i & 2);
+			bool ownedZ = alongZ || c0[2] == 1 || (i & 4);
+			ownedEdges[i] |= (ownedX && ownedY && ownedZ) << edge;
+		}
+	}
+
+	// Every cut edge of a surface emits one vertex for a triangle soup and one index when welded
+	std::vector<size_t> numTriangleVertices(numLevels, 0);
+	std::vector<size_t> numEdges(numLevels, 0);
+	this->forEachCell(slab, [&](int x, int y, int z, const float*, int level, int code)
+	{
+		int owner = (x == lastX) | ((y == lastY) << 1) | ((z == 0) << 2);
+		numTriangleVertices[level] += MarchingCubes::numVertices(code);
+		numEdges[level] += std::bitset<EDGES_PER_VOXEL>(MarchingCubesTables::edgeTable[code] & ownedEdges[owner]).count();
+	});
+
+	for (int level = 0; level < numLevels; level++)
+	{
+		slab.outputs[level].numVertices = m_indexed ? numEdges[level] : numTriangleVertices[level];
+		slab.outputs[level].numIndices = m_indexed ? numTriangleVertices[level] : 0;
+	}
+}
+
+void IsoSurfaceExtractor::fillSlab(const Slab& slab, const std::vector<IsoSurface*>& surfaces)
+{
+	const Volume& volume = m_volume;
+	int numLevels = (int)m_isoValues.size();
+
+	// Index offsets of the voxel corners relative to the first corner
+	int cornerOffsets[CORNERS_PER_VOXEL];
+	for (int i = 0; i < CORNERS_PER_VOXEL; i++)
+	{
+		cornerOffsets[i] = volume.index(s_cornerOffsets[i][0], s_cornerOffsets[i][1], s_cornerOffsets[i][2]);
+	}
+
+	std::vector<float> colorNorms(numLevels);
+	std::vector<MeshVertexAttribute*> vertices(numLevels);
+	for (int level = 0; level < numLevels; level++)
+	{
+		colorNorms[level] = (m_isoValues[level] - volume.min) / (volume.max - volume.min);
+		vertices[level] = surfaces[level]->vertices.data() + slab.outputs[level].vertexOffset;
+	}
+
+	this->forEachCell(slab, [&](int x, int y, int z, const float* corner, int level, int code)
+	{
+		float values[CORNERS_PER_VOXEL];
+		for (int i = 0; i < CORNERS_PER_VOXEL; i++)
+		{
+			values[i] = corner[cornerOffsets[i]];
+		}
+
+		glm::vec3 positions[CORNERS_PER_VOXEL];
+		for (int i = 0; i < CORNERS_PER_VOXEL; i++)
+		{
+			positions[i] = volume.point(x + s_cornerOffsets[i][0], y + s_cornerOffsets[i][1], z + s_cornerOffsets[i][2]);
+		}
+
+		vertices[level] += MarchingCubes::polygonise(code, m_isoValues[level], positions, values, colorNorms[level], vertices[level]);
+	});
+}
+
+void IsoSurfaceExtractor::fillSlabIndexed(Slab& slab, const std::vector<IsoSurface*>& surfaces)
+{
+	const Volume& volume = m_volume;
+	int numLevels = (int)m_isoValues.size();
+
+	// Every level welds its own surface with its own edge cache
+	std::vector<SliceEdgeCache*> caches(numLevels);
+	std::vector<float> colorNorms(numLevels);
+	std::vector<uint32_t> numVertices(numLevels);
+	std::vector<uint32_t*> indices(numLevels);
+	for (int level = 0; level < numLevels; level++)
+	{
+		caches[level] = this->acquireEdgeCache();
+		if (slab.beginZ > 0)
+		{
+			caches[level]->referencePreviousSlab();
+		}
+
+		colorNorms[level] = (m_isoValues[level] - volume.min) / (volume.max - volume.min);
+		numVertices[level] = (uint32_t)slab.outputs[level].vertexOffset;
+		indices[level] = surfaces[level]->indices.data() + slab.outputs[level].indexOffset;
+	}
+
+	int layer = slab.beginZ;
+	auto nextLayer = [&]()
+	{
+		for (SliceEdgeCache* cache : caches)
+		{
+			cache->nextLayer();
+		}
+	};
+
+	this->forEachCell(slab, [&](int x, int y, int z, const float*, int level, int code)
+	{
+		for (; layer < z; layer++)
+		{
+			nextLayer();
+		}
+
+		SliceEdgeCache& cache = *caches[level];
+		IsoSurface& surface = *surfaces[level];
+		int edges = MarchingCubesTables::edgeTable[code];
+
+		// Look up the vertex on every cut edge, interpolating the ones no earlier cell has visited
+		uint32_t edgeVertices[EDGES_PER_VOXEL];
+		for (int edge = 0; edge < EDGES_PER_VOXEL; edge++)
+		{
+			if ((edges & (1 << edge)) == 0)
+			{
+				continue;
+			}
+
+			uint32_t vertex = cache.find(edge, x, y);
+			if (vertex == NO_VERTEX)
+			{
+				const int* c0 = s_cornerOffsets[MarchingCubesTables::edgeCorners[edge][0]];
+				const int* c1 = s_cornerOffsets[MarchingCubesTables::edgeCorners[edge][1]];
+				glm::ivec3 p1(x + c0[0], y + c0[1], z + c0[2]);
+				glm::ivec3 p2(x + c1[0], y + c1[1], z + c1[2]);
+
+				// Always interpolate from the lower to the upper point so slabs sharing a plane agree exactly
+				if (p2.x + p2.y + p2.z < p1.x + p1.y + p1.z)
+				{
+					std::swap(p1, p2);
+				}
+
+				this->addEdgeVertex(m_isoValues[level], colorNorms[level], p1, p2, surface.vertices[numVertices[level]]);
+				vertex = numVertices[level]++;
+				cache.insert(edge, x, y, vertex);
+			}
+
+			edgeVertices[edge] = vertex;
+		}
+
+		indices[level] += MarchingCubes::polygoniseIndexed(code, edgeVertices, indices[level]);
+	});
+
+	// Move on to the top plane of the slab, whatever layers the active cells left out
+	for (; layer < slab.endZ; layer++)
+	{
+		nextLayer();
+	}
+
+	for (int level = 0; level < numLevels; level++)
+	{
+		caches[level]->exportPlane(slab.outputs[level].topX, slab.outputs[level].topY);
+		this->releaseEdgeCache(caches[level]);
+	}
+}
+
+// Cut edges leaving the first corner of a cell, bit 0 for the x edge, 1 for y and 2 for z. The quad around each
+// joins the cell with the three before it, edges on the faces of the volume have cells missing and get none.
+static int netQuads(int x, int y, int z, int code)
+{
+	int first = code & 1;
+	int quads = (y > 0 && z > 0 && ((code >> 1) & 1) != first);
+	quads |= (x > 0 && z > 0 && ((code >> 3) & 1) != first) << 1;
+	quads |= (x > 0 && y > 0 && ((code >> 4) & 1) != first) << 2;
+
+	return quads;
+}
+
+void IsoSurfaceExtractor::countSlabNets(Slab& slab)
+{
+	int numLevels = (int)m_isoValues.size();
+
+	// One vertex per cell and two triangles per quad
+	std::vector<size_t> numCells(numLevels, 0);
+	std::vector<size_t> numQuads(numLevels, 0);
+	this->forEachCell(slab, [&](int x, int y, int z, const float*, int level, int code)
+	{
+		numCells[level]++;
+		numQuads[level] += std::bitset<3>(netQuads(x, y, z, code)).count();
+	});
+
+	for (int level = 0; level < numLevels; level++)
+	{
+		slab.outputs[level].numVertices = numCells[level];
+		slab.outputs[level].numIndices = 6 * numQuads[level];
+	}
+}
+
+void IsoSurfaceExtractor::fillSlabNets(Slab& slab, const std::vector<IsoSurface*>& surfaces)
+{
+	const Volume& volume = m_volume;
+	int numCellsX = volume.numCellsX();
+	int numLevels = (int)m_isoValues.size();
+	size_t cellsPerLayer = (size_t)numCellsX * volume.numCellsY();
+
+	int cornerOffsets[CORNERS_PER_VOXEL];
+	for (int i = 0; i < CORNERS_PER_VOXEL; i++)
+	{
+		cornerOffsets[i] = volume.index(s_cornerOffsets[i][0], s_cornerOffsets[i][1], s_cornerOffsets[i][2]);
+	}
+
+	// Vertex ids of the cells in the current layer go to topX, which holds the last layer of the slab in the end.
+	// Only the cells the surface passes through are written and only those are ever read, so neither is cleared.
+	std::vector<std::vector<uint32_t>> below(numLevels);
+	std::vector<float> colorNorms(numLevels);
+	std::vector<uint32_t> numVertices(numLevels);
+	std::vector<uint32_t*> indices(numLevels);
+	for (int level = 0; level < numLevels; level++)
+	{
+		slab.outputs[level].topX.resize(cellsPerLayer);
+		below[level].resize(cellsPerLayer);
+		colorNorms[level] = (m_isoValues[level] - volume.min) / (volume.max - volume.min);
+		numVertices[level] = (uint32_t)slab.outputs[level].vertexOffset;
+		indices[level] = surfaces[level]->indices.data() + slab.outputs[level].indexOffset;
+	}
+
+	int layer = slab.beginZ;
+	auto nextLayer = [&]()
+	{
+		for (int level = 0; level < numLevels; level++)
+		{
+			below[level].swap(slab.outputs[level].topX);
+		}
+	};
+
+	this->forEachCell(slab, [&](int x, int y, int z, const float* corner, int level, int code)
+	{
+		for (; layer < z; layer++)
+		{
+			nextLayer();
+		}
+
+		float values[CORNERS_PER_VOXEL];
+		for (int i = 0; i < CORNERS_PER_VOXEL; i++)
+		{
+			values[i] = corner[cornerOffsets[i]];
+		}
+
+		std::vector<uint32_t>& current = slab.outputs[level].topX;
+		uint32_t vertex = numVertices[level]++;
+		this->addCellVertex(m_isoValues[level], colorNorms[level], x, y, z, values, code, surfaces[level]->vertices[vertex]);
+		current[x + y * numCellsX] = vertex;
+
+		// Cells of the layer below the slab are referenced like the edges of the previous slab in fillSlabIndexed
+		auto cellVertex = [&](int cellX, int cellY, int cellZ)
+		{
+			uint32_t i = (uint32_t)(cellX + cellY * numCellsX);
+			if (cellZ == z)
+			{
+				return current[i];
+			}
+
+			return (cellZ < slab.beginZ) ? (PREVIOUS_SLAB_VERTEX | (2 * i)) : below[level][i];
+		};
+
+		// Quads run around their edge facing its upper end, and are turned over when the lower end is the
+		// one below the iso value so they face the lower values like the marching cubes triangles
+		auto addQuad = [&](uint32_t a, uint32_t b, uint32_t c, uint32_t d)
+		{
+			if (code & 1)
+			{
+				std::swap(b, d);
+			}
+
+			uint32_t* quad = indices[level];
+			quad[0] = a;
+			quad[1] = b;
+			quad[2] = c;
+			quad[3] = a;
+			quad[4] = c;
+			quad[5] = d;
+			indices[level] += 6;
+		};
+
+		int quads = netQuads(x, y, z, code);
+		if (quads & 1)
+		{
+			addQuad(cellVertex(x, y - 1, z - 1), cellVertex(x, y, z - 1), vertex, cellVertex(x, y - 1, z));
+		}
+
+		if (quads & 2)
+		{
+			addQuad(cellVertex(x - 1, y, z - 1), cellVertex(x - 1, y, z), vertex, cellVertex(x, y, z - 1));
+		}
+
+		if (quads & 4)
+		{
+			addQuad(cellVertex(x - 1, y - 1, z), cellVertex(x, y - 1, z), vertex, cellVertex(x - 1, y, z));
+		}
+	});
+
+	for (; layer < slab.endZ - 1; layer++)
+	{
+		nextLayer();
+	}
+}
+
+// Cut edges and triangles of one row of points along x and of the row of cells starting at it
+struct FlyingEdgesRow
+{
+	uint32_t numX;			// Cut edges starting at the points of the row along each axis
+	uint32_t numY;
+	uint32_t numZ;
+	uint32_t numIndices;	// Of the triangles of the row of cells, none on the last rows of points
+	int beginX;				// Range of the cut x edges, empty when there are none
+	int endX;
+	size_t vertexOffset;	// First vertex on the x edges, followed by the ones on the y and the z edges
+	size_t indexOffset;
+};
+
+// Whether an x edge has one point on each side of the iso value, from its case
+static inline bool edgeCut(uint8_t edgeCase)
+{
+	return edgeCase == 1 || edgeCase == 2;
+}
+
+// Whether point x of a row is below the iso value, from the cases of the x edges of the row
+static inline int pointBelow(const uint8_t* cases, int x, int numEdges)
+{
+	return (x < numEdges) ? (cases[x] & 1) : (cases[numEdges - 1] >> 1);
+}
+
+// All eight corners of cell x on one side of the iso value, no edge starting at point x of its rows is cut either
+static inline bool uniformCell(const uint8_t** rowCases, int x)
+{
+	uint8_t edgeCase = rowCases[0][x];
+	return (edgeCase == 0 || edgeCase == 3) && rowCases[1][x] == edgeCase && rowCases[2][x] == edgeCase && rowCases[3][x] == edgeCase;
+}
+
+// Flying edges: four passes that only ever walk rows of points along x, the layout of the volume, and that
+// need no locking as every pass writes to rows of its own. The first pass gives every x edge a case, bit 0
+// set when its first point is below the iso value and bit 1 for its second, and counts the cut ones per row.
+// The second trims each row of cells to the part the surface can pass through and counts its triangles and
+// the y and z edges it cuts. A prefix sum over the rows places every row in the surface and the last pass
+// interpolates the vertices and indexes the triangles of the rows straight into their place. The surface is
+// the same as marching cubes welds, with the vertices in row order.
+// Every level gets an octree refined around its own surface, welded and then expanded for a soup as with flying edges
+bool IsoSurfaceExtractor::extractAdaptive(const std::vector<IsoSurface*>& surfaces)
+{
+	int numLevels = (int)m_isoValues.size();
+	m_slabsTotal = 2 * numLevels;
+
+	MinMaxOctree* ownRanges = (m_octree == nullptr) ? new MinMaxOctree(m_volume, m_pool) : nullptr;
+	const MinMaxOctree& ranges = (m_octree != nullptr) ? *m_octree : *ownRanges;
+	size_t rangesBytes = (ownRanges != nullptr) ? ownRanges->memory() : 0;
+
+	size_t peakMemory = 0;
+	size_t outputBytes = 0;
+	bool completed = true;
+	for (int level = 0; level < numLevels && completed; level++)
+	{
+		AdaptiveOctree octree(m_volume, ranges, m_pool);
+		octree.setErrorTolerance(m_adaptiveError);
+		octree.setMaxNormalAngle(m_adaptiveAngle);
+		completed = octree.build(m_isoValues[level], m_cancel);
+		if (!completed)
+		{
+			break;
+		}
+
+		m_slabsDone++;
+
+		IsoSurface& surface = *surfaces[level];
+		octree.extract(surface);
+		m_slabsDone++;
+
+		size_t levelBytes = surface.vertices.size() * sizeof(MeshVertexAttribute) + surface.indices.size() * sizeof(uint32_t);
+		size_t levelPeak = levelBytes + octree.memory();
+		if (!m_indexed)
+		{
+			levelPeak = std::max(levelPeak, levelBytes + surface.indices.size() * sizeof(MeshVertexAttribute));
+			this->expandSoup(surface);
+			levelBytes = surface.vertices.size() * sizeof(MeshVertexAttribute);
+		}
+
+		peakMemory = std::max(peakMemory, outputBytes + levelPeak);
+		outputBytes += levelBytes;
+	}
+
+	delete ownRanges;
+	m_peakMemory = rangesBytes + peakMemory;
+
+	return completed;
+}
+
+bool IsoSurfaceExtractor::extractFlyingEdges(float isoValue, IsoSurface& surface)
+{
+	const Volume& volume = m_volume;
+	int numPointsY = volume.numPointsY;
+	int numPointsZ = volume.numPointsZ;
+	int numEdges = volume.numCellsX();
+	std::vector<uint8_t> cases((size_t)numEdges * numPointsY * numPointsZ);
+	std::vector<FlyingEdgesRow> rows((size_t)numPointsY * numPointsZ);
+	float colorNorm = (isoValue - volume.min) / (volume.max - volume.min);
+
+	// Every cell edge as its row among the four rows around the row of cells, bit 0 the next row along y and bit 1 along z,
+	// its axis and whether it starts at the second point of the cell along x
+	int edgeRows[EDGES_PER_VOXEL][3];
+	for (int edge = 0; edge < EDGES_PER_VOXEL; edge++)
+	{
+		const int* c0 = s_cornerOffsets[MarchingCubesTables::edgeCorners[edge][0]];
+		const int* c1 = s_cornerOffsets[MarchingCubesTables::edgeCorners[edge][1]];
+		edgeRows[edge][0] = std::min(c0[1], c1[1]) | (std::min(c0[2], c1[2]) << 1);
+		edgeRows[edge][1] = (c0[0] != c1[0]) ? 0 : ((c0[1] != c1[1]) ? 1 : 2);
+		edgeRows[edge][2] = std::min(c0[0], c1[0]);
+	}
+
+	m_pool.parallelFor(numPointsZ, [&](int z)
+	{
+		if (this->cancelled())
+		{
+			return;
+		}
+
+		for (int y = 0; y < numPointsY; y++)
+		{
+			const float* values = volume.values + volume.index(0, y, z);
+			uint8_t* rowCases = cases.data() + (size_t)numEdges * (y + numPointsY * z);
+			FlyingEdgesRow& row = rows[y + numPointsY * z];
+			row = FlyingEdgesRow();
+			row.beginX = numEdges;
+
+			// Independent iterations without branches so the sweep vectorizes, the range of the cut edges is looked
+			// for from both ends after it. The bound is a local as the byte stores could alias the captured one.
+			int rowEdges = numEdges;
+			uint32_t numX = 0;
+			for (int x = 0; x < rowEdges; x++)
+			{
+				uint8_t first = values[x] < isoValue;
+				uint8_t second = values[x + 1] < isoValue;
+				rowCases[x] = first | (second << 1);
+				numX += first ^ second;
+			}
+
+			row.numX = numX;
+			if (numX > 0)
+			{
+				row.beginX = 0;
+				while (!edgeCut(rowCases[row.beginX]))
+				{
+					row.beginX++;
+				}
+
+				row.endX = numEdges;
+				while (!edgeCut(rowCases[row.endX - 1]))
+				{
+					row.endX--;
+				}
+			}
+		}
+
+		m_slabsDone++;
+	});
+
+	// The cells a row of cells has to visit are those around the cut x edges of its four rows of points. Beyond them
+	// every row stays on one side of the iso value up to the end of the volume, the cells there are only cut through
+	// their y and z edges when the rows are on different sides at that end and then all of them are.
+	auto trim = [&](int y, int z, const uint8_t** rowCases, int& beginX, int& endX)
+	{
+		beginX = numEdges;
+		endX = 0;
+		for (int i = 0; i < 4; i++)
+		{
+			size_t row = (y + (i & 1)) + numPointsY * (z + (i >> 1));
+			rowCases[i] = cases.data() + numEdges * row;
+			beginX = std::min(beginX, rows[row].beginX);
+			endX = std::max(endX, rows[row].endX);
+		}
+
+		for (int i = 1; i < 4; i++)
+		{
+			if ((rowCases[i][0] & 1) != (rowCases[0][0] & 1))
+			{
+				beginX = 0;
+			}
+
+			if ((rowCases[i][numEdges - 1] >> 1) != (rowCases[0][numEdges - 1] >> 1))
+			{
+				endX = numEdges;
+			}
+		}
+	};
+
+	auto cellCode = [](const uint8_t** rowCases, int x)
+	{
+		return (rowCases[0][x] & 3) | ((rowCases[1][x] & 2) << 1) | ((rowCases[1][x] & 1) << 3)
+			| ((rowCases[2][x] & 3) << 4) | ((rowCases[3][x] & 2) << 5) | ((rowCases[3][x] & 1) << 7);
+	};
+
+	// Rows of cells count the y and z edges of their first row of points, and those of the rows on the last faces
+	// of the volume that no row of cells starts at
+	m_pool.parallelFor(numPointsZ - 1, [&](int z)
+	{
+		if (this->cancelled())
+		{
+			return;
+		}
+
+		for (int y = 0; y < numPointsY - 1; y++)
+		{
+			const uint8_t* rowCases[4];
+			int beginX;
+			int endX;
+			trim(y, z, rowCases, beginX, endX);
+			if (beginX >= endX)
+			{
+				continue;
+			}
+
+			FlyingEdgesRow* around[4];
+			for (int i = 0; i < 4; i++)
+			{
+				around[i] = &rows[(y + (i & 1)) + numPointsY * (z + (i >> 1))];
+			}
+
+			bool lastY = (y == numPointsY - 2);
+			bool lastZ = (z == numPointsZ - 2);
+			for (int x = beginX; x <= endX; x++)
+			{
+				if (x < endX && uniformCell(rowCases, x))
+				{
+					continue;
+				}
+
+				int below[4];
+				for (int i = 0; i < 4; i++)
+				{
+					below[i] = pointBelow(rowCases[i], x, numEdges);
+				}
+
+				around[0]->numY += below[0] != below[1];
+				around[0]->numZ += below[0] != below[2];
+				around[2]->numY += lastZ && below[2] != below[3];
+				around[1]->numZ += lastY && below[1] != below[3];
+
+				if (x < endX)
+				{
+					around[0]->numIndices += MarchingCubes::numVertices(cellCode(rowCases, x));
+				}
+			}
+		}
+
+		m_slabsDone++;
+	});
+
+	if (this->cancelled())
+	{
+		return false;
+	}
+
+	size_t numVertices = 0;
+	size_t numIndices = 0;
+	for (FlyingEdgesRow& row : rows)
+	{
+		row.vertexOffset = numVertices;
+		row.indexOffset = numIndices;
+		numVertices += row.numX + row.numY + row.numZ;
+		numIndices += row.numIndices;
+	}
+
+	surface.vertices.resize(numVertices);
+	surface.indices.resize(numIndices);
+	m_peakMemory = numVertices * sizeof(MeshVertexAttribute) + numIndices * sizeof(uint32_t) + cases.size() + rows.size() * sizeof(FlyingEdgesRow);
+
+	// Vertices on the cut edges of a row of points within the range of a row of cells, along y and z when asked
+	auto addRowVertices = [&](int y, int z, int beginX, int endX, bool alongY, bool alongZ)
+	{
+		const FlyingEdgesRow& row = rows[y + numPointsY * z];
+		const uint8_t* rowCases = cases.data() + numEdges * (y + (size_t)numPointsY * z);
+		const uint8_t* nextY = alongY ? rowCases + numEdges : nullptr;
+		const uint8_t* nextZ = alongZ ? rowCases + (size_t)numEdges * numPointsY : nullptr;
+		size_t vertexX = row.vertexOffset;
+		size_t vertexY = vertexX + row.numX;
+		size_t vertexZ = vertexY + row.numY;
+		for (int x = beginX; x <= endX; x++)
+		{
+			int below = pointBelow(rowCases, x, numEdges);
+			if (x < endX && edgeCut(rowCases[x]))
+			{
+				this->addEdgeVertex(isoValue, colorNorm, glm::ivec3(x, y, z), glm::ivec3(x + 1, y, z), surface.vertices[vertexX++]);
+			}
+
+			if (alongY && below != pointBelow(nextY, x, numEdges))
+			{
+				this->addEdgeVertex(isoValue, colorNorm, glm::ivec3(x, y, z), glm::ivec3(x, y + 1, z), surface.vertices[vertexY++]);
+			}
+
+			if (alongZ && below != pointBelow(nextZ, x, numEdges))
+			{
+				this->addEdgeVertex(isoValue, colorNorm, glm::ivec3(x, y, z), glm::ivec3(x, y, z + 1), surface.vertices[vertexZ++]);
+			}
+		}
+	};
+
+	m_pool.parallelFor(numPointsZ - 1, [&](int z)
+	{
+		if (this->cancelled())
+		{
+			return;
+		}
+
+		for (int y = 0; y < numPointsY - 1; y++)
+		{
+			const uint8_t* rowCases[4];
+			int beginX;
+			int endX;
+			trim(y, z, rowCases, beginX, endX);
+			if (beginX >= endX)
+			{
+				continue;
+			}
+
+			bool lastY = (y == numPointsY - 2);
+			bool lastZ = (z == numPointsZ - 2);
+			addRowVertices(y, z, beginX, endX, true, true);
+			if (lastY)
+			{
+				addRowVertices(y + 1, z, beginX, endX, false, true);
+			}
+
+			if (lastZ)
+			{
+				addRowVertices(y, z + 1, beginX, endX, true, false);
+			}
+
+			if (lastY && lastZ)
+			{
+				addRowVertices(y + 1, z + 1, beginX, endX, false, false);
+			}
+
+			// Next vertex along each axis on each of the four rows, nothing is cut on them before beginX
+			size_t nextVertex[4][3];
+			for (int i = 0; i < 4; i++)
+			{
+				const FlyingEdgesRow& row = rows[(y + (i & 1)) + numPointsY * (z + (i >> 1))];
+				nextVertex[i][0] = row.vertexOffset;
+				nextVertex[i][1] = row.vertexOffset + row.numX;
+				nextVertex[i][2] = row.vertexOffset + row.numX + row.numY;
+			}
+
+			uint32_t* indices = surface.indices.data() + rows[y + numPointsY * z].indexOffset;
+			for (int x = beginX; x < endX; x++)
+			{
+				if (uniformCell(rowCases, x))
+				{
+					continue;
+				}
+
+				// Which edges starting at point x of each row are cut, y edges only matter on rows 0 and 2, z edges on 0 and 1
+				int cut[4][3];
+				int below[4];
+				for (int i = 0; i < 4; i++)
+				{
+					below[i] = pointBelow(rowCases[i], x, numEdges);
+				}
+
+				for (int i = 0; i < 4; i++)
+				{
+					cut[i][0] = edgeCut(rowCases[i][x]);
+					cut[i][1] = (i & 1) == 0 && below[i] != below[i + 1];
+					cut[i][2] = (i & 2) == 0 && below[i] != below[i + 2];
+				}
+
+				int code = cellCode(rowCases, x);
+				int edges = MarchingCubesTables::edgeTable[code];
+				if (edges != 0)
+				{
+					uint32_t edgeVertices[EDGES_PER_VOXEL];
+					for (int edge = 0; edge < EDGES_PER_VOXEL; edge++)
+					{
+						if (edges & (1 << edge))
+						{
+							const int* edgeRow = edgeRows[edge];
+							edgeVertices[edge] = (uint32_t)(nextVertex[edgeRow[0]][edgeRow[1]] + (edgeRow[2] ? cut[edgeRow[0]][edgeRow[1]] : 0));
+						}
+					}
+
+					indices += MarchingCubes::polygoniseIndexed(code, edgeVertices, indices);
+				}
+
+				for (int i = 0; i < 4; i++)
+				{
+					for (int axis = 0; axis < 3; axis++)
+					{
+						nextVertex[i][axis] += cut[i][axis];
+					}
+				}
+			}
+		}
+
+		m_slabsDone++;
+	});
+
+	return !this->cancelled();
+}
+
+// Every index becomes a copy of the vertex it refers to
+void IsoSurfaceExtractor::expandSoup(IsoSurface& surface)
+{
+	std::vector<MeshVertexAttribute> vertices(surface.indices.size());
+	int numChunks = SLABS_PER_THREAD * m_pool.numThreads();
+	size_t chunkSize = (vertices.size() + numChunks - 1) / numChunks;
+	m_pool.parallelFor(numChunks, [&](int chunk)
+	{
+		size_t end = std::min(vertices.size(), (chunk + 1) * chunkSize);
+		for (size_t i = chunk * chunkSize; i < end; i++)
+		{
+			vertices[i] = surface.vertices[surface.indices[i]];
+		}
+	});
+
+	surface.vertices.swap(vertices);
+	surface.indices = std::vector<uint32_t>();
+}
+
+// Slabs filled at the same time each take a cache, the caches outlive the extraction for the next ones
+SliceEdgeCache* IsoSurfaceExtractor::acquireEdgeCache()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_edgeCacheMutex);
+		if (!m_edgeCaches.empty())
+		{
+			SliceEdgeCache* cache = m_edgeCaches.back();
+			m_edgeCaches.pop_back();
+			cache->clear();
+			return cache;
+		}
+	}
+
+	return new SliceEdgeCache(m_volume.numPointsX, m_volume.numPointsY);
+}
+
+void IsoSurfaceExtractor::releaseEdgeCache(SliceEdgeCache* cache)
+{
+	std::lock_guard<std::mutex> lock(m_edgeCacheMutex);
+	m_edgeCaches.push_back(cache);
+}
+
+void IsoSurfaceExtractor::addEdgeVertex(float isoValue, float colorNorm, const glm::ivec3& p1, const glm::ivec3& p2, MeshVertexAttribute& vertex)
+{
+	const Volume& volume = m_volume;
+	float mu = (float)MarchingCubes::interpolationWeight(isoValue, volume.value(p1.x, p1.y, p1.z), volume.value(p2.x, p2.y, p2.z));
+
+	glm::vec3 position1 = volume.point(p1.x, p1.y, p1.z);
+	glm::vec3 position2 = volume.point(p2.x, p2.y, p2.z);
+	glm::vec3 gradient1 = volume.gradient(p1.x, p1.y, p1.z);
+	glm::vec3 gradient2 = volume.gradient(p2.x, p2.y, p2.z);
+
+	// The surface faces towards lower values, matching the winding of the triangle table
+	glm::vec3 normal = -(gradient1 + mu * (gradient2 - gradient1));
+	float length = glm::length(normal);
+
+	vertex.position = position1 + mu * (position2 - position1);
+	vertex.normal = (length > 0.0f) ? normal / length : glm::normalize(position1 - position2);
+	vertex.colorNorm = colorNorm;
+}
+
+// Mean of the crossings on the cut edges of a cell, the normal is the gradient of the trilinear interpolation
+// of the corner values at that point
+void IsoSurfaceExtractor::addCellVertex(float isoValue, float colorNorm, int x, int y, int z, const float* values, int code, MeshVertexAttribute& vertex)
+{
+	const Volume& volume = m_volume;
+	int edges = MarchingCubesTables::edgeTable[code];
+
+	glm::vec3 sum(0.0f);
+	int numCrossings = 0;
+	for (int edge = 0; edge < EDGES_PER_VOXEL; edge++)
+	{
+		if (edges & (1 << edge))
+		{
+			int c0 = MarchingCubesTables::edgeCorners[edge][0];
+			int c1 = MarchingCubesTables::edgeCorners[edge][1];
+			float mu = (float)MarchingCubes::interpolationWeight(isoValue, values[c0], values[c1]);
+			glm::vec3 p0(s_cornerOffsets[c0][0], s_cornerOffsets[c0][1], s_cornerOffsets[c0][2]);
+			glm::vec3 p1(s_cornerOffsets[c1][0], s_cornerOffsets[c1][1], s_cornerOffsets[c1][2]);
+			sum += p0 + mu * (p1 - p0);
+			numCrossings++;
+		}
+	}
+
+	glm::vec3 p = sum / (float)numCrossings;
+	float u = p.x;
+	float v = p.y;
+	float w = p.z;
+	glm::vec3 gradient(
+		((1 - v) * (1 - w) * (values[1] - values[0]) + v * (1 - w) * (values[2] - values[3]) + (1 - v) * w * (values[5] - values[4]) + v * w * (values[6] - values[7])) / volume.spacing.x,
+		((1 - u) * (1 - w) * (values[3] - values[0]) + u * (1 - w) * (values[2] - values[1]) + (1 - u) * w * (values[7] - values[4]) + u * w * (values[6] - values[5])) / volume.spacing.y,
+		((1 - u) * (1 - v) * (values[4] - values[0]) + u * (1 - v) * (values[5] - values[1]) + (1 - u) * v * (values[7] - values[3]) + u * v * (values[6] - values[2])) / volume.spacing.z);
+
+	// The surface faces towards lower values as in addEdgeVertex
+	float length = glm::length(gradient);
+
+	vertex.position = volume.point(x, y, z) + p * volume.spacing;
+	vertex.normal = (length > 0.0f) ? -gradient / length : glm::vec3(0.0f, 0.0f, 1.0f);
+	vertex.colorNorm = colorNorm;
+}
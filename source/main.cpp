@@ -12,6 +12,7 @@
 
 const GLuint SCR_WIDTH = 1200;
 const GLuint SCR_HEIGHT = 1200;
+const char* WINDOW_TITLE = "Assignment 4";
 
 void frameBufferSizeCallback(GLFWwindow* window, int width, int height)
 {
@@ -32,6 +33,30 @@ messageCallback(GLenum source,
 		source, type, severity, message);
 }
 
+// Shows the progress of background mesh extractions in the title bar, only touching it when the percentage changes
+void showExtractionProgress(GLFWwindow* window, float progress)
+{
+	static int shownPercent = 100;
+	int percent = (int)(progress * 100.0f);
+	if (percent == shownPercent)
+	{
+		return;
+	}
+
+	char title[128];
+	if (percent < 100)
+	{
+		snprintf(title, sizeof(title), "%s - extracting isosurface %d%%", WINDOW_TITLE, percent);
+	}
+	else
+	{
+		snprintf(title, sizeof(title), "%s", WINDOW_TITLE);
+	}
+
+	glfwSetWindowTitle(window, title);
+	shownPercent = percent;
+}
+
 GLFWwindow* initWindow()
 {
 	GLFWwindow* window;
@@ -42,7 +67,7 @@ GLFWwindow* initWindow()
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 4);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
-	window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Assignment 4", NULL, NULL);
+	window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, WINDOW_TITLE, NULL, NULL);
 	if (NULL == window)
 	{
 		fprintf(stderr, "Failed to create GLFW window.\n");
@@ -114,21 +139,16 @@ glm::vec4 bonzaiColor(float value)
 void bonzaiMain(GLFWwindow* window)
 {
 	PvmGrid3D grid3D("datasets\\Bonsai2-HI.pvm");
+
+	// Nested surfaces extracted in one sweep, drawn from the innermost out for the blending
 	Mesh mesh(grid3D, bonzaiColor);
 	mesh.init();
-	mesh.setIsoValue(78.0f);
+	// Bricks in view first, uploaded as segments so only the bricks that change are uploaded again
+	mesh.setIsoValues({ 210.0f, 78.0f, 30.0f });
+	mesh.setIndexed(true);
+	mesh.setViewPriority(true);
 	MeshKeyListener meshKeyListener = MeshKeyListener(window, mesh);
 
-	Mesh mesh3(grid3D, bonzaiColor);
-	mesh3.init();
-	mesh3.setIsoValue(30.0f);
-	MeshKeyListener meshKeyListener3 = MeshKeyListener(window, mesh3);
-
-	Mesh mesh2(grid3D, bonzaiColor);
-	mesh2.init();
-	mesh2.setIsoValue(210.0f);
-	MeshKeyListener meshKeyListener2 = MeshKeyListener(window, mesh2);
-
 	LightBox light(glm::vec3(5.0f));
 	light.init();
 	light.orbit(glm::vec3(0, 0, 2.0f), glm::vec3(0, 0, 0.0f), 130.0f, 2.0f, 0.1f);
@@ -139,6 +159,10 @@ void bonzaiMain(GLFWwindow* window)
 	camera.lookAt(glm::vec3(0, 0, 0));
 	CameraKeyListener cameraKeyListener = CameraKeyListener(window, camera);
 
+	// The first surfaces come from the isosurface cache once an earlier run has extracted them
+	double startTime = glfwGetTime();
+	bool loaded = false;
+
 	// Render loop
 	while (!glfwWindowShouldClose(window))
 	{
@@ -146,11 +170,16 @@ void bonzaiMain(GLFWwindow* window)
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 		camera.update();
-		mesh2.update(camera, light);
 		mesh.update(camera, light);
-		mesh3.update(camera, light);
 		light.update(camera);
 
+		showExtractionProgress(window, mesh.extractionProgress());
+		if (!loaded && !mesh.extracting())
+		{
+			printf("Bonsai surfaces loaded in %.0f ms, %d of 3 from the isosurface cache\n", (glfwGetTime() - startTime) * 1000.0, mesh.numCachedSurfaces());
+			loaded = true;
+		}
+
 		glFlush();
 		glfwSwapBuffers(window);
 		glfwPollEvents();
@@ -206,6 +235,8 @@ void testMain(GLFWwindow* window)
 		meshSinc.update(camera, light);
 		light.update(camera);
 
+		showExtractionProgress(window, std::min(meshRadius.extractionProgress(), meshSinc.extractionProgress()));
+
 		glFlush();
 		glfwSwapBuffers(window);
 		glfwPollEvents();
@@ -0,0 +1,108 @@
+#pragma once
+#include <marching_cubes.h>
+#include <cmath>
+
+constexpr int MarchingCubesTables::edgeTable[MARCHING_CUBES_CASES];
+constexpr int MarchingCubesTables::triangleTable[MARCHING_CUBES_CASES][MAX_TRIANGLE_TABLE_ENTRIES];
+constexpr int MarchingCubesTables::edgeCorners[EDGES_PER_VOXEL][2];
+
+// Number of vertices every cube configuration emits, counted once from the triangle table
+struct VertexCounts
+{
+	int counts[MARCHING_CUBES_CASES];
+
+	constexpr VertexCounts() : counts()
+	{
+		for (int code = 0; code < MARCHING_CUBES_CASES; code++)
+		{
+			while (counts[code] < MAX_TRIANGLE_TABLE_ENTRIES && MarchingCubesTables::triangleTable[code][counts[code]] != -1)
+			{
+				counts[code]++;
+			}
+		}
+	}
+};
+
+static constexpr VertexCounts s_vertexCounts;
+
+int MarchingCubes::polygonise(int code, float isoValue, const glm::vec3* positions, const float* values, float colorNorm, MeshVertexAttribute* buffer)
+{
+	glm::vec3 vertices[EDGES_PER_VOXEL];
+	int edges = MarchingCubesTables::edgeTable[code];
+	for (int edge = 0; edge < EDGES_PER_VOXEL; edge++)
+	{
+		if (edges & (1 << edge))
+		{
+			int c0 = MarchingCubesTables::edgeCorners[edge][0];
+			int c1 = MarchingCubesTables::edgeCorners[edge][1];
+			vertices[edge] = vertexInterpolation(isoValue, positions[c0], positions[c1], values[c0], values[c1]);
+		}
+	}
+
+	const int* triangles = MarchingCubesTables::triangleTable[code];
+	int numVertices = s_vertexCounts.counts[code];
+	for (int i = 0; i < numVertices; i += 3)
+	{
+		const glm::vec3& a = vertices[triangles[i + 0]];
+		const glm::vec3& b = vertices[triangles[i + 1]];
+		const glm::vec3& c = vertices[triangles[i + 2]];
+		glm::vec3 n = glm::normalize(glm::cross(b - a, c - a));
+
+		MeshVertexAttribute* triangle = buffer + i;
+		triangle[0].position = a;
+		triangle[0].normal = n;
+		triangle[0].colorNorm = colorNorm;
+		triangle[1].position = b;
+		triangle[1].normal = n;
+		triangle[1].colorNorm = colorNorm;
+		triangle[2].position = c;
+		triangle[2].normal = n;
+		triangle[2].colorNorm = colorNorm;
+	}
+
+	return numVertices;
+}
+
+int MarchingCubes::polygoniseIndexed(int code, const uint32_t* edgeVertices, uint32_t* buffer)
+{
+	const int* triangles = MarchingCubesTables::triangleTable[code];
+	int numVertices = s_vertexCounts.counts[code];
+	for (int i = 0; i < numVertices; i++)
+	{
+		buffer[i] = edgeVertices[triangles[i]];
+	}
+
+	return numVertices;
+}
+
+int MarchingCubes::numVertices(int code)
+{
+	return s_vertexCounts.counts[code];
+}
+
+// Linearly interpolate the position where an isosurface cuts an edge between two vertices, each with their own scalar value
+glm::vec3 MarchingCubes::vertexInterpolation(float isoValue, const glm::vec3& p1, const glm::vec3& p2, double p1Value, double p2Value)
+{
+	if (std::abs(isoValue - p1Value) < 0.00001) { return p1; }
+	if (std::abs(isoValue - p2Value) < 0.00001) { return p2; }
+	if (std::abs(p1Value - p2Value)  < 0.00001) { return p1; }
+
+	double mu = (isoValue - p1Value) / (p2Value - p1Value);
+
+	glm::vec3 p;
+	p.x = p1.x + mu * (p2.x - p1.x);
+	p.y = p1.y + mu * (p2.y - p1.y);
+	p.z = p1.z + mu * (p2.z - p1.z);
+
+	return p;
+}
+
+// Fraction of the way from the first to the second vertex where the isosurface cuts the edge
+double MarchingCubes::interpolationWeight(float isoValue, double p1Value, double p2Value)
+{
+	if (std::abs(isoValue - p1Value) < 0.00001) { return 0.0; }
+	if (std::abs(isoValue - p2Value) < 0.00001) { return 1.0; }
+	if (std::abs(p1Value - p2Value)  < 0.00001) { return 0.0; }
+
+	return (isoValue - p1Value) / (p2Value - p1Value);
+}
@@ -2,18 +2,39 @@
 #include <mesh.h>
 
 Mesh::Mesh(Grid3D& grid, ColorFunction colorFunction)
-    : m_grid(grid),
-      m_isoValue(0.5f * (grid.pointScalars()->getMax() - grid.pointScalars()->getMin())),
-      m_prevIsoValue(-1.0f),
-      m_shader(new ColorMapShader()),
+    : m_boundsCenter(0.0f),
+      m_boundsRadius(0.0f),
+      m_clipped(false),
+      m_colorRuns(1),
       m_colorFunction(colorFunction),
-      m_defaultColor(glm::vec4(1.0f, 0, 0, 1.0f))
+      m_defaultColor(glm::vec4(1.0f, 0, 0, 1.0f)),
+      m_elementBuffer(0),
+      m_extractor(new IsoSurfaceExtractor(grid.volume())),
+      m_gpuExtraction(false),
+      m_gpuExtractor(nullptr),
+      m_grid(grid),
+      m_indexed(false),
+      m_isoValues(1, 0.5f * (grid.pointScalars()->getMax() - grid.pointScalars()->getMin())),
+      m_method(ISOSURFACE_MARCHING_CUBES),
+      m_numCachedSurfaces(0),
+      m_numIndices(0),
+      m_numLevels(0),
+      m_numVertices(0),
+      m_preview(true),
+      m_pixelError(1.0f),
+      m_quantized(false),
+      m_regionExtractor(nullptr),
+      m_segmentVertexSize(0),
+      m_shader(new ColorMapShader()),
+      m_viewPriority(false)
 {
     if (m_colorFunction == nullptr)
     {
         m_colorFunction = ColorFunction(std::bind(&Mesh::defaultColor, this, std::placeholders::_1));
     }
 
+    m_scheduler = new ExtractionScheduler(*m_extractor, std::bind(&Mesh::extractSurface, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+
 	m_material.shininess = rand() / (float)RAND_MAX;
 	m_material.ambientColor = glm::vec3(0.1f, 0.1f, 0.1f);
 	m_material.diffuseColor = glm::vec3(rand() / (float)RAND_MAX, rand() / (float)RAND_MAX, rand() / (float)RAND_MAX);
@@ -22,6 +43,11 @@ Mesh::Mesh(Grid3D& grid, ColorFunction colorFunction)
 
 Mesh::~Mesh()
 {
+    delete m_scheduler;
+    delete m_regionExtractor;
+    delete m_extractor;
+    delete m_gpuExtractor;
+    glDeleteBuffers(1, &m_elementBuffer);
     delete m_shader;
 }
 
@@ -32,6 +58,101 @@ void Mesh::update(const Camera& camera, const Light& light)
     UpdatableObject::update();
 }
 
+void Mesh::setIsoValue(float value)
+{
+    float offset = value - m_isoValues[0];
+    for (float& isoValue : m_isoValues)
+    {
+        isoValue += offset;
+    }
+}
+
+void Mesh::setIndexed(bool enable)
+{
+    if (m_indexed != enable)
+    {
+        m_indexed = enable;
+        m_prevIsoValues.clear();
+    }
+}
+
+void Mesh::setMethod(IsoSurfaceMethod method)
+{
+    if (m_method != method)
+    {
+        m_method = method;
+        m_prevIsoValues.clear();
+    }
+}
+
+void Mesh::setQuantized(bool enable)
+{
+    if (m_quantized != enable)
+    {
+        m_quantized = enable;
+        m_prevIsoValues.clear();
+    }
+}
+
+void Mesh::setLevelsOfDetail(int numLevels, float pixelError)
+{
+    m_pixelError = pixelError;
+    if (m_numLevels != numLevels)
+    {
+        m_numLevels = numLevels;
+        m_prevIsoValues.clear();
+    }
+}
+
+void Mesh::setClipBox(const glm::vec3& min, const glm::vec3& max)
+{
+    ClipRegion region = m_clipRegion;
+    region.min = min;
+    region.max = max;
+    setClipRegion(region);
+}
+
+void Mesh::setClipPlanes(const std::vector<Plane>& planes)
+{
+    ClipRegion region = m_clipRegion;
+    region.planes = planes;
+    setClipRegion(region);
+}
+
+void Mesh::clearClip()
+{
+    std::lock_guard<std::mutex> lock(m_clipMutex);
+    m_clipRegion = ClipRegion();
+    m_clipped = false;
+    m_prevIsoValues.clear();
+}
+
+void Mesh::setViewPriority(bool enable)
+{
+    if (m_viewPriority != enable)
+    {
+        m_viewPriority = enable;
+        m_prevIsoValues.clear();
+    }
+}
+
+void Mesh::setGpuExtraction(bool enable)
+{
+    if (m_gpuExtraction != enable)
+    {
+        m_gpuExtraction = enable;
+        m_prevIsoValues.clear();
+    }
+}
+
+void Mesh::setClipRegion(const ClipRegion& region)
+{
+    std::lock_guard<std::mutex> lock(m_clipMutex);
+    m_clipRegion = region;
+    m_clipped = true;
+    m_prevIsoValues.clear();
+}
+
 void Mesh::wireframe(bool enable)
 {
     m_wireframe = enable ? GL_LINE : GL_FILL;
@@ -42,6 +163,10 @@ void Mesh::initMovable(const GLuint& vao, const GLuint& vbo)
     m_shader->use();
     m_wireframe = GL_FILL;
 
+    // The element buffer binding is part of the vertex array state
+    glGenBuffers(1, &m_elementBuffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_elementBuffer);
+
     // Build color map
     std::vector<glm::vec4>colorMap(COLOR_MAP_RESOLUTION);
     float min = m_grid.pointScalars()->getMin();
@@ -67,22 +192,46 @@ void Mesh::updateMovable(const float& totalTime, const float& frameTime)
     m_shader->use();
     glPolygonMode(GL_FRONT_AND_BACK, m_wireframe);
 
-    if (m_isoValue != m_prevIsoValue)
+    // Every iso change goes straight to the scheduler, which drops the extraction it supersedes, unless the GPU
+    // extracts it on the spot. Whatever the scheduler was still working on is cancelled then.
+    if (m_isoValues != m_prevIsoValues)
     {
-        std::vector<MeshVertexAttribute> vertices;
-        marchingCubes(m_isoValue, vertices);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(MeshVertexAttribute) * vertices.size(), vertices.data(), GL_STATIC_DRAW);
-        m_numVertices = vertices.size();
-
-        m_shader->setBufferPosition(sizeof(MeshVertexAttribute), offsetof(MeshVertexAttribute, position));
-        m_shader->setBufferNormal(sizeof(MeshVertexAttribute), offsetof(MeshVertexAttribute, normal));
-	    m_shader->setBufferColorNorm(sizeof(MeshVertexAttribute), offsetof(MeshVertexAttribute, colorNorm));
+        if (this->useGpu() && this->extractOnGpu())
+        {
+            m_scheduler->cancel();
+        }
+        else
+        {
+            m_scheduler->request(m_isoValues);
+        }
+
+        m_prevIsoValues = m_isoValues;
+    }
 
-        m_prevIsoValue = m_isoValue;
+    IsoSurface surface;
+    std::vector<float> isoValues;
+    if (m_scheduler->poll(surface, isoValues))
+    {
+        // The full resolution surface is published ahead of its levels, so the chain may already be there for it
+        std::vector<IsoSurfaceLod> lods;
+        {
+            std::lock_guard<std::mutex> lock(m_lodMutex);
+            if (m_lodChainIsoValues == isoValues)
+            {
+                lods = m_lodChain;
+            }
+        }
+
+        uploadSurface(surface, lods);
     }
 
 	glm::mat4 modelView = m_camera->pose() * this->pose();
 	glm::mat4 modelViewProj = m_camera->projection() * modelView;
+	{
+		std::lock_guard<std::mutex> lock(m_clipMutex);
+		m_viewModelView = modelView;
+		m_viewProjection = m_camera->projection();
+	}
 
 	m_shader->setView(m_camera->pose());
 	m_shader->setModelView(modelView);
@@ -91,406 +240,634 @@ void Mesh::updateMovable(const float& totalTime, const float& frameTime)
 	m_shader->setMaterial(m_material);
 
     glBindTexture(GL_TEXTURE_1D, m_colorTexture);
-    glDrawArrays(GL_TRIANGLES, 0, m_numVertices);
+    for (const MeshSegmentBatch& batch : m_segmentBatches)
+    {
+        if (m_quantized)
+        {
+            m_shader->setColorNorm(batch.colorNorm);
+        }
+
+        if (m_numIndices > 0)
+        {
+            glMultiDrawElementsBaseVertex(GL_TRIANGLES, batch.counts.data(), GL_UNSIGNED_INT, batch.offsets.data(), (GLsizei)batch.counts.size(), batch.baseVertices.data());
+        }
+        else
+        {
+            glMultiDrawArrays(GL_TRIANGLES, batch.firsts.data(), batch.counts.data(), (GLsizei)batch.counts.size());
+        }
+    }
+
+    int level = selectLevel(modelView);
+    for (const MeshColorRun& run : m_colorRuns[level + 1])
+    {
+        if (m_quantized)
+        {
+            m_shader->setColorNorm(run.colorNorm);
+        }
+
+        if (level >= 0)
+        {
+            const MeshLod& lod = m_lods[level];
+            glDrawElementsBaseVertex(GL_TRIANGLES, run.count, GL_UNSIGNED_INT, (void*)(sizeof(uint32_t) * (lod.firstIndex + run.first)), lod.baseVertex);
+        }
+        else if (m_numIndices > 0)
+        {
+            glDrawElements(GL_TRIANGLES, run.count, GL_UNSIGNED_INT, (void*)(sizeof(uint32_t) * run.first));
+        }
+        else
+        {
+            glDrawArrays(GL_TRIANGLES, run.first, run.count);
+        }
+    }
 }
 
-void Mesh::marchingCubes(float isoValue, std::vector<MeshVertexAttribute>& data)
+// Octahedral projection of a unit normal, the lower half folded over the diagonals, in signed 16 bit steps
+static void encodeOctahedral(const glm::vec3& normal, int16_t* encoded)
 {
-    data.resize(m_grid.numCells() * VERTICES_PER_EDGE * MAX_EDGES_PER_CELL);
+    float sum = fabs(normal.x) + fabs(normal.y) + fabs(normal.z);
+    glm::vec2 e = (sum > 0.0f) ? glm::vec2(normal.x, normal.y) / sum : glm::vec2(0.0f);
+    if (normal.z < 0.0f)
+    {
+        e = glm::vec2((1.0f - fabs(e.y)) * (e.x >= 0.0f ? 1.0f : -1.0f), (1.0f - fabs(e.x)) * (e.y >= 0.0f ? 1.0f : -1.0f));
+    }
 
-    int numVoxels = m_grid.numCells();
-    int offset = 0;
-    for (int i = 0; i < numVoxels; i++)
+    encoded[0] = (int16_t)round(glm::clamp(e.x, -1.0f, 1.0f) * 32767.0f);
+    encoded[1] = (int16_t)round(glm::clamp(e.y, -1.0f, 1.0f) * 32767.0f);
+}
+
+// Ranges of triangles sharing a color norm in drawing order, every surface of a multi iso extraction is one,
+// as elements for an indexed surface and vertices for a soup. A single run spans everything unless split.
+static std::vector<MeshColorRun> colorRuns(const IsoSurface& surface, bool split)
+{
+    std::vector<MeshColorRun> runs;
+    int count = (int)(surface.indexed() ? surface.indices.size() : surface.vertices.size());
+    for (int i = 0; i < count; i += 3)
     {
-        int corners[CORNERS_PER_VOXEL];
-        m_grid.getCell(i, corners);
-        offset += this->updateVoxel(isoValue, corners, &data[offset]);
+        float colorNorm = surface.vertices[surface.indexed() ? surface.indices[i] : i].colorNorm;
+        if (runs.empty() || (split && runs.back().colorNorm != colorNorm))
+        {
+            runs.push_back({ i, 0, colorNorm });
+        }
+
+        runs.back().count += 3;
     }
 
-    data.resize(offset);
+    return runs;
 }
 
-// Based on implementation from: http://paulbourke.net/geometry/polygonise/
-int Mesh::updateVoxel(float isoValue, int corners[CORNERS_PER_VOXEL], MeshVertexAttribute* buffer)
+// Runs on the GL thread once the background extraction is done, the levels follow the surface in both buffers.
+void Mesh::uploadSurface(const IsoSurface& surface, const std::vector<IsoSurfaceLod>& lods)
 {
-    int edgeTable[256] = {
-        0x0  , 0x109, 0x203, 0x30a, 0x406, 0x50f, 0x605, 0x70c,
-        0x80c, 0x905, 0xa0f, 0xb06, 0xc0a, 0xd03, 0xe09, 0xf00,
-        0x190, 0x99 , 0x393, 0x29a, 0x596, 0x49f, 0x795, 0x69c,
-        0x99c, 0x895, 0xb9f, 0xa96, 0xd9a, 0xc93, 0xf99, 0xe90,
-        0x230, 0x339, 0x33 , 0x13a, 0x636, 0x73f, 0x435, 0x53c,
-        0xa3c, 0xb35, 0x83f, 0x936, 0xe3a, 0xf33, 0xc39, 0xd30,
-        0x3a0, 0x2a9, 0x1a3, 0xaa , 0x7a6, 0x6af, 0x5a5, 0x4ac,
-        0xbac, 0xaa5, 0x9af, 0x8a6, 0xfaa, 0xea3, 0xda9, 0xca0,
-        0x460, 0x569, 0x663, 0x76a, 0x66 , 0x16f, 0x265, 0x36c,
-        0xc6c, 0xd65, 0xe6f, 0xf66, 0x86a, 0x963, 0xa69, 0xb60,
-        0x5f0, 0x4f9, 0x7f3, 0x6fa, 0x1f6, 0xff , 0x3f5, 0x2fc,
-        0xdfc, 0xcf5, 0xfff, 0xef6, 0x9fa, 0x8f3, 0xbf9, 0xaf0,
-        0x650, 0x759, 0x453, 0x55a, 0x256, 0x35f, 0x55 , 0x15c,
-        0xe5c, 0xf55, 0xc5f, 0xd56, 0xa5a, 0xb53, 0x859, 0x950,
-        0x7c0, 0x6c9, 0x5c3, 0x4ca, 0x3c6, 0x2cf, 0x1c5, 0xcc ,
-        0xfcc, 0xec5, 0xdcf, 0xcc6, 0xbca, 0xac3, 0x9c9, 0x8c0,
-        0x8c0, 0x9c9, 0xac3, 0xbca, 0xcc6, 0xdcf, 0xec5, 0xfcc,
-        0xcc , 0x1c5, 0x2cf, 0x3c6, 0x4ca, 0x5c3, 0x6c9, 0x7c0,
-        0x950, 0x859, 0xb53, 0xa5a, 0xd56, 0xc5f, 0xf55, 0xe5c,
-        0x15c, 0x55 , 0x35f, 0x256, 0x55a, 0x453, 0x759, 0x650,
-        0xaf0, 0xbf9, 0x8f3, 0x9fa, 0xef6, 0xfff, 0xcf5, 0xdfc,
-        0x2fc, 0x3f5, 0xff , 0x1f6, 0x6fa, 0x7f3, 0x4f9, 0x5f0,
-        0xb60, 0xa69, 0x963, 0x86a, 0xf66, 0xe6f, 0xd65, 0xc6c,
-        0x36c, 0x265, 0x16f, 0x66 , 0x76a, 0x663, 0x569, 0x460,
-        0xca0, 0xda9, 0xea3, 0xfaa, 0x8a6, 0x9af, 0xaa5, 0xbac,
-        0x4ac, 0x5a5, 0x6af, 0x7a6, 0xaa , 0x1a3, 0x2a9, 0x3a0,
-        0xd30, 0xc39, 0xf33, 0xe3a, 0x936, 0x83f, 0xb35, 0xa3c,
-        0x53c, 0x435, 0x73f, 0x636, 0x13a, 0x33 , 0x339, 0x230,
-        0xe90, 0xf99, 0xc93, 0xd9a, 0xa96, 0xb9f, 0x895, 0x99c,
-        0x69c, 0x795, 0x49f, 0x596, 0x29a, 0x393, 0x99 , 0x190,
-        0xf00, 0xe09, 0xd03, 0xc0a, 0xb06, 0xa0f, 0x905, 0x80c,
-        0x70c, 0x605, 0x50f, 0x406, 0x30a, 0x203, 0x109, 0x0
-    };
-
-    int triangleTable[256][16] = {
-        {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-        {0, 8, 3, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-        {0, 1, 9, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-        {1, 8, 3, 9, 8, 1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-        {1, 2, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-        {0, 8, 3, 1, 2, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-        {9, 2, 10, 0, 2, 9, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-        {2, 8, 3, 2, 10, 8, 10, 9, 8, -1, -1, -1, -1, -1, -1, -1},
-        {3, 11, 2, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-        {0, 11, 2, 8, 11, 0, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-        {1, 9, 0, 2, 3, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-        {1, 11, 2, 1, 9, 11, 9, 8, 11, -1, -1, -1, -1, -1, -1, -1},
-        {3, 10, 1, 11, 10, 3, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-        {0, 10, 1, 0, 8, 10, 8, 11, 10, -1, -1, -1, -1, -1, -1, -1},
-        {3, 9, 0, 3, 11, 9, 11, 10, 9, -1, -1, -1, -1, -1, -1, -1},
-        {9, 8, 10, 10, 8, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-        {4, 7, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-        {4, 3, 0, 7, 3, 4, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-        {0, 1, 9, 8, 4, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-        {4, 1, 9, 4, 7, 1, 7, 3, 1, -1, -1, -1, -1, -1, -1, -1},
-        {1, 2, 10, 8, 4, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-        {3, 4, 7, 3, 0, 4, 1, 2, 10, -1, -1, -1, -1, -1, -1, -1},
-        {9, 2, 10, 9, 0, 2, 8, 4, 7, -1, -1, -1, -1, -1, -1, -1},
-        {2, 10, 9, 2, 9, 7, 2, 7, 3, 7, 9, 4, -1, -1, -1, -1},
-        {8, 4, 7, 3, 11, 2, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-        {11, 4, 7, 11, 2, 4, 2, 0, 4, -1, -1, -1, -1, -1, -1, -1},
-        {9, 0, 1, 8, 4, 7, 2, 3, 11, -1, -1, -1, -1, -1, -1, -1},
-        {4, 7, 11, 9, 4, 11, 9, 11, 2, 9, 2, 1, -1, -1, -1, -1},
-        {3, 10, 1, 3, 11, 10, 7, 8, 4, -1, -1, -1, -1, -1, -1, -1},
-        {1, 11, 10, 1, 4, 11, 1, 0, 4, 7, 11, 4, -1, -1, -1, -1},
-        {4, 7, 8, 9, 0, 11, 9, 11, 10, 11, 0, 3, -1, -1, -1, -1},
-        {4, 7, 11, 4, 11, 9, 9, 11, 10, -1, -1, -1, -1, -1, -1, -1},
-        {9, 5, 4, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-        {9, 5, 4, 0, 8, 3, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-        {0, 5, 4, 1, 5, 0, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-        {8, 5, 4, 8, 3, 5, 3, 1, 5, -1, -1, -1, -1, -1, -1, -1},
-        {1, 2, 10, 9, 5, 4, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-        {3, 0, 8, 1, 2, 10, 4, 9, 5, -1, -1, -1, -1, -1, -1, -1},
-        {5, 2, 10, 5, 4, 2, 4, 0, 2, -1, -1, -1, -1, -1, -1, -1},
-        {2, 10, 5, 3, 2, 5, 3, 5, 4, 3, 4, 8, -1, -1, -1, -1},
-        {9, 5, 4, 2, 3, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-        {0, 11, 2, 0, 8, 11, 4, 9, 5, -1, -1, -1, -1, -1, -1, -1},
-        {0, 5, 4, 0, 1, 5, 2, 3, 11, -1, -1, -1, -1, -1, -1, -1},
-        {2, 1, 5, 2, 5, 8, 2, 8, 11, 4, 8, 5, -1, -1, -1, -1},
-        {10, 3, 11, 10, 1, 3, 9, 5, 4, -1, -1, -1, -1, -1, -1, -1},
-        {4, 9, 5, 0, 8, 1, 8, 10, 1, 8, 11, 10, -1, -1, -1, -1},
-        {5, 4, 0, 5, 0, 11, 5, 11, 10, 11, 0, 3, -1, -1, -1, -1},
-        {5, 4, 8, 5, 8, 10, 10, 8, 11, -1, -1, -1, -1, -1, -1, -1},
-        {9, 7, 8, 5, 7, 9, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-        {9, 3, 0, 9, 5, 3, 5, 7, 3, -1, -1, -1, -1, -1, -1, -1},
-        {0, 7, 8, 0, 1, 7, 1, 5, 7, -1, -1, -1, -1, -1, -1, -1},
-        {1, 5, 3, 3, 5, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-        {9, 7, 8, 9, 5, 7, 10, 1, 2, -1, -1, -1, -1, -1, -1, -1},
-        {10, 1, 2, 9, 5, 0, 5, 3, 0, 5, 7, 3, -1, -1, -1, -1},
-        {8, 0, 2, 8, 2, 5, 8, 5, 7, 10, 5, 2, -1, -1, -1, -1},
-        {2, 10, 5, 2, 5, 3, 3, 5, 7, -1, -1, -1, -1, -1, -1, -1},
-        {7, 9, 5, 7, 8, 9, 3, 11, 2, -1, -1, -1, -1, -1, -1, -1},
-        {9, 5, 7, 9, 7, 2, 9, 2, 0, 2, 7, 11, -1, -1, -1, -1},
-        {2, 3, 11, 0, 1, 8, 1, 7, 8, 1, 5, 7, -1, -1, -1, -1},
-        {11, 2, 1, 11, 1, 7, 7, 1, 5, -1, -1, -1, -1, -1, -1, -1},
-        {9, 5, 8, 8, 5, 7, 10, 1, 3, 10, 3, 11, -1, -1, -1, -1},
-        {5, 7, 0, 5, 0, 9, 7, 11, 0, 1, 0, 10, 11, 10, 0, -1},
-        {11, 10, 0, 11, 0, 3, 10, 5, 0, 8, 0, 7, 5, 7, 0, -1},
-        {11, 10, 5, 7, 11, 5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-        {10, 6, 5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-        {0, 8, 3, 5, 10, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-        {9, 0, 1, 5, 10, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-        {1, 8, 3, 1, 9, 8, 5, 10, 6, -1, -1, -1, -1, -1, -1, -1},
-        {1, 6, 5, 2, 6, 1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-        {1, 6, 5, 1, 2, 6, 3, 0, 8, -1, -1, -1, -1, -1, -1, -1},
-        {9, 6, 5, 9, 0, 6, 0, 2, 6, -1, -1, -1, -1, -1, -1, -1},
-        {5, 9, 8, 5, 8, 2, 5, 2, 6, 3, 2, 8, -1, -1, -1, -1},
-        {2, 3, 11, 10, 6, 5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-        {11, 0, 8, 11, 2, 0, 10, 6, 5, -1, -1, -1, -1, -1, -1, -1},
-        {0, 1, 9, 2, 3, 11, 5, 10, 6, -1, -1, -1, -1, -1, -1, -1},
-        {5, 10, 6, 1, 9, 2, 9, 11, 2, 9, 8, 11, -1, -1, -1, -1},
-        {6, 3, 11, 6, 5, 3, 5, 1, 3, -1, -1, -1, -1, -1, -1, -1},
-        {0, 8, 11, 0, 11, 5, 0, 5, 1, 5, 11, 6, -1, -1, -1, -1},
-        {3, 11, 6, 0, 3, 6, 0, 6, 5, 0, 5, 9, -1, -1, -1, -1},
-        {6, 5, 9, 6, 9, 11, 11, 9, 8, -1, -1, -1, -1, -1, -1, -1},
-        {5, 10, 6, 4, 7, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-        {4, 3, 0, 4, 7, 3, 6, 5, 10, -1, -1, -1, -1, -1, -1, -1},
-        {1, 9, 0, 5, 10, 6, 8, 4, 7, -1, -1, -1, -1, -1, -1, -1},
-        {10, 6, 5, 1, 9, 7, 1, 7, 3, 7, 9, 4, -1, -1, -1, -1},
-        {6, 1, 2, 6, 5, 1, 4, 7, 8, -1, -1, -1, -1, -1, -1, -1},
-        {1, 2, 5, 5, 2, 6, 3, 0, 4, 3, 4, 7, -1, -1, -1, -1},
-        {8, 4, 7, 9, 0, 5, 0, 6, 5, 0, 2, 6, -1, -1, -1, -1},
-        {7, 3, 9, 7, 9, 4, 3, 2, 9, 5, 9, 6, 2, 6, 9, -1},
-        {3, 11, 2, 7, 8, 4, 10, 6, 5, -1, -1, -1, -1, -1, -1, -1},
-        {5, 10, 6, 4, 7, 2, 4, 2, 0, 2, 7, 11, -1, -1, -1, -1},
-        {0, 1, 9, 4, 7, 8, 2, 3, 11, 5, 10, 6, -1, -1, -1, -1},
-        {9, 2, 1, 9, 11, 2, 9, 4, 11, 7, 11, 4, 5, 10, 6, -1},
-        {8, 4, 7, 3, 11, 5, 3, 5, 1, 5, 11, 6, -1, -1, -1, -1},
-        {5, 1, 11, 5, 11, 6, 1, 0, 11, 7, 11, 4, 0, 4, 11, -1},
-        {0, 5, 9, 0, 6, 5, 0, 3, 6, 11, 6, 3, 8, 4, 7, -1},
-        {6, 5, 9, 6, 9, 11, 4, 7, 9, 7, 11, 9, -1, -1, -1, -1},
-        {10, 4, 9, 6, 4, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-        {4, 10, 6, 4, 9, 10, 0, 8, 3, -1, -1, -1, -1, -1, -1, -1},
-        {10, 0, 1, 10, 6, 0, 6, 4, 0, -1, -1, -1, -1, -1, -1, -1},
-        {8, 3, 1, 8, 1, 6, 8, 6, 4, 6, 1, 10, -1, -1, -1, -1},
-        {1, 4, 9, 1, 2, 4, 2, 6, 4, -1, -1, -1, -1, -1, -1, -1},
-        {3, 0, 8, 1, 2, 9, 2, 4, 9, 2, 6, 4, -1, -1, -1, -1},
-        {0, 2, 4, 4, 2, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-        {8, 3, 2, 8, 2, 4, 4, 2, 6, -1, -1, -1, -1, -1, -1, -1},
-        {10, 4, 9, 10, 6, 4, 11, 2, 3, -1, -1, -1, -1, -1, -1, -1},
-        {0, 8, 2, 2, 8, 11, 4, 9, 10, 4, 10, 6, -1, -1, -1, -1},
-        {3, 11, 2, 0, 1, 6, 0, 6, 4, 6, 1, 10, -1, -1, -1, -1},
-        {6, 4, 1, 6, 1, 10, 4, 8, 1, 2, 1, 11, 8, 11, 1, -1},
-        {9, 6, 4, 9, 3, 6, 9, 1, 3, 11, 6, 3, -1, -1, -1, -1},
-        {8, 11, 1, 8, 1, 0, 11, 6, 1, 9, 1, 4, 6, 4, 1, -1},
-        {3, 11, 6, 3, 6, 0, 0, 6, 4, -1, -1, -1, -1, -1, -1, -1},
-        {6, 4, 8, 11, 6, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-        {7, 10, 6, 7, 8, 10, 8, 9, 10, -1, -1, -1, -1, -1, -1, -1},
-        {0, 7, 3, 0, 10, 7, 0, 9, 10, 6, 7, 10, -1, -1, -1, -1},
-        {10, 6, 7, 1, 10, 7, 1, 7, 8, 1, 8, 0, -1, -1, -1, -1},
-        {10, 6, 7, 10, 7, 1, 1, 7, 3, -1, -1, -1, -1, -1, -1, -1},
-        {1, 2, 6, 1, 6, 8, 1, 8, 9, 8, 6, 7, -1, -1, -1, -1},
-        {2, 6, 9, 2, 9, 1, 6, 7, 9, 0, 9, 3, 7, 3, 9, -1},
-        {7, 8, 0, 7, 0, 6, 6, 0, 2, -1, -1, -1, -1, -1, -1, -1},
-        {7, 3, 2, 6, 7, 2, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-        {2, 3, 11, 10, 6, 8, 10, 8, 9, 8, 6, 7, -1, -1, -1, -1},
-        {2, 0, 7, 2, 7, 11, 0, 9, 7, 6, 7, 10, 9, 10, 7, -1},
-        {1, 8, 0, 1, 7, 8, 1, 10, 7, 6, 7, 10, 2, 3, 11, -1},
-        {11, 2, 1, 11, 1, 7, 10, 6, 1, 6, 7, 1, -1, -1, -1, -1},
-        {8, 9, 6, 8, 6, 7, 9, 1, 6, 11, 6, 3, 1, 3, 6, -1},
-        {0, 9, 1, 11, 6, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-        {7, 8, 0, 7, 0, 6, 3, 11, 0, 11, 6, 0, -1, -1, -1, -1},
-        {7, 11, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-        {7, 6, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-        {3, 0, 8, 11, 7, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-        {0, 1, 9, 11, 7, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-        {8, 1, 9, 8, 3, 1, 11, 7, 6, -1, -1, -1, -1, -1, -1, -1},
-        {10, 1, 2, 6, 11, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-        {1, 2, 10, 3, 0, 8, 6, 11, 7, -1, -1, -1, -1, -1, -1, -1},
-        {2, 9, 0, 2, 10, 9, 6, 11, 7, -1, -1, -1, -1, -1, -1, -1},
-        {6, 11, 7, 2, 10, 3, 10, 8, 3, 10, 9, 8, -1, -1, -1, -1},
-        {7, 2, 3, 6, 2, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-        {7, 0, 8, 7, 6, 0, 6, 2, 0, -1, -1, -1, -1, -1, -1, -1},
-        {2, 7, 6, 2, 3, 7, 0, 1, 9, -1, -1, -1, -1, -1, -1, -1},
-        {1, 6, 2, 1, 8, 6, 1, 9, 8, 8, 7, 6, -1, -1, -1, -1},
-        {10, 7, 6, 10, 1, 7, 1, 3, 7, -1, -1, -1, -1, -1, -1, -1},
-        {10, 7, 6, 1, 7, 10, 1, 8, 7, 1, 0, 8, -1, -1, -1, -1},
-        {0, 3, 7, 0, 7, 10, 0, 10, 9, 6, 10, 7, -1, -1, -1, -1},
-        {7, 6, 10, 7, 10, 8, 8, 10, 9, -1, -1, -1, -1, -1, -1, -1},
-        {6, 8, 4, 11, 8, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-        {3, 6, 11, 3, 0, 6, 0, 4, 6, -1, -1, -1, -1, -1, -1, -1},
-        {8, 6, 11, 8, 4, 6, 9, 0, 1, -1, -1, -1, -1, -1, -1, -1},
-        {9, 4, 6, 9, 6, 3, 9, 3, 1, 11, 3, 6, -1, -1, -1, -1},
-        {6, 8, 4, 6, 11, 8, 2, 10, 1, -1, -1, -1, -1, -1, -1, -1},
-        {1, 2, 10, 3, 0, 11, 0, 6, 11, 0, 4, 6, -1, -1, -1, -1},
-        {4, 11, 8, 4, 6, 11, 0, 2, 9, 2, 10, 9, -1, -1, -1, -1},
-        {10, 9, 3, 10, 3, 2, 9, 4, 3, 11, 3, 6, 4, 6, 3, -1},
-        {8, 2, 3, 8, 4, 2, 4, 6, 2, -1, -1, -1, -1, -1, -1, -1},
-        {0, 4, 2, 4, 6, 2, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-        {1, 9, 0, 2, 3, 4, 2, 4, 6, 4, 3, 8, -1, -1, -1, -1},
-        {1, 9, 4, 1, 4, 2, 2, 4, 6, -1, -1, -1, -1, -1, -1, -1},
-        {8, 1, 3, 8, 6, 1, 8, 4, 6, 6, 10, 1, -1, -1, -1, -1},
-        {10, 1, 0, 10, 0, 6, 6, 0, 4, -1, -1, -1, -1, -1, -1, -1},
-        {4, 6, 3, 4, 3, 8, 6, 10, 3, 0, 3, 9, 10, 9, 3, -1},
-        {10, 9, 4, 6, 10, 4, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-        {4, 9, 5, 7, 6, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-        {0, 8, 3, 4, 9, 5, 11, 7, 6, -1, -1, -1, -1, -1, -1, -1},
-        {5, 0, 1, 5, 4, 0, 7, 6, 11, -1, -1, -1, -1, -1, -1, -1},
-        {11, 7, 6, 8, 3, 4, 3, 5, 4, 3, 1, 5, -1, -1, -1, -1},
-        {9, 5, 4, 10, 1, 2, 7, 6, 11, -1, -1, -1, -1, -1, -1, -1},
-        {6, 11, 7, 1, 2, 10, 0, 8, 3, 4, 9, 5, -1, -1, -1, -1},
-        {7, 6, 11, 5, 4, 10, 4, 2, 10, 4, 0, 2, -1, -1, -1, -1},
-        {3, 4, 8, 3, 5, 4, 3, 2, 5, 10, 5, 2, 11, 7, 6, -1},
-        {7, 2, 3, 7, 6, 2, 5, 4, 9, -1, -1, -1, -1, -1, -1, -1},
-        {9, 5, 4, 0, 8, 6, 0, 6, 2, 6, 8, 7, -1, -1, -1, -1},
-        {3, 6, 2, 3, 7, 6, 1, 5, 0, 5, 4, 0, -1, -1, -1, -1},
-        {6, 2, 8, 6, 8, 7, 2, 1, 8, 4, 8, 5, 1, 5, 8, -1},
-        {9, 5, 4, 10, 1, 6, 1, 7, 6, 1, 3, 7, -1, -1, -1, -1},
-        {1, 6, 10, 1, 7, 6, 1, 0, 7, 8, 7, 0, 9, 5, 4, -1},
-        {4, 0, 10, 4, 10, 5, 0, 3, 10, 6, 10, 7, 3, 7, 10, -1},
-        {7, 6, 10, 7, 10, 8, 5, 4, 10, 4, 8, 10, -1, -1, -1, -1},
-        {6, 9, 5, 6, 11, 9, 11, 8, 9, -1, -1, -1, -1, -1, -1, -1},
-        {3, 6, 11, 0, 6, 3, 0, 5, 6, 0, 9, 5, -1, -1, -1, -1},
-        {0, 11, 8, 0, 5, 11, 0, 1, 5, 5, 6, 11, -1, -1, -1, -1},
-        {6, 11, 3, 6, 3, 5, 5, 3, 1, -1, -1, -1, -1, -1, -1, -1},
-        {1, 2, 10, 9, 5, 11, 9, 11, 8, 11, 5, 6, -1, -1, -1, -1},
-        {0, 11, 3, 0, 6, 11, 0, 9, 6, 5, 6, 9, 1, 2, 10, -1},
-        {11, 8, 5, 11, 5, 6, 8, 0, 5, 10, 5, 2, 0, 2, 5, -1},
-        {6, 11, 3, 6, 3, 5, 2, 10, 3, 10, 5, 3, -1, -1, -1, -1},
-        {5, 8, 9, 5, 2, 8, 5, 6, 2, 3, 8, 2, -1, -1, -1, -1},
-        {9, 5, 6, 9, 6, 0, 0, 6, 2, -1, -1, -1, -1, -1, -1, -1},
-        {1, 5, 8, 1, 8, 0, 5, 6, 8, 3, 8, 2, 6, 2, 8, -1},
-        {1, 5, 6, 2, 1, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-        {1, 3, 6, 1, 6, 10, 3, 8, 6, 5, 6, 9, 8, 9, 6, -1},
-        {10, 1, 0, 10, 0, 6, 9, 5, 0, 5, 6, 0, -1, -1, -1, -1},
-        {0, 3, 8, 5, 6, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-        {10, 5, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-        {11, 5, 10, 7, 5, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-        {11, 5, 10, 11, 7, 5, 8, 3, 0, -1, -1, -1, -1, -1, -1, -1},
-        {5, 11, 7, 5, 10, 11, 1, 9, 0, -1, -1, -1, -1, -1, -1, -1},
-        {10, 7, 5, 10, 11, 7, 9, 8, 1, 8, 3, 1, -1, -1, -1, -1},
-        {11, 1, 2, 11, 7, 1, 7, 5, 1, -1, -1, -1, -1, -1, -1, -1},
-        {0, 8, 3, 1, 2, 7, 1, 7, 5, 7, 2, 11, -1, -1, -1, -1},
-        {9, 7, 5, 9, 2, 7, 9, 0, 2, 2, 11, 7, -1, -1, -1, -1},
-        {7, 5, 2, 7, 2, 11, 5, 9, 2, 3, 2, 8, 9, 8, 2, -1},
-        {2, 5, 10, 2, 3, 5, 3, 7, 5, -1, -1, -1, -1, -1, -1, -1},
-        {8, 2, 0, 8, 5, 2, 8, 7, 5, 10, 2, 5, -1, -1, -1, -1},
-        {9, 0, 1, 5, 10, 3, 5, 3, 7, 3, 10, 2, -1, -1, -1, -1},
-        {9, 8, 2, 9, 2, 1, 8, 7, 2, 10, 2, 5, 7, 5, 2, -1},
-        {1, 3, 5, 3, 7, 5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-        {0, 8, 7, 0, 7, 1, 1, 7, 5, -1, -1, -1, -1, -1, -1, -1},
-        {9, 0, 3, 9, 3, 5, 5, 3, 7, -1, -1, -1, -1, -1, -1, -1},
-        {9, 8, 7, 5, 9, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-        {5, 8, 4, 5, 10, 8, 10, 11, 8, -1, -1, -1, -1, -1, -1, -1},
-        {5, 0, 4, 5, 11, 0, 5, 10, 11, 11, 3, 0, -1, -1, -1, -1},
-        {0, 1, 9, 8, 4, 10, 8, 10, 11, 10, 4, 5, -1, -1, -1, -1},
-        {10, 11, 4, 10, 4, 5, 11, 3, 4, 9, 4, 1, 3, 1, 4, -1},
-        {2, 5, 1, 2, 8, 5, 2, 11, 8, 4, 5, 8, -1, -1, -1, -1},
-        {0, 4, 11, 0, 11, 3, 4, 5, 11, 2, 11, 1, 5, 1, 11, -1},
-        {0, 2, 5, 0, 5, 9, 2, 11, 5, 4, 5, 8, 11, 8, 5, -1},
-        {9, 4, 5, 2, 11, 3, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-        {2, 5, 10, 3, 5, 2, 3, 4, 5, 3, 8, 4, -1, -1, -1, -1},
-        {5, 10, 2, 5, 2, 4, 4, 2, 0, -1, -1, -1, -1, -1, -1, -1},
-        {3, 10, 2, 3, 5, 10, 3, 8, 5, 4, 5, 8, 0, 1, 9, -1},
-        {5, 10, 2, 5, 2, 4, 1, 9, 2, 9, 4, 2, -1, -1, -1, -1},
-        {8, 4, 5, 8, 5, 3, 3, 5, 1, -1, -1, -1, -1, -1, -1, -1},
-        {0, 4, 5, 1, 0, 5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-        {8, 4, 5, 8, 5, 3, 9, 0, 5, 0, 3, 5, -1, -1, -1, -1},
-        {9, 4, 5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-        {4, 11, 7, 4, 9, 11, 9, 10, 11, -1, -1, -1, -1, -1, -1, -1},
-        {0, 8, 3, 4, 9, 7, 9, 11, 7, 9, 10, 11, -1, -1, -1, -1},
-        {1, 10, 11, 1, 11, 4, 1, 4, 0, 7, 4, 11, -1, -1, -1, -1},
-        {3, 1, 4, 3, 4, 8, 1, 10, 4, 7, 4, 11, 10, 11, 4, -1},
-        {4, 11, 7, 9, 11, 4, 9, 2, 11, 9, 1, 2, -1, -1, -1, -1},
-        {9, 7, 4, 9, 11, 7, 9, 1, 11, 2, 11, 1, 0, 8, 3, -1},
-        {11, 7, 4, 11, 4, 2, 2, 4, 0, -1, -1, -1, -1, -1, -1, -1},
-        {11, 7, 4, 11, 4, 2, 8, 3, 4, 3, 2, 4, -1, -1, -1, -1},
-        {2, 9, 10, 2, 7, 9, 2, 3, 7, 7, 4, 9, -1, -1, -1, -1},
-        {9, 10, 7, 9, 7, 4, 10, 2, 7, 8, 7, 0, 2, 0, 7, -1},
-        {3, 7, 10, 3, 10, 2, 7, 4, 10, 1, 10, 0, 4, 0, 10, -1},
-        {1, 10, 2, 8, 7, 4, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-        {4, 9, 1, 4, 1, 7, 7, 1, 3, -1, -1, -1, -1, -1, -1, -1},
-        {4, 9, 1, 4, 1, 7, 0, 8, 1, 8, 7, 1, -1, -1, -1, -1},
-        {4, 0, 3, 7, 4, 3, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-        {4, 8, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-        {9, 10, 8, 10, 11, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-        {3, 0, 9, 3, 9, 11, 11, 9, 10, -1, -1, -1, -1, -1, -1, -1},
-        {0, 1, 10, 0, 10, 8, 8, 10, 11, -1, -1, -1, -1, -1, -1, -1},
-        {3, 1, 10, 11, 3, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-        {1, 2, 11, 1, 11, 9, 9, 11, 8, -1, -1, -1, -1, -1, -1, -1},
-        {3, 0, 9, 3, 9, 11, 1, 2, 9, 2, 11, 9, -1, -1, -1, -1},
-        {0, 2, 11, 8, 0, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-        {3, 2, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-        {2, 3, 8, 2, 8, 10, 10, 8, 9, -1, -1, -1, -1, -1, -1, -1},
-        {9, 10, 2, 0, 9, 2, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-        {2, 3, 8, 2, 8, 10, 0, 1, 8, 1, 10, 8, -1, -1, -1, -1},
-        {1, 10, 2, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-        {1, 3, 8, 9, 1, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-        {0, 9, 1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-        {0, 3, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-        {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1}
-    };
-
-    // Collect the grid corner values
-    float values[CORNERS_PER_VOXEL];
-    glm::vec3 positions[CORNERS_PER_VOXEL];
-    for (int i = 0; i < CORNERS_PER_VOXEL; i++)
-    {
-        float position[3];
-        m_grid.getPoint(corners[i], position);
-        values[i] = m_grid.pointScalars()->getC0Scalar(corners[i]);
-
-        positions[i].x = position[0];
-        positions[i].y = position[1];
-        positions[i].z = position[2];
-    }
-
-    // Determine the index into the edge table which tells us which vertices are inside of the surface
-    int code = 0;
-    if (values[0] < isoValue) { code |= 1; }
-    if (values[1] < isoValue) { code |= 2; }
-    if (values[2] < isoValue) { code |= 4; }
-    if (values[3] < isoValue) { code |= 8; }
-    if (values[4] < isoValue) { code |= 16; }
-    if (values[5] < isoValue) { code |= 32; }
-    if (values[6] < isoValue) { code |= 64; }
-    if (values[7] < isoValue) { code |= 128; }
-
-    // Cube is entirely in/out of the surface
-    if (edgeTable[code] == 0)
-    {
-        return 0;
-    }
-
-    // Find the vertices where the surface intersects the cube
-    glm::vec3 vertices[12];
-    if (edgeTable[code] & 1)    { vertices[0]  = this->vertexInterpolation(isoValue, positions[0], positions[1], values[0], values[1]); }
-    if (edgeTable[code] & 2)    { vertices[1]  = this->vertexInterpolation(isoValue, positions[1], positions[2], values[1], values[2]); }
-    if (edgeTable[code] & 4)    { vertices[2]  = this->vertexInterpolation(isoValue, positions[2], positions[3], values[2], values[3]); }
-    if (edgeTable[code] & 8)    { vertices[3]  = this->vertexInterpolation(isoValue, positions[3], positions[0], values[3], values[0]); }
-    if (edgeTable[code] & 16)   { vertices[4]  = this->vertexInterpolation(isoValue, positions[4], positions[5], values[4], values[5]); }
-    if (edgeTable[code] & 32)   { vertices[5]  = this->vertexInterpolation(isoValue, positions[5], positions[6], values[5], values[6]); }
-    if (edgeTable[code] & 64)   { vertices[6]  = this->vertexInterpolation(isoValue, positions[6], positions[7], values[6], values[7]); }
-    if (edgeTable[code] & 128)  { vertices[7]  = this->vertexInterpolation(isoValue, positions[7], positions[4], values[7], values[4]); }
-    if (edgeTable[code] & 256)  { vertices[8]  = this->vertexInterpolation(isoValue, positions[0], positions[4], values[0], values[4]); }
-    if (edgeTable[code] & 512)  { vertices[9]  = this->vertexInterpolation(isoValue, positions[1], positions[5], values[1], values[5]); }
-    if (edgeTable[code] & 1024) { vertices[10] = this->vertexInterpolation(isoValue, positions[2], positions[6], values[2], values[6]); }
-    if (edgeTable[code] & 2048) { vertices[11] = this->vertexInterpolation(isoValue, positions[3], positions[7], values[3], values[7]); }
-
-    // Create the vertices
-    float min = m_grid.pointScalars()->getMin();
-    float max = m_grid.pointScalars()->getMax();
-    int numVertices = 0;
-    while (triangleTable[code][numVertices] != -1)
-    {
-        glm::vec3 a = vertices[triangleTable[code][numVertices + 0]];
-        glm::vec3 b = vertices[triangleTable[code][numVertices + 1]];
-        glm::vec3 c = vertices[triangleTable[code][numVertices + 2]];
-        glm::vec3 n = glm::normalize(glm::cross(b - a, c - a));
-
-        buffer[numVertices].position = a;
-        buffer[numVertices].normal = n;
-        buffer[numVertices++].colorNorm = computeNorm(isoValue, min, max);
-        buffer[numVertices].position = b;
-        buffer[numVertices].normal = n;
-        buffer[numVertices++].colorNorm = computeNorm(isoValue, min, max);
-        buffer[numVertices].position = c;
-        buffer[numVertices].normal = n;
-        buffer[numVertices++].colorNorm = computeNorm(isoValue, min, max);
-    }
-
-    return numVertices;
+    if (lods.empty() && !surface.segments.empty())
+    {
+        uploadSegments(surface);
+        return;
+    }
+
+    clearSegments();
+    std::vector<const IsoSurface*> levels(1, &surface);
+    size_t numVertices = surface.vertices.size();
+    size_t numIndices = surface.indices.size();
+    m_lods.clear();
+    for (const IsoSurfaceLod& lod : lods)
+    {
+        MeshLod meshLod;
+        meshLod.error = lod.error;
+        meshLod.baseVertex = (int)numVertices;
+        meshLod.firstIndex = (int)numIndices;
+        meshLod.numIndices = (int)lod.surface.indices.size();
+        m_lods.push_back(meshLod);
+        levels.push_back(&lod.surface);
+        numVertices += lod.surface.vertices.size();
+        numIndices += lod.surface.indices.size();
+    }
+
+    size_t vertexSize = m_quantized ? sizeof(PackedMeshVertex) : sizeof(MeshVertexAttribute);
+    glBufferData(GL_ARRAY_BUFFER, vertexSize * numVertices, nullptr, GL_STATIC_DRAW);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint32_t) * numIndices, nullptr, GL_STATIC_DRAW);
+    m_colorRuns.clear();
+    std::vector<PackedMeshVertex> packed;
+    for (size_t i = 0; i < levels.size(); i++)
+    {
+        const IsoSurface& levelSurface = *levels[i];
+        size_t baseVertex = (i > 0) ? m_lods[i - 1].baseVertex : 0;
+        size_t firstIndex = (i > 0) ? m_lods[i - 1].firstIndex : 0;
+        uploadVertices(baseVertex, levelSurface.vertices.data(), levelSurface.vertices.size(), packed);
+        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint32_t) * firstIndex, sizeof(uint32_t) * levelSurface.indices.size(), levelSurface.indices.data());
+        m_colorRuns.push_back(colorRuns(levelSurface, m_quantized));
+    }
+
+    m_numVertices = surface.vertices.size();
+    m_numIndices = surface.indices.size();
+
+    // Bounding sphere of the full resolution surface, for the distance the levels are picked by
+    glm::vec3 min(INFINITY);
+    glm::vec3 max(-INFINITY);
+    for (const MeshVertexAttribute& vertex : surface.vertices)
+    {
+        min = glm::min(min, vertex.position);
+        max = glm::max(max, vertex.position);
+    }
+
+    m_boundsCenter = surface.vertices.empty() ? glm::vec3(0.0f) : 0.5f * (min + max);
+    m_boundsRadius = surface.vertices.empty() ? 0.0f : 0.5f * glm::length(max - min);
+    setVertexFormat(m_quantized);
 }
 
-// Linearly interpolate the position where an isosurface cuts an edge between two vertices, each with their own scalar value
-glm::vec3 Mesh::vertexInterpolation(float isoValue, glm::vec3& p1, glm::vec3& p2, double p1Value, double p2Value)
+// Surfaces extracted in bricks keep a segment per brick in both buffers, in ranges given out by the allocators.
+// Segments whose key is still there stay where they are, only the new ones are uploaded, and the buffers grow
+// by copying on the GPU when the free ranges run short. All segments sharing a color norm are drawn at once.
+void Mesh::uploadSegments(const IsoSurface& surface)
 {
-    if (abs(isoValue - p1Value) < 0.00001) { return p1; }
-    if (abs(isoValue - p2Value) < 0.00001) { return p2; }
-    if (abs(p1Value - p2Value)  < 0.00001) { return p1; }
+    size_t vertexSize = m_quantized ? sizeof(PackedMeshVertex) : sizeof(MeshVertexAttribute);
+    if (vertexSize != m_segmentVertexSize)
+    {
+        clearSegments();
+        m_segmentVertexSize = vertexSize;
+    }
 
-    double mu = (isoValue - p1Value) / (p2Value - p1Value);
+    std::unordered_map<uint64_t, const IsoSurfaceSegment*> current;
+    for (const IsoSurfaceSegment& segment : surface.segments)
+    {
+        if (segment.numVertices > 0)
+        {
+            current[segment.key] = &segment;
+        }
+    }
 
-    glm::vec3 p;
-    p.x = p1.x + mu * (p2.x - p1.x);
-    p.y = p1.y + mu * (p2.y - p1.y);
-    p.z = p1.z + mu * (p2.z - p1.z);
+    for (auto segment = m_segments.begin(); segment != m_segments.end();)
+    {
+        if (current.count(segment->first) == 0)
+        {
+            m_segmentVertexRanges.free(segment->second.firstVertex, segment->second.numVertices);
+            m_segmentIndexRanges.free(segment->second.firstIndex, segment->second.numIndices);
+            segment = m_segments.erase(segment);
+        }
+        else
+        {
+            ++segment;
+        }
+    }
+
+    std::vector<const IsoSurfaceSegment*> added;
+    size_t numVertices = 0;
+    size_t numIndices = 0;
+    for (const auto& segment : current)
+    {
+        if (m_segments.count(segment.first) == 0)
+        {
+            added.push_back(segment.second);
+            numVertices += segment.second->numVertices;
+            numIndices += segment.second->numIndices;
+        }
+    }
+
+    // Grow once for the whole change, then again only for the segments the fragmented free ranges cannot hold
+    if (m_segmentVertexRanges.capacity() - m_segmentVertexRanges.used() < numVertices)
+    {
+        growBuffer(GL_ARRAY_BUFFER, m_segmentVertexRanges, vertexSize, numVertices);
+    }
+
+    if (m_segmentIndexRanges.capacity() - m_segmentIndexRanges.used() < numIndices)
+    {
+        growBuffer(GL_ELEMENT_ARRAY_BUFFER, m_segmentIndexRanges, sizeof(uint32_t), numIndices);
+    }
+
+    std::vector<PackedMeshVertex> packed;
+    std::vector<uint32_t> indices;
+    for (const IsoSurfaceSegment* segment : added)
+    {
+        MeshSegment meshSegment;
+        meshSegment.numVertices = segment->numVertices;
+        meshSegment.numIndices = segment->numIndices;
+        meshSegment.colorNorm = surface.vertices[segment->firstVertex].colorNorm;
+        if (!m_segmentVertexRanges.allocate(segment->numVertices, meshSegment.firstVertex))
+        {
+            growBuffer(GL_ARRAY_BUFFER, m_segmentVertexRanges, vertexSize, segment->numVertices);
+            m_segmentVertexRanges.allocate(segment->numVertices, meshSegment.firstVertex);
+        }
+
+        if (!m_segmentIndexRanges.allocate(segment->numIndices, meshSegment.firstIndex))
+        {
+            growBuffer(GL_ELEMENT_ARRAY_BUFFER, m_segmentIndexRanges, sizeof(uint32_t), segment->numIndices);
+            m_segmentIndexRanges.allocate(segment->numIndices, meshSegment.firstIndex);
+        }
+
+        uploadVertices(meshSegment.firstVertex, surface.vertices.data() + segment->firstVertex, segment->numVertices, packed);
+
+        // Indices relative to the first vertex of the segment, drawn with it as the base vertex
+        if (segment->numIndices > 0)
+        {
+            indices.resize(segment->numIndices);
+            for (size_t i = 0; i < indices.size(); i++)
+            {
+                indices[i] = surface.indices[segment->firstIndex + i] - (uint32_t)segment->firstVertex;
+            }
+
+            glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint32_t) * meshSegment.firstIndex, sizeof(uint32_t) * indices.size(), indices.data());
+        }
+
+        m_segments[segment->key] = meshSegment;
+    }
 
-    return p;
-}
\ No newline at end of file
+    // One batch for every color norm when quantized, the vertices carry it otherwise
+    std::map<float, MeshSegmentBatch> batches;
+    for (const auto& segment : m_segments)
+    {
+        const MeshSegment& meshSegment = segment.second;
+        float colorNorm = m_quantized ? meshSegment.colorNorm : 0.0f;
+        MeshSegmentBatch& batch = batches[colorNorm];
+        batch.colorNorm = colorNorm;
+        if (surface.indexed())
+        {
+            batch.counts.push_back((GLsizei)meshSegment.numIndices);
+            batch.offsets.push_back((const void*)(sizeof(uint32_t) * meshSegment.firstIndex));
+            batch.baseVertices.push_back((GLint)meshSegment.firstVertex);
+        }
+        else
+        {
+            batch.counts.push_back((GLsizei)meshSegment.numVertices);
+            batch.firsts.push_back((GLint)meshSegment.firstVertex);
+        }
+    }
+
+    m_segmentBatches.clear();
+    for (auto& batch : batches)
+    {
+        m_segmentBatches.push_back(std::move(batch.second));
+    }
+
+    m_lods.clear();
+    m_colorRuns.assign(1, std::vector<MeshColorRun>());
+    m_numVertices = surface.vertices.size();
+    m_numIndices = surface.indices.size();
+    setVertexFormat(m_quantized);
+}
+
+// Forgets the segments once a whole surface replaces the contents of the buffers
+void Mesh::clearSegments()
+{
+    m_segments.clear();
+    m_segmentBatches.clear();
+    m_segmentVertexRanges.clear();
+    m_segmentIndexRanges.clear();
+}
+
+// Reallocates the buffer bound to target for at least size more units, keeping its contents by copying them
+// through a temporary buffer. Grows by half again what is needed so small changes do not copy every time.
+void Mesh::growBuffer(GLenum target, RangeAllocator& ranges, size_t unitSize, size_t size)
+{
+    size_t capacity = ranges.capacity() + size + (ranges.capacity() + size) / 2;
+    size_t bytes = unitSize * ranges.capacity();
+    if (bytes == 0)
+    {
+        glBufferData(target, unitSize * capacity, nullptr, GL_DYNAMIC_DRAW);
+    }
+    else
+    {
+        GLuint copy;
+        glGenBuffers(1, &copy);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, copy);
+        glBufferData(GL_COPY_WRITE_BUFFER, bytes, nullptr, GL_STREAM_COPY);
+        glCopyBufferSubData(target, GL_COPY_WRITE_BUFFER, 0, 0, bytes);
+        glBufferData(target, unitSize * capacity, nullptr, GL_DYNAMIC_DRAW);
+        glCopyBufferSubData(GL_COPY_WRITE_BUFFER, target, 0, 0, bytes);
+        glDeleteBuffers(1, &copy);
+    }
+
+    ranges.grow(capacity);
+}
+
+// Writes vertices into the bound vertex buffer from firstVertex on, packed when quantized.
+// Packed vertices are quantized to the bounding box of the grid, which holds every extracted surface.
+void Mesh::uploadVertices(size_t firstVertex, const MeshVertexAttribute* vertices, size_t numVertices, std::vector<PackedMeshVertex>& packed)
+{
+    if (m_quantized)
+    {
+        const Volume& volume = m_grid.volume();
+        glm::vec3 origin = volume.origin;
+        glm::vec3 extent = volume.spacing * glm::vec3(volume.numPointsX - 1, volume.numPointsY - 1, volume.numPointsZ - 1);
+        glm::vec3 scale = glm::max(extent, glm::vec3(1.0e-6f)) / 65535.0f;
+        packed.resize(numVertices);
+        for (size_t v = 0; v < numVertices; v++)
+        {
+            const MeshVertexAttribute& vertex = vertices[v];
+            glm::vec3 steps = glm::clamp((vertex.position - origin) / scale, glm::vec3(0.0f), glm::vec3(65535.0f));
+            packed[v].position[0] = (uint16_t)round(steps.x);
+            packed[v].position[1] = (uint16_t)round(steps.y);
+            packed[v].position[2] = (uint16_t)round(steps.z);
+            packed[v].padding = 0;
+            encodeOctahedral(vertex.normal, packed[v].normal);
+        }
+
+        glBufferSubData(GL_ARRAY_BUFFER, sizeof(PackedMeshVertex) * firstVertex, sizeof(PackedMeshVertex) * numVertices, packed.data());
+    }
+    else
+    {
+        glBufferSubData(GL_ARRAY_BUFFER, sizeof(MeshVertexAttribute) * firstVertex, sizeof(MeshVertexAttribute) * numVertices, vertices);
+    }
+}
+
+void Mesh::setVertexFormat(bool quantized)
+{
+    if (quantized)
+    {
+        const Volume& volume = m_grid.volume();
+        glm::vec3 extent = volume.spacing * glm::vec3(volume.numPointsX - 1, volume.numPointsY - 1, volume.numPointsZ - 1);
+        m_shader->setBufferPositionQuantized(sizeof(PackedMeshVertex), offsetof(PackedMeshVertex, position));
+        m_shader->setBufferNormalOctahedral(sizeof(PackedMeshVertex), offsetof(PackedMeshVertex, normal));
+        m_shader->setQuantization(true, volume.origin, glm::max(extent, glm::vec3(1.0e-6f)));
+    }
+    else
+    {
+        m_shader->setBufferPosition(sizeof(MeshVertexAttribute), offsetof(MeshVertexAttribute, position));
+        m_shader->setBufferNormal(sizeof(MeshVertexAttribute), offsetof(MeshVertexAttribute, normal));
+        m_shader->setBufferColorNorm(sizeof(MeshVertexAttribute), offsetof(MeshVertexAttribute, colorNorm));
+        m_shader->setQuantization(false);
+    }
+}
+
+// Makes the GPU extractor the first time it is needed, GPU extraction stays off once the context cannot run it
+bool Mesh::useGpu()
+{
+    if (!m_gpuExtraction || m_clipped || (m_method != ISOSURFACE_MARCHING_CUBES && m_method != ISOSURFACE_FLYING_EDGES))
+    {
+        return false;
+    }
+
+    if (m_gpuExtractor == nullptr)
+    {
+        if (!GpuExtractor::supported())
+        {
+            m_gpuExtraction = false;
+            return false;
+        }
+
+        m_gpuExtractor = new GpuExtractor(m_grid.volume());
+    }
+
+    if (!m_gpuExtractor->valid())
+    {
+        m_gpuExtraction = false;
+        return false;
+    }
+
+    return true;
+}
+
+// The surfaces stay in the vertex buffer of the extractor, which the vertex array reads until the CPU uploads
+// a surface again. Every surface is a run of full vertices carrying their own color norm.
+bool Mesh::extractOnGpu()
+{
+    bool extracted = m_gpuExtractor->extract(m_isoValues);
+    m_shader->use();
+    if (!extracted)
+    {
+        return false;
+    }
+
+    const Volume& volume = m_grid.volume();
+    const std::vector<size_t>& numVertices = m_gpuExtractor->numVertices();
+    clearSegments();
+    m_lods.clear();
+    m_colorRuns.assign(1, std::vector<MeshColorRun>());
+    int first = 0;
+    for (size_t i = 0; i < numVertices.size(); i++)
+    {
+        m_colorRuns[0].push_back({ first, (int)numVertices[i], (m_isoValues[i] - volume.min) / (volume.max - volume.min) });
+        first += (int)numVertices[i];
+    }
+
+    m_numVertices = first;
+    m_numIndices = 0;
+
+    GLint vertexBuffer;
+    glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &vertexBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, m_gpuExtractor->vertexBuffer());
+    setVertexFormat(false);
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+
+    return true;
+}
+
+// The coarsest level whose error projects to at most m_pixelError pixels, -1 for the full resolution surface.
+// An error e at view distance d spans e * height * projection[1][1] / (2 * d) pixels, d measured to the
+// nearest point of the bounding sphere so no part of the surface is drawn coarser than allowed.
+int Mesh::selectLevel(const glm::mat4& modelView) const
+{
+    if (m_lods.empty())
+    {
+        return -1;
+    }
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    const glm::mat4& projection = m_camera->projection();
+    float scale = glm::length(glm::vec3(modelView[0]));
+    float pixelsPerUnit = 0.5f * viewport[3] * projection[1][1] * scale;
+
+    // Orthographic projections leave w at 1 and the size on screen independent of the distance
+    if (projection[2][3] != 0.0f)
+    {
+        glm::vec4 center = modelView * glm::vec4(m_boundsCenter, 1.0f);
+        float distance = -center.z - m_boundsRadius * scale;
+        if (distance <= 0.0f)
+        {
+            return -1;
+        }
+
+        pixelsPerUnit /= distance;
+    }
+
+    int level = -1;
+    for (int i = 0; i < (int)m_lods.size(); i++)
+    {
+        if (m_lods[i].error * pixelsPerUnit <= m_pixelError)
+        {
+            level = i;
+        }
+    }
+
+    return level;
+}
+
+// Runs on the scheduler's thread, only extracting the surfaces that are in neither tier of the cache, all in
+// one sweep over the grid's min max octree, which is built the first time it is needed. Previews from the coarse
+// levels of the grid's pyramid are published first, each level costing an eighth of the one above it.
+// With levels of detail on the full resolution surface is published as well while it is decimated.
+// Clipped surfaces skip the cache and the previews, the region extractor keeps the bricks they came from.
+// With view priority the surfaces are extracted by the region extractor as well, the bricks in view first,
+// and the visible part is published ahead of the rest in place of the previews. Without levels of detail its
+// surfaces are segmented, their bricks are not welded to each other, and cached apart from welded ones.
+bool Mesh::extractSurface(IsoSurfaceExtractor& extractor, const std::vector<float>& isoValues, IsoSurface& surface)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_lodMutex);
+        m_lodChain.clear();
+        m_lodChainIsoValues.clear();
+    }
+
+    bool indexed = m_indexed;
+    IsoSurfaceMethod method = (IsoSurfaceMethod)m_method.load();
+    bool viewPriority = m_viewPriority;
+    ClipRegion region;
+    bool clipped;
+    glm::mat4 modelView;
+    glm::mat4 projection;
+    {
+        std::lock_guard<std::mutex> lock(m_clipMutex);
+        region = m_clipRegion;
+        clipped = m_clipped;
+        modelView = m_viewModelView;
+        projection = m_viewProjection;
+    }
+
+    int numLevels = m_numLevels;
+    bool segmented = (clipped || viewPriority) && numLevels == 0;
+    std::vector<IsoSurfaceKey> keys;
+    std::vector<IsoSurface> surfaces(isoValues.size());
+    std::vector<float> missingIsoValues;
+    std::vector<size_t> missing;
+    for (size_t i = 0; i < isoValues.size(); i++)
+    {
+        keys.push_back(IsoSurfaceKey(m_grid.checksum(), m_grid.volume(), isoValues[i], indexed, method, segmented));
+        if (clipped || !IsoSurfaceCache::instance().find(keys[i], surfaces[i]))
+        {
+            missingIsoValues.push_back(isoValues[i]);
+            missing.push_back(i);
+        }
+    }
+
+    m_numCachedSurfaces = (int)(isoValues.size() - missing.size());
+
+    if (!missing.empty() && m_preview && !clipped && !viewPriority)
+    {
+        const VolumePyramid& pyramid = m_grid.pyramid();
+        for (int level = pyramid.numLevels() - 1; level > 0; level--)
+        {
+            std::vector<IsoSurface> extracted;
+            IsoSurfaceExtractor coarseExtractor(pyramid.level(level));
+            coarseExtractor.setIndexed(indexed);
+            coarseExtractor.setMethod(method);
+            if (!coarseExtractor.extract(missingIsoValues, extracted))
+            {
+                return false;
+            }
+
+            // Cached levels are shown at full resolution already
+            IsoSurface preview;
+            for (size_t i = 0, j = 0; i < surfaces.size(); i++)
+            {
+                bool coarse = (j < missing.size() && missing[j] == i);
+                preview.append(coarse ? extracted[j++] : surfaces[i]);
+            }
+
+            if (!m_scheduler->publish(preview))
+            {
+                return false;
+            }
+        }
+    }
+
+    if (!missing.empty() && (clipped || viewPriority))
+    {
+        if (m_regionExtractor == nullptr)
+        {
+            m_regionExtractor = new RegionExtractor(m_grid.volume(), &m_grid.minMaxOctree());
+        }
+
+        if (viewPriority)
+        {
+            m_regionExtractor->setView(modelView, projection);
+        }
+        else
+        {
+            m_regionExtractor->clearView();
+        }
+
+        // The visible part of the missing surfaces is shown along with the cached ones
+        auto publishVisible = [&](const std::vector<IsoSurface>& visible)
+        {
+            IsoSurface preview;
+            for (size_t i = 0, j = 0; i < surfaces.size(); i++)
+            {
+                bool partial = (j < missing.size() && missing[j] == i);
+                preview.append(partial ? visible[j++] : surfaces[i]);
+            }
+
+            return m_scheduler->publish(preview);
+        };
+
+        std::vector<IsoSurface> extracted;
+        m_regionExtractor->setRegion(region);
+        m_regionExtractor->setIndexed(indexed);
+        m_regionExtractor->setMethod(method);
+        m_regionExtractor->setSegmented(segmented);
+        m_regionExtractor->setCancelFlag(extractor.cancelFlag());
+        if (!m_regionExtractor->extract(missingIsoValues, extracted, viewPriority ? publishVisible : RegionExtractor::PartialFunction()))
+        {
+            return false;
+        }
+
+        for (size_t i = 0; i < missing.size(); i++)
+        {
+            if (!clipped)
+            {
+                IsoSurfaceCache::instance().insert(keys[missing[i]], extracted[i]);
+            }
+
+            surfaces[missing[i]].vertices.swap(extracted[i].vertices);
+            surfaces[missing[i]].indices.swap(extracted[i].indices);
+            surfaces[missing[i]].segments.swap(extracted[i].segments);
+        }
+    }
+    else if (!missing.empty())
+    {
+        std::vector<IsoSurface> extracted;
+        extractor.setIndexed(indexed);
+        extractor.setMethod(method);
+        extractor.setMinMaxOctree(&m_grid.minMaxOctree());
+        if (!extractor.extract(missingIsoValues, extracted))
+        {
+            return false;
+        }
+
+        for (size_t i = 0; i < missing.size(); i++)
+        {
+            IsoSurfaceCache::instance().insert(keys[missing[i]], extracted[i]);
+            surfaces[missing[i]].vertices.swap(extracted[i].vertices);
+            surfaces[missing[i]].indices.swap(extracted[i].indices);
+        }
+    }
+
+    surface = IsoSurface();
+    for (const IsoSurface& levelSurface : surfaces)
+    {
+        surface.append(levelSurface);
+    }
+
+    if (numLevels > 0)
+    {
+        IsoSurface full = surface;
+        if (!m_scheduler->publish(full))
+        {
+            return false;
+        }
+
+        // The first level may move the surface by up to a grid cell, every next one twice as far
+        const glm::vec3& spacing = m_grid.volume().spacing;
+        std::vector<IsoSurfaceLod> chain;
+        MeshDecimator decimator;
+        decimator.setCancelFlag(extractor.cancelFlag());
+        if (!decimator.buildChain(surface, std::min(spacing.x, std::min(spacing.y, spacing.z)), numLevels, chain))
+        {
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(m_lodMutex);
+        m_lodChain.swap(chain);
+        m_lodChainIsoValues = isoValues;
+    }
+
+    return true;
+}
@@ -0,0 +1,589 @@
+#pragma once
+#include <mesh_decimator.h>
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <queue>
+#include <unordered_map>
+
+#define REMOVED_TRIANGLE 0xFFFFFFFFu
+
+// Passes over the blocks per level, every other pass with the blocks shifted by half their size
+#define DECIMATION_PASSES 2
+
+// A collapse is rejected when it turns any remaining triangle further than this, as the cosine between its normals
+#define DECIMATION_MIN_NORMAL_COS 0.2
+
+// Fewest vertices worth a block of their own, smaller surfaces are split into fewer blocks so the block
+// borders that hold edges back do not make up most of the surface
+#define DECIMATION_MIN_BLOCK_VERTICES 4096
+
+void MeshDecimator::Quadric::addPlane(const glm::dvec3& normal, double d)
+{
+	a00 += normal.x * normal.x;
+	a01 += normal.x * normal.y;
+	a02 += normal.x * normal.z;
+	a11 += normal.y * normal.y;
+	a12 += normal.y * normal.z;
+	a22 += normal.z * normal.z;
+	b0 += normal.x * d;
+	b1 += normal.y * d;
+	b2 += normal.z * d;
+	c += d * d;
+}
+
+void MeshDecimator::Quadric::add(const Quadric& other)
+{
+	a00 += other.a00;
+	a01 += other.a01;
+	a02 += other.a02;
+	a11 += other.a11;
+	a12 += other.a12;
+	a22 += other.a22;
+	b0 += other.b0;
+	b1 += other.b1;
+	b2 += other.b2;
+	c += other.c;
+}
+
+double MeshDecimator::Quadric::error(const glm::dvec3& p) const
+{
+	double error = a00 * p.x * p.x + a11 * p.y * p.y + a22 * p.z * p.z
+		+ 2.0 * (a01 * p.x * p.y + a02 * p.x * p.z + a12 * p.y * p.z)
+		+ 2.0 * (b0 * p.x + b1 * p.y + b2 * p.z) + c;
+
+	return std::max(error, 0.0);
+}
+
+// Solves A p = -b, fails when the planes are close to parallel and leave the minimum along a line or plane
+bool MeshDecimator::Quadric::minimum(glm::dvec3& p) const
+{
+	double c00 = a11 * a22 - a12 * a12;
+	double c01 = a02 * a12 - a01 * a22;
+	double c02 = a01 * a12 - a02 * a11;
+	double determinant = a00 * c00 + a01 * c01 + a02 * c02;
+	if (fabs(determinant) < 1.0e-6)
+	{
+		return false;
+	}
+
+	double c11 = a00 * a22 - a02 * a02;
+	double c12 = a01 * a02 - a00 * a12;
+	double c22 = a00 * a11 - a01 * a01;
+	p = glm::dvec3(c00 * b0 + c01 * b1 + c02 * b2, c01 * b0 + c11 * b1 + c12 * b2, c02 * b0 + c12 * b1 + c22 * b2) / -determinant;
+	return true;
+}
+
+MeshDecimator::MeshDecimator(ThreadPool& pool)
+	: m_cancel(nullptr),
+	  m_pool(pool) { }
+
+bool MeshDecimator::buildChain(const IsoSurface& surface, float baseError, int numLevels, std::vector<IsoSurfaceLod>& levels)
+{
+	levels.clear();
+	this->load(surface);
+
+	float error = baseError;
+	for (int level = 0; level < numLevels; level++)
+	{
+		for (int pass = 0; pass < DECIMATION_PASSES; pass++)
+		{
+			if (this->cancelled())
+			{
+				return false;
+			}
+
+			this->decimatePass(error, pass);
+		}
+
+		levels.push_back(IsoSurfaceLod());
+		levels.back().error = error;
+		this->compact(levels.back().surface);
+		error *= 2.0f;
+	}
+
+	return !this->cancelled();
+}
+
+// Takes the welded vertices and triangles of the surface, a soup is welded on identical positions as every
+// edge crossing is interpolated the same way by all the cells sharing it
+void MeshDecimator::load(const IsoSurface& surface)
+{
+	m_vertices.clear();
+	m_indices.clear();
+	if (surface.indexed())
+	{
+		m_vertices = surface.vertices;
+		m_indices = surface.indices;
+	}
+	else
+	{
+		struct PositionHash
+		{
+			size_t operator()(const glm::vec3& p) const
+			{
+				uint32_t bits[3];
+				memcpy(bits, &p, sizeof(bits));
+				return (size_t)bits[0] * 73856093u ^ (size_t)bits[1] * 19349663u ^ (size_t)bits[2] * 83492791u;
+			}
+		};
+
+		std::unordered_map<glm::vec3, uint32_t, PositionHash> welded;
+		welded.reserve(surface.vertices.size() / 4);
+		m_indices.reserve(surface.vertices.size());
+		for (const MeshVertexAttribute& vertex : surface.vertices)
+		{
+			auto inserted = welded.insert(std::make_pair(vertex.position, (uint32_t)m_vertices.size()));
+			if (inserted.second)
+			{
+				m_vertices.push_back(vertex);
+			}
+
+			m_indices.push_back(inserted.first->second);
+		}
+	}
+
+	// Triangles that lost an edge to welding are dropped straight away
+	size_t numTriangles = m_indices.size() / 3;
+	for (size_t t = 0; t < numTriangles; t++)
+	{
+		uint32_t* triangle = &m_indices[3 * t];
+		if (triangle[0] == triangle[1] || triangle[1] == triangle[2] || triangle[2] == triangle[0])
+		{
+			triangle[0] = REMOVED_TRIANGLE;
+		}
+	}
+
+	m_dead.assign(m_vertices.size(), 0);
+	m_quadrics.assign(m_vertices.size(), Quadric());
+	this->buildAdjacency();
+
+	// Every vertex starts with the planes of the triangles around it, unweighted so the error stays a distance
+	int numThreads = m_pool.numThreads();
+	int numChunks = DECIMATION_BLOCKS_PER_THREAD * numThreads;
+	size_t chunkSize = (m_vertices.size() + numChunks - 1) / numChunks;
+	m_pool.parallelFor(numChunks, [&](int chunk)
+	{
+		size_t end = std::min(m_vertices.size(), (chunk + 1) * chunkSize);
+		for (size_t v = chunk * chunkSize; v < end; v++)
+		{
+			Quadric quadric = Quadric();
+			for (uint32_t i = m_adjacencyOffsets[v]; i < m_adjacencyOffsets[v + 1]; i++)
+			{
+				const uint32_t* triangle = &m_indices[3 * m_adjacency[i]];
+				glm::dvec3 p0(m_vertices[triangle[0]].position);
+				glm::dvec3 p1(m_vertices[triangle[1]].position);
+				glm::dvec3 p2(m_vertices[triangle[2]].position);
+				glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+				double length = glm::length(normal);
+				if (length > 0.0)
+				{
+					normal /= length;
+					quadric.addPlane(normal, -glm::dot(normal, p0));
+				}
+			}
+
+			m_quadrics[v] = quadric;
+		}
+	});
+}
+
+// Triangles around every vertex, counted and then filled in the order of the triangles
+void MeshDecimator::buildAdjacency()
+{
+	m_adjacencyOffsets.assign(m_vertices.size() + 1, 0);
+	size_t numTriangles = m_indices.size() / 3;
+	for (size_t t = 0; t < numTriangles; t++)
+	{
+		if (m_indices[3 * t] != REMOVED_TRIANGLE)
+		{
+			for (int i = 0; i < 3; i++)
+			{
+				m_adjacencyOffsets[m_indices[3 * t + i] + 1]++;
+			}
+		}
+	}
+
+	for (size_t v = 0; v < m_vertices.size(); v++)
+	{
+		m_adjacencyOffsets[v + 1] += m_adjacencyOffsets[v];
+	}
+
+	m_adjacency.resize(m_adjacencyOffsets.back());
+	std::vector<uint32_t> next(m_adjacencyOffsets.begin(), m_adjacencyOffsets.end() - 1);
+	for (size_t t = 0; t < numTriangles; t++)
+	{
+		if (m_indices[3 * t] != REMOVED_TRIANGLE)
+		{
+			for (int i = 0; i < 3; i++)
+			{
+				m_adjacency[next[m_indices[3 * t + i]]++] = (uint32_t)t;
+			}
+		}
+	}
+}
+
+void MeshDecimator::decimatePass(float maxError, int pass)
+{
+	if (pass > 0)
+	{
+		this->buildAdjacency();
+	}
+
+	glm::vec3 min(INFINITY);
+	glm::vec3 max(-INFINITY);
+	for (size_t v = 0; v < m_vertices.size(); v++)
+	{
+		if (!m_dead[v])
+		{
+			min = glm::min(min, m_vertices[v].position);
+			max = glm::max(max, m_vertices[v].position);
+		}
+	}
+
+	if (min.x > max.x)
+	{
+		return;
+	}
+
+	// A single block has no borders to catch up on. Shifted passes start half a block early and need
+	// one more block along each axis.
+	int numThreads = m_pool.numThreads();
+	int maxBlocksPerAxis = (numThreads > 1) ? (int)round(cbrt((double)DECIMATION_BLOCKS_PER_THREAD * numThreads)) : 1;
+	int blocksPerAxis = std::min(maxBlocksPerAxis, std::max(1, (int)cbrt((double)m_vertices.size() / DECIMATION_MIN_BLOCK_VERTICES)));
+	if (blocksPerAxis == 1 && (pass & 1))
+	{
+		return;
+	}
+
+	glm::vec3 blockSize = glm::max((max - min) / (float)blocksPerAxis, glm::vec3(1.0e-6f)) * 1.0001f;
+	glm::vec3 origin = min - ((pass & 1) ? 0.5f * blockSize : glm::vec3(0.0f));
+	int numBlocksAxis = blocksPerAxis + 1;
+	int numBlocks = numBlocksAxis * numBlocksAxis * numBlocksAxis;
+
+	size_t numVertices = m_vertices.size();
+	int numChunks = DECIMATION_BLOCKS_PER_THREAD * numThreads;
+	size_t chunkSize = (numVertices + numChunks - 1) / numChunks;
+	m_blocks.resize(numVertices);
+	m_collapsible.resize(numVertices);
+	m_localIndex.resize(numVertices);
+
+	m_pool.parallelFor(numChunks, [&](int chunk)
+	{
+		size_t end = std::min(numVertices, (chunk + 1) * chunkSize);
+		for (size_t v = chunk * chunkSize; v < end; v++)
+		{
+			glm::ivec3 block = glm::clamp(glm::ivec3((m_vertices[v].position - origin) / blockSize), glm::ivec3(0), glm::ivec3(numBlocksAxis - 1));
+			m_blocks[v] = block.x + numBlocksAxis * (block.y + numBlocksAxis * block.z);
+		}
+	});
+
+	// Every edge around a collapsible vertex is shared by exactly two triangles and leads to the same block
+	m_pool.parallelFor(numChunks, [&](int chunk)
+	{
+		std::vector<uint32_t> neighbours;
+		size_t end = std::min(numVertices, (chunk + 1) * chunkSize);
+		for (size_t v = chunk * chunkSize; v < end; v++)
+		{
+			neighbours.clear();
+			for (uint32_t i = m_adjacencyOffsets[v]; i < m_adjacencyOffsets[v + 1]; i++)
+			{
+				const uint32_t* triangle = &m_indices[3 * m_adjacency[i]];
+				for (int j = 0; j < 3; j++)
+				{
+					if (triangle[j] != v)
+					{
+						neighbours.push_back(triangle[j]);
+					}
+				}
+			}
+
+			std::sort(neighbours.begin(), neighbours.end());
+			bool collapsible = !m_dead[v] && !neighbours.empty();
+			for (size_t i = 0; i < neighbours.size() && collapsible; i += 2)
+			{
+				collapsible = i + 1 < neighbours.size() && neighbours[i] == neighbours[i + 1]
+					&& (i + 2 == neighbours.size() || neighbours[i + 2] != neighbours[i])
+					&& m_blocks[neighbours[i]] == m_blocks[v];
+			}
+
+			m_collapsible[v] = collapsible;
+		}
+	});
+
+	// Vertices sorted by block with a counting sort
+	std::vector<uint32_t> blockOffsets(numBlocks + 1, 0);
+	for (size_t v = 0; v < numVertices; v++)
+	{
+		blockOffsets[m_blocks[v] + 1]++;
+	}
+
+	for (int block = 0; block < numBlocks; block++)
+	{
+		blockOffsets[block + 1] += blockOffsets[block];
+	}
+
+	std::vector<uint32_t> blockVertices(numVertices);
+	std::vector<uint32_t> next(blockOffsets.begin(), blockOffsets.end() - 1);
+	for (size_t v = 0; v < numVertices; v++)
+	{
+		blockVertices[next[m_blocks[v]]++] = (uint32_t)v;
+	}
+
+	double maxCost = (double)maxError * maxError;
+	m_pool.parallelFor(numBlocks, [&](int block)
+	{
+		if (!this->cancelled() && blockOffsets[block + 1] > blockOffsets[block])
+		{
+			this->decimateBlock(blockVertices.data() + blockOffsets[block], blockOffsets[block + 1] - blockOffsets[block], maxCost);
+		}
+	});
+}
+
+// Error of merging w into v and the position it is least at, the minimum of the summed quadric when it is
+// well defined and near the edge, otherwise the best of the end points and the middle of the edge
+double MeshDecimator::collapseCost(uint32_t v, uint32_t w, glm::vec3& target) const
+{
+	Quadric quadric = m_quadrics[v];
+	quadric.add(m_quadrics[w]);
+
+	glm::dvec3 p0(m_vertices[v].position);
+	glm::dvec3 p1(m_vertices[w].position);
+	glm::dvec3 middle = 0.5 * (p0 + p1);
+	glm::dvec3 minimum;
+	if (quadric.minimum(minimum) && glm::length(minimum - middle) <= glm::length(p1 - p0))
+	{
+		target = glm::vec3(minimum);
+		return quadric.error(minimum);
+	}
+
+	double cost = quadric.error(p0);
+	target = glm::vec3(p0);
+	const glm::dvec3 candidates[] = { p1, middle };
+	for (const glm::dvec3& candidate : candidates)
+	{
+		double candidateCost = quadric.error(candidate);
+		if (candidateCost < cost)
+		{
+			cost = candidateCost;
+			target = glm::vec3(candidate);
+		}
+	}
+
+	return cost;
+}
+
+void MeshDecimator::decimateBlock(const uint32_t* blockVertices, int numBlockVertices, double maxCost)
+{
+	// The triangles around the vertices of the block change as edges collapse, so the block keeps its own lists
+	std::vector<std::vector<uint32_t>> triangles(numBlockVertices);
+	std::vector<uint32_t> stamps(numBlockVertices, 0);
+	for (int i = 0; i < numBlockVertices; i++)
+	{
+		uint32_t v = blockVertices[i];
+		m_localIndex[v] = i;
+		triangles[i].assign(m_adjacency.begin() + m_adjacencyOffsets[v], m_adjacency.begin() + m_adjacencyOffsets[v + 1]);
+	}
+
+	struct Collapse
+	{
+		double cost;
+		uint32_t v;
+		uint32_t w;
+		uint32_t stampV;
+		uint32_t stampW;
+		glm::vec3 target;
+
+		bool operator>(const Collapse& other) const { return cost > other.cost; }
+	};
+
+	std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> queue;
+	auto addEdges = [&](uint32_t v, bool lowerOnly)
+	{
+		for (uint32_t t : triangles[m_localIndex[v]])
+		{
+			for (int j = 0; j < 3; j++)
+			{
+				uint32_t w = m_indices[3 * t + j];
+				if (w != v && (!lowerOnly || v < w) && m_collapsible[w])
+				{
+					Collapse collapse;
+					collapse.cost = this->collapseCost(v, w, collapse.target);
+					if (collapse.cost <= maxCost)
+					{
+						collapse.v = v;
+						collapse.w = w;
+						collapse.stampV = stamps[m_localIndex[v]];
+						collapse.stampW = stamps[m_localIndex[w]];
+						queue.push(collapse);
+					}
+				}
+			}
+		}
+	};
+
+	for (int i = 0; i < numBlockVertices; i++)
+	{
+		if (m_collapsible[blockVertices[i]])
+		{
+			addEdges(blockVertices[i], true);
+		}
+	}
+
+	std::vector<uint32_t> neighboursV;
+	std::vector<uint32_t> neighboursW;
+	std::vector<uint32_t> shared;
+	auto neighbours = [&](uint32_t v, std::vector<uint32_t>& result)
+	{
+		result.clear();
+		for (uint32_t t : triangles[m_localIndex[v]])
+		{
+			for (int j = 0; j < 3; j++)
+			{
+				if (m_indices[3 * t + j] != v)
+				{
+					result.push_back(m_indices[3 * t + j]);
+				}
+			}
+		}
+
+		std::sort(result.begin(), result.end());
+		result.erase(std::unique(result.begin(), result.end()), result.end());
+	};
+
+	// A moved end point must not fold any remaining triangle over, nor squash it to nothing
+	auto keepsOrientation = [&](uint32_t moved, uint32_t other, const glm::vec3& target)
+	{
+		for (uint32_t t : triangles[m_localIndex[moved]])
+		{
+			const uint32_t* triangle = &m_indices[3 * t];
+			if (triangle[0] == other || triangle[1] == other || triangle[2] == other)
+			{
+				continue;
+			}
+
+			glm::vec3 before[3];
+			glm::vec3 after[3];
+			for (int j = 0; j < 3; j++)
+			{
+				before[j] = m_vertices[triangle[j]].position;
+				after[j] = (triangle[j] == moved) ? target : before[j];
+			}
+
+			// Slivers the extraction left with no area have no orientation to keep
+			glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+			glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+			double lengthBefore = glm::length(normalBefore);
+			double lengthAfter = glm::length(normalAfter);
+			if (lengthBefore > 0.0 && (lengthAfter <= 0.0 || glm::dot(normalBefore, normalAfter) < DECIMATION_MIN_NORMAL_COS * lengthBefore * lengthAfter))
+			{
+				return false;
+			}
+		}
+
+		return true;
+	};
+
+	while (!queue.empty())
+	{
+		Collapse collapse = queue.top();
+		queue.pop();
+
+		uint32_t v = collapse.v;
+		uint32_t w = collapse.w;
+		uint32_t localV = m_localIndex[v];
+		uint32_t localW = m_localIndex[w];
+		if (m_dead[v] || m_dead[w] || stamps[localV] != collapse.stampV || stamps[localW] != collapse.stampW)
+		{
+			continue;
+		}
+
+		// The neighbours both ends share have to be exactly the far corners of the two triangles on the edge,
+		// anything else pinches the surface
+		neighbours(v, neighboursV);
+		neighbours(w, neighboursW);
+		shared.clear();
+		std::set_intersection(neighboursV.begin(), neighboursV.end(), neighboursW.begin(), neighboursW.end(), std::back_inserter(shared));
+		if (shared.size() != 2 || !keepsOrientation(v, w, collapse.target) || !keepsOrientation(w, v, collapse.target))
+		{
+			continue;
+		}
+
+		// The triangles on the edge go away, the others around w move over to v
+		for (uint32_t t : triangles[localW])
+		{
+			uint32_t* triangle = &m_indices[3 * t];
+			if (triangle[0] == v || triangle[1] == v || triangle[2] == v)
+			{
+				for (int j = 0; j < 3; j++)
+				{
+					if (triangle[j] != v && triangle[j] != w)
+					{
+						std::vector<uint32_t>& far = triangles[m_localIndex[triangle[j]]];
+						far.erase(std::find(far.begin(), far.end(), t));
+					}
+				}
+
+				triangle[0] = REMOVED_TRIANGLE;
+			}
+			else
+			{
+				*std::find(triangle, triangle + 3, w) = v;
+				triangles[localV].push_back(t);
+			}
+		}
+
+		std::vector<uint32_t>& trianglesV = triangles[localV];
+		trianglesV.erase(std::remove_if(trianglesV.begin(), trianglesV.end(), [&](uint32_t t) { return m_indices[3 * t] == REMOVED_TRIANGLE; }), trianglesV.end());
+		triangles[localW].clear();
+
+		MeshVertexAttribute& vertex = m_vertices[v];
+		glm::vec3 normal = vertex.normal + m_vertices[w].normal;
+		float length = glm::length(normal);
+		vertex.position = collapse.target;
+		vertex.normal = (length > 0.0f) ? normal / length : vertex.normal;
+		m_quadrics[v].add(m_quadrics[w]);
+		m_dead[w] = 1;
+		stamps[localV]++;
+		stamps[localW]++;
+
+		addEdges(v, false);
+	}
+}
+
+// Writes out the remaining triangles and their vertices and renumbers the decimator's own arrays the same way
+void MeshDecimator::compact(IsoSurface& surface)
+{
+	std::vector<uint32_t> remap(m_vertices.size(), REMOVED_TRIANGLE);
+	surface.vertices.clear();
+	surface.indices.clear();
+
+	std::vector<Quadric> quadrics;
+	size_t numTriangles = m_indices.size() / 3;
+	for (size_t t = 0; t < numTriangles; t++)
+	{
+		if (m_indices[3 * t] == REMOVED_TRIANGLE)
+		{
+			continue;
+		}
+
+		for (int j = 0; j < 3; j++)
+		{
+			uint32_t v = m_indices[3 * t + j];
+			if (remap[v] == REMOVED_TRIANGLE)
+			{
+				remap[v] = (uint32_t)surface.vertices.size();
+				surface.vertices.push_back(m_vertices[v]);
+				quadrics.push_back(m_quadrics[v]);
+			}
+
+			surface.indices.push_back(remap[v]);
+		}
+	}
+
+	m_vertices = surface.vertices;
+	m_indices = surface.indices;
+	m_quadrics.swap(quadrics);
+	m_dead.assign(m_vertices.size(), 0);
+	this->buildAdjacency();
+}
@@ -0,0 +1,404 @@
+#pragma once
+#include <mesh_writer.h>
+#include <algorithm>
+#include <cstring>
+
+static int seekStream(FILE* file, uint64_t offset)
+{
+#ifdef _WIN32
+	return _fseeki64(file, (long long)offset, SEEK_SET);
+#else
+	return fseeko(file, (off_t)offset, SEEK_SET);
+#endif
+}
+
+MeshFileStream::MeshFileStream()
+	: m_file(nullptr),
+	  m_size(0) { }
+
+MeshFileStream::~MeshFileStream()
+{
+	this->close();
+}
+
+bool MeshFileStream::open(const std::string& path, const char* mode)
+{
+	this->close();
+	m_file = fopen(path.c_str(), mode);
+	if (m_file == nullptr)
+	{
+		return false;
+	}
+
+	setvbuf(m_file, nullptr, _IONBF, 0);
+	m_buffer.resize(MESH_WRITER_BUFFER_SIZE);
+	m_size = 0;
+
+	return true;
+}
+
+bool MeshFileStream::put(const void* data, size_t bytes)
+{
+	const char* source = (const char*)data;
+	while (bytes > 0)
+	{
+		if (m_size == m_buffer.size() && !this->flush())
+		{
+			return false;
+		}
+
+		size_t count = std::min(bytes, m_buffer.size() - m_size);
+		memcpy(m_buffer.data() + m_size, source, count);
+		m_size += count;
+		source += count;
+		bytes -= count;
+	}
+
+	return true;
+}
+
+bool MeshFileStream::flush()
+{
+	bool written = fwrite(m_buffer.data(), 1, m_size, m_file) == m_size;
+	m_size = 0;
+
+	return written;
+}
+
+bool MeshFileStream::seek(uint64_t offset)
+{
+	return this->flush() && seekStream(m_file, offset) == 0;
+}
+
+void MeshFileStream::close()
+{
+	if (m_file != nullptr)
+	{
+		fclose(m_file);
+		m_file = nullptr;
+	}
+
+	m_buffer.clear();
+	m_buffer.shrink_to_fit();
+	m_size = 0;
+}
+
+MeshWriter* MeshWriter::create(const std::string& path)
+{
+	std::string extension = path.substr(std::min(path.size(), path.rfind('.')));
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return (char)tolower(c); });
+
+	if (extension == ".ply")
+	{
+		return MeshWriter::create(path, MESH_FILE_PLY);
+	}
+	else if (extension == ".stl")
+	{
+		return MeshWriter::create(path, MESH_FILE_STL);
+	}
+	else if (extension == ".obj")
+	{
+		return MeshWriter::create(path, MESH_FILE_OBJ);
+	}
+
+	fprintf(stderr, "Unknown mesh file format %s\n", path.c_str());
+	return nullptr;
+}
+
+MeshWriter* MeshWriter::create(const std::string& path, MeshFileFormat format)
+{
+	MeshWriter* writer = nullptr;
+	switch (format)
+	{
+	case MESH_FILE_PLY:
+		writer = new PlyMeshWriter(path);
+		break;
+	case MESH_FILE_STL:
+		writer = new StlMeshWriter(path);
+		break;
+	case MESH_FILE_OBJ:
+		writer = new ObjMeshWriter(path);
+		break;
+	}
+
+	if (!writer->open())
+	{
+		delete writer;
+		return nullptr;
+	}
+
+	return writer;
+}
+
+MeshWriter::MeshWriter(const std::string& path)
+	: m_failed(false),
+	  m_numTriangles(0),
+	  m_numVertices(0),
+	  m_path(path),
+	  m_tempPath(path + ".tmp") { }
+
+MeshWriter::~MeshWriter()
+{
+	// Left unclosed, the partial file is dropped
+	if (m_stream.file() != nullptr)
+	{
+		m_stream.close();
+		remove(m_tempPath.c_str());
+	}
+}
+
+bool MeshWriter::open()
+{
+	if (!m_stream.open(m_tempPath, "wb") || !this->begin())
+	{
+		fprintf(stderr, "Failed to write mesh file %s\n", m_tempPath.c_str());
+		m_stream.close();
+		remove(m_tempPath.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+bool MeshWriter::write(const IsoSurface& chunk)
+{
+	if (m_failed || m_stream.file() == nullptr)
+	{
+		return false;
+	}
+
+	m_failed = !this->writeChunk(chunk);
+	m_numVertices += chunk.vertices.size();
+	m_numTriangles += (chunk.indexed() ? chunk.indices.size() : chunk.vertices.size()) / 3;
+
+	return !m_failed;
+}
+
+bool MeshWriter::close()
+{
+	if (m_stream.file() == nullptr)
+	{
+		return false;
+	}
+
+	bool written = !m_failed && this->end() && m_stream.flush();
+	m_stream.close();
+
+	remove(m_path.c_str());
+	if (!written || rename(m_tempPath.c_str(), m_path.c_str()) != 0)
+	{
+		fprintf(stderr, "Failed to write mesh file %s\n", m_path.c_str());
+		remove(m_tempPath.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+PlyMeshWriter::PlyMeshWriter(const std::string& path)
+	: MeshWriter(path),
+	  m_facesPath(path + ".faces.tmp") { }
+
+PlyMeshWriter::~PlyMeshWriter()
+{
+	if (m_faces.file() != nullptr)
+	{
+		m_faces.close();
+		remove(m_facesPath.c_str());
+	}
+}
+
+bool PlyMeshWriter::begin()
+{
+	return m_faces.open(m_facesPath, "w+b") && this->writeHeader();
+}
+
+bool PlyMeshWriter::writeHeader()
+{
+	char header[PLY_HEADER_SIZE];
+	int length = snprintf(header, sizeof(header),
+		"ply\n"
+		"format binary_little_endian 1.0\n"
+		"element vertex %llu\n"
+		"property float x\n"
+		"property float y\n"
+		"property float z\n"
+		"property float nx\n"
+		"property float ny\n"
+		"property float nz\n"
+		"property float quality\n"
+		"element face %llu\n"
+		"property list uchar int vertex_indices\n",
+		(unsigned long long)m_numVertices,
+		(unsigned long long)m_numTriangles);
+
+	// The comment takes up the rest of the space so the header always has the same size
+	const char* end = "end_header\n";
+	int padding = PLY_HEADER_SIZE - length - (int)strlen("comment \n") - (int)strlen(end);
+	memcpy(header + length, "comment ", 8);
+	memset(header + length + 8, '-', padding);
+	header[length + 8 + padding] = '\n';
+	memcpy(header + length + 9 + padding, end, strlen(end));
+
+	return m_stream.put(header, PLY_HEADER_SIZE);
+}
+
+bool PlyMeshWriter::writeChunk(const IsoSurface& chunk)
+{
+	static_assert(sizeof(MeshVertexAttribute) == 7 * sizeof(float), "PLY vertices are written as they are held");
+
+	if (!m_stream.put(chunk.vertices.data(), chunk.vertices.size() * sizeof(MeshVertexAttribute)))
+	{
+		return false;
+	}
+
+	// Faces of a soup reference its vertices in order
+	size_t numTriangles = (chunk.indexed() ? chunk.indices.size() : chunk.vertices.size()) / 3;
+	char face[13];
+	face[0] = 3;
+	for (size_t t = 0; t < numTriangles; t++)
+	{
+		for (int corner = 0; corner < 3; corner++)
+		{
+			int32_t index = chunk.indexed() ? (int32_t)chunk.indices[3 * t + corner] : (int32_t)(m_numVertices + 3 * t + corner);
+			memcpy(face + 1 + corner * sizeof(int32_t), &index, sizeof(int32_t));
+		}
+
+		if (!m_faces.put(face, sizeof(face)))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool PlyMeshWriter::end()
+{
+	// Faces are copied over through the buffer of the mesh file
+	bool written = m_faces.seek(0);
+	std::vector<char> block(MESH_WRITER_BUFFER_SIZE);
+	size_t count = 0;
+	while (written && (count = fread(block.data(), 1, block.size(), m_faces.file())) > 0)
+	{
+		written = m_stream.put(block.data(), count);
+	}
+
+	m_faces.close();
+	remove(m_facesPath.c_str());
+
+	return written && m_stream.seek(0) && this->writeHeader();
+}
+
+StlMeshWriter::StlMeshWriter(const std::string& path)
+	: MeshWriter(path) { }
+
+bool StlMeshWriter::begin()
+{
+	// The triangle count after the header is filled in once the mesh is done
+	char header[84];
+	memset(header, 0, sizeof(header));
+	snprintf(header, 80, "isosurface");
+
+	return m_stream.put(header, sizeof(header));
+}
+
+bool StlMeshWriter::writeChunk(const IsoSurface& chunk)
+{
+	size_t numTriangles = (chunk.indexed() ? chunk.indices.size() : chunk.vertices.size()) / 3;
+	char facet[50];
+	memset(facet, 0, sizeof(facet));
+	for (size_t t = 0; t < numTriangles; t++)
+	{
+		glm::vec3 corners[3];
+		for (int corner = 0; corner < 3; corner++)
+		{
+			size_t index = chunk.indexed() ? (size_t)chunk.indices[3 * t + corner] - m_numVertices : 3 * t + corner;
+			if (index >= chunk.vertices.size())
+			{
+				fprintf(stderr, "STL chunks can only reference their own vertices\n");
+				return false;
+			}
+
+			corners[corner] = chunk.vertices[index].position;
+		}
+
+		glm::vec3 normal = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+		float length = glm::length(normal);
+		normal = (length > 0.0f) ? normal / length : glm::vec3(0.0f);
+		memcpy(facet, &normal, sizeof(glm::vec3));
+		memcpy(facet + 12, corners, sizeof(corners));
+
+		if (!m_stream.put(facet, sizeof(facet)))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool StlMeshWriter::end()
+{
+	uint32_t numTriangles = (uint32_t)m_numTriangles;
+
+	return m_stream.seek(80) && m_stream.put(&numTriangles, sizeof(uint32_t));
+}
+
+ObjMeshWriter::ObjMeshWriter(const std::string& path)
+	: MeshWriter(path) { }
+
+bool ObjMeshWriter::begin()
+{
+	const char* header = "# isosurface\n";
+
+	return m_stream.put(header, strlen(header));
+}
+
+bool ObjMeshWriter::writeChunk(const IsoSurface& chunk)
+{
+	// Lines are formatted into a small buffer and gathered by the stream
+	char line[128];
+	for (const MeshVertexAttribute& vertex : chunk.vertices)
+	{
+		int length = snprintf(line, sizeof(line), "v %.7g %.7g %.7g\nvn %.7g %.7g %.7g\n",
+			vertex.position.x, vertex.position.y, vertex.position.z,
+			vertex.normal.x, vertex.normal.y, vertex.normal.z);
+		if (!m_stream.put(line, length))
+		{
+			return false;
+		}
+	}
+
+	// Indices in OBJ count from one
+	size_t numTriangles = (chunk.indexed() ? chunk.indices.size() : chunk.vertices.size()) / 3;
+	for (size_t t = 0; t < numTriangles; t++)
+	{
+		unsigned long long a, b, c;
+		if (chunk.indexed())
+		{
+			a = chunk.indices[3 * t] + 1ull;
+			b = chunk.indices[3 * t + 1] + 1ull;
+			c = chunk.indices[3 * t + 2] + 1ull;
+		}
+		else
+		{
+			a = m_numVertices + 3 * t + 1;
+			b = a + 1;
+			c = a + 2;
+		}
+
+		int length = snprintf(line, sizeof(line), "f %llu//%llu %llu//%llu %llu//%llu\n", a, a, b, b, c, c);
+		if (!m_stream.put(line, length))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool ObjMeshWriter::end()
+{
+	return true;
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include <minmax_octree.h>
+#include <algorithm>
+
+MinMaxOctree::MinMaxOctree(const Volume& volume, ThreadPool& pool)
+	: m_numCells(volume.numCellsX(), volume.numCellsY(), volume.numCellsZ())
+{
+	glm::ivec3 numBlocks = (m_numCells + glm::ivec3(MINMAX_BLOCK_SIZE - 1)) / MINMAX_BLOCK_SIZE;
+	m_numNodes.push_back(numBlocks);
+	m_levels.push_back(std::vector<ValueRange>(numBlocks.x * numBlocks.y * numBlocks.z));
+
+	// Leaves take the range of every point of their cells, the points on the far faces are shared with the next block
+	pool.parallelFor(numBlocks.z, [&](int blockZ)
+	{
+		int endZ = std::min((blockZ + 1) * MINMAX_BLOCK_SIZE, m_numCells.z);
+		for (int blockY = 0; blockY < numBlocks.y; blockY++)
+		{
+			int endY = std::min((blockY + 1) * MINMAX_BLOCK_SIZE, m_numCells.y);
+			for (int blockX = 0; blockX < numBlocks.x; blockX++)
+			{
+				int endX = std::min((blockX + 1) * MINMAX_BLOCK_SIZE, m_numCells.x);
+
+				ValueRange range = { INFINITY, -INFINITY };
+				for (int z = blockZ * MINMAX_BLOCK_SIZE; z <= endZ; z++)
+				{
+					for (int y = blockY * MINMAX_BLOCK_SIZE; y <= endY; y++)
+					{
+						const float* row = volume.values + volume.index(0, y, z);
+						for (int x = blockX * MINMAX_BLOCK_SIZE; x <= endX; x++)
+						{
+							range.min = std::min(range.min, row[x]);
+							range.max = std::max(range.max, row[x]);
+						}
+					}
+				}
+
+				m_levels[0][blockX + numBlocks.x * (blockY + numBlocks.y * blockZ)] = range;
+			}
+		}
+	});
+
+	// Merge 2x2x2 children until a single node is left
+	while (m_numNodes.back().x > 1 || m_numNodes.back().y > 1 || m_numNodes.back().z > 1)
+	{
+		const glm::ivec3 numChildren = m_numNodes.back();
+		const glm::ivec3 numParents = (numChildren + glm::ivec3(1)) / 2;
+		std::vector<ValueRange> parents(numParents.x * numParents.y * numParents.z, { INFINITY, -INFINITY });
+		const std::vector<ValueRange>& children = m_levels.back();
+
+		for (int z = 0; z < numChildren.z; z++)
+		{
+			for (int y = 0; y < numChildren.y; y++)
+			{
+				for (int x = 0; x < numChildren.x; x++)
+				{
+					const ValueRange& child = children[x + numChildren.x * (y + numChildren.y * z)];
+					ValueRange& parent = parents[x / 2 + numParents.x * (y / 2 + numParents.y * (z / 2))];
+					parent.min = std::min(parent.min, child.min);
+					parent.max = std::max(parent.max, child.max);
+				}
+			}
+		}
+
+		m_numNodes.push_back(numParents);
+		m_levels.push_back(std::move(parents));
+	}
+}
+
+const ValueRange& MinMaxOctree::node(int level, int x, int y, int z) const
+{
+	const glm::ivec3& numNodes = m_numNodes[level];
+	return m_levels[level][x + numNodes.x * (y + numNodes.y * z)];
+}
+
+void MinMaxOctree::cellBounds(int level, int x, int y, int z, glm::ivec3& begin, glm::ivec3& end) const
+{
+	int size = MINMAX_BLOCK_SIZE << level;
+	begin = glm::ivec3(x * size, y * size, z * size);
+	end = glm::min(begin + glm::ivec3(size), m_numCells);
+}
+
+void MinMaxOctree::activeBlocks(float isoValue, std::vector<glm::ivec3>& blocks) const
+{
+	size_t first = blocks.size();
+	this->traverse(
+		[isoValue](const ValueRange& range, const glm::ivec3&, const glm::ivec3&) { return range.contains(isoValue); },
+		[&blocks](const glm::ivec3& block, const glm::ivec3&, const glm::ivec3&) { blocks.push_back(block); });
+
+	// The depth first walk groups blocks by subtree, extraction wants them layer by layer
+	std::sort(blocks.begin() + first, blocks.end(), [](const glm::ivec3& a, const glm::ivec3& b)
+	{
+		return (a.z != b.z) ? a.z < b.z : (a.y != b.y) ? a.y < b.y : a.x < b.x;
+	});
+}
+
+size_t MinMaxOctree::memory() const
+{
+	size_t bytes = 0;
+	for (const std::vector<ValueRange>& level : m_levels)
+	{
+		bytes += level.size() * sizeof(ValueRange);
+	}
+
+	return bytes;
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include <range_allocator.h>
+#include <iterator>
+
+RangeAllocator::RangeAllocator(size_t capacity)
+	: m_capacity(0),
+	  m_used(0)
+{
+	this->grow(capacity);
+}
+
+bool RangeAllocator::allocate(size_t size, size_t& offset)
+{
+	if (size == 0)
+	{
+		offset = 0;
+		return true;
+	}
+
+	for (auto range = m_free.begin(); range != m_free.end(); ++range)
+	{
+		if (range->second >= size)
+		{
+			offset = range->first;
+			if (range->second > size)
+			{
+				m_free[offset + size] = range->second - size;
+			}
+
+			m_free.erase(range);
+			m_used += size;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void RangeAllocator::free(size_t offset, size_t size)
+{
+	if (size == 0)
+	{
+		return;
+	}
+
+	m_used -= size;
+	auto next = m_free.lower_bound(offset);
+	if (next != m_free.end() && offset + size == next->first)
+	{
+		size += next->second;
+		next = m_free.erase(next);
+	}
+
+	if (next != m_free.begin())
+	{
+		auto previous = std::prev(next);
+		if (previous->first + previous->second == offset)
+		{
+			previous->second += size;
+			return;
+		}
+	}
+
+	m_free[offset] = size;
+}
+
+void RangeAllocator::grow(size_t capacity)
+{
+	if (capacity > m_capacity)
+	{
+		size_t offset = m_capacity;
+		size_t size = capacity - m_capacity;
+		m_capacity = capacity;
+		m_used += size;
+		this->free(offset, size);
+	}
+}
+
+void RangeAllocator::clear()
+{
+	m_capacity = 0;
+	m_free.clear();
+	m_used = 0;
+}
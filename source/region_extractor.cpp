@@ -0,0 +1,614 @@
+#pragma once
+#include <region_extractor.h>
+#include <brick_welder.h>
+#include <algorithm>
+
+RegionExtractor::RegionExtractor(const Volume& volume, const MinMaxOctree* ranges, ThreadPool& pool)
+	: m_cancel(nullptr),
+	  m_indexed(false),
+	  m_method(ISOSURFACE_MARCHING_CUBES),
+	  m_nextKey(0),
+	  m_numBricksExtracted(0),
+	  m_numBricksTouched(0),
+	  m_numBricksVisible(0),
+	  m_pool(pool),
+	  m_ranges(ranges),
+	  m_segmented(false),
+	  m_viewed(false),
+	  m_volume(volume)
+{
+	m_numBricks = glm::ivec3(
+		(volume.numCellsX() + REGION_BRICK_CELLS - 1) / REGION_BRICK_CELLS,
+		(volume.numCellsY() + REGION_BRICK_CELLS - 1) / REGION_BRICK_CELLS,
+		(volume.numCellsZ() + REGION_BRICK_CELLS - 1) / REGION_BRICK_CELLS);
+}
+
+void RegionExtractor::setIndexed(bool enable)
+{
+	if (m_indexed != enable)
+	{
+		m_indexed = enable;
+		m_bricks.clear();
+	}
+}
+
+void RegionExtractor::setMethod(IsoSurfaceMethod method)
+{
+	if (method == ISOSURFACE_SURFACE_NETS || method == ISOSURFACE_ADAPTIVE)
+	{
+		method = ISOSURFACE_MARCHING_CUBES;
+	}
+
+	if (m_method != method)
+	{
+		m_method = method;
+		m_bricks.clear();
+	}
+}
+
+void RegionExtractor::setSegmented(bool enable)
+{
+	if (m_segmented != enable)
+	{
+		m_segmented = enable;
+		m_bricks.clear();
+	}
+}
+
+void RegionExtractor::setView(const glm::mat4& modelView, const glm::mat4& projection)
+{
+	m_viewProjection = projection * modelView;
+	m_eye = glm::vec3(glm::inverse(modelView) * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+	m_viewed = true;
+}
+
+glm::ivec3 RegionExtractor::brickCoordinates(int brick) const
+{
+	return glm::ivec3(brick % m_numBricks.x, (brick / m_numBricks.x) % m_numBricks.y, brick / (m_numBricks.x * m_numBricks.y));
+}
+
+// Corners of the points of a brick in the coordinates of the volume
+void RegionExtractor::brickBounds(int brick, glm::vec3& min, glm::vec3& max) const
+{
+	glm::ivec3 firstPoint = this->brickCoordinates(brick) * REGION_BRICK_CELLS;
+	glm::ivec3 lastPoint = glm::min(firstPoint + glm::ivec3(REGION_BRICK_CELLS), glm::ivec3(m_volume.numCellsX(), m_volume.numCellsY(), m_volume.numCellsZ()));
+	min = m_volume.point(firstPoint.x, firstPoint.y, firstPoint.z);
+	max = m_volume.point(lastPoint.x, lastPoint.y, lastPoint.z);
+}
+
+// A view of the points of a brick, the rest of the volume around it becoming its ghost points
+Volume RegionExtractor::brickVolume(int brick, glm::ivec3& firstPoint) const
+{
+	glm::ivec3 numPoints(m_volume.numPointsX, m_volume.numPointsY, m_volume.numPointsZ);
+	firstPoint = this->brickCoordinates(brick) * REGION_BRICK_CELLS;
+	glm::ivec3 lastPoint = glm::min(firstPoint + glm::ivec3(REGION_BRICK_CELLS), numPoints - 1);
+
+	Volume volume = m_volume;
+	volume.values = m_volume.values + m_volume.index(firstPoint.x, firstPoint.y, firstPoint.z);
+	volume.numPointsX = lastPoint.x - firstPoint.x + 1;
+	volume.numPointsY = lastPoint.y - firstPoint.y + 1;
+	volume.numPointsZ = lastPoint.z - firstPoint.z + 1;
+	volume.origin = m_volume.point(firstPoint.x, firstPoint.y, firstPoint.z);
+	volume.ghostLow = m_volume.ghostLow + firstPoint;
+	volume.ghostHigh = m_volume.ghostHigh + numPoints - 1 - lastPoint;
+
+	return volume;
+}
+
+// Conservative, a brick only touches the region when its bounds reach into the box and past every plane
+bool RegionExtractor::touches(int brick) const
+{
+	glm::vec3 min;
+	glm::vec3 max;
+	this->brickBounds(brick, min, max);
+	for (int axis = 0; axis < 3; axis++)
+	{
+		if (max[axis] < m_region.min[axis] || min[axis] > m_region.max[axis])
+		{
+			return false;
+		}
+	}
+
+	for (const Plane& plane : m_region.planes)
+	{
+		float x = (plane.a > 0.0f) ? max.x : min.x;
+		float y = (plane.b > 0.0f) ? max.y : min.y;
+		float z = (plane.c > 0.0f) ? max.z : min.z;
+		if (plane.a * x + plane.b * y + plane.c * z + plane.d < 0.0f)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// Whether the planes leave a brick whole, every corner of it on the kept side of all of them
+bool RegionExtractor::inside(int brick, const std::vector<Plane>& planes) const
+{
+	glm::vec3 min;
+	glm::vec3 max;
+	this->brickBounds(brick, min, max);
+	for (const Plane& plane : planes)
+	{
+		float x = (plane.a > 0.0f) ? min.x : max.x;
+		float y = (plane.b > 0.0f) ? min.y : max.y;
+		float z = (plane.c > 0.0f) ? min.z : max.z;
+		if (plane.a * x + plane.b * y + plane.c * z + plane.d < 0.0f)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// Conservative as well, a brick is in view unless all its corners lie outside one of the six frustum planes.
+// The planes are the sums and differences of the last row of the view projection with the other three.
+bool RegionExtractor::visible(int brick) const
+{
+	if (!m_viewed)
+	{
+		return true;
+	}
+
+	glm::vec3 min;
+	glm::vec3 max;
+	this->brickBounds(brick, min, max);
+	const glm::mat4& m = m_viewProjection;
+	for (int plane = 0; plane < 6; plane++)
+	{
+		int row = plane / 2;
+		float sign = (plane % 2 == 0) ? 1.0f : -1.0f;
+		glm::vec4 coefficients(
+			m[0][3] + sign * m[0][row],
+			m[1][3] + sign * m[1][row],
+			m[2][3] + sign * m[2][row],
+			m[3][3] + sign * m[3][row]);
+
+		float x = (coefficients.x > 0.0f) ? max.x : min.x;
+		float y = (coefficients.y > 0.0f) ? max.y : min.y;
+		float z = (coefficients.z > 0.0f) ? max.z : min.z;
+		if (coefficients.x * x + coefficients.y * y + coefficients.z * z + coefficients.w < 0.0f)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// Bricks are aligned to the nodes of the min max octree a level above its blocks, or lie in its root
+bool RegionExtractor::missesAll(int brick, const std::vector<float>& isoValues) const
+{
+	if (m_ranges == nullptr)
+	{
+		return false;
+	}
+
+	int level = 0;
+	while ((MINMAX_BLOCK_SIZE << level) < REGION_BRICK_CELLS)
+	{
+		level++;
+	}
+
+	glm::ivec3 node(0);
+	if (level < m_ranges->numLevels())
+	{
+		node = this->brickCoordinates(brick) * REGION_BRICK_CELLS / (MINMAX_BLOCK_SIZE << level);
+	}
+	else
+	{
+		level = m_ranges->numLevels() - 1;
+	}
+
+	const ValueRange& range = m_ranges->node(level, node.x, node.y, node.z);
+	for (float isoValue : isoValues)
+	{
+		if (range.contains(isoValue))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// Faces of the box that cut the volume, followed by the planes of the region
+std::vector<Plane> RegionExtractor::clipPlanes() const
+{
+	glm::vec3 first = m_volume.point(0, 0, 0);
+	glm::vec3 last = m_volume.point(m_volume.numCellsX(), m_volume.numCellsY(), m_volume.numCellsZ());
+	std::vector<Plane> planes;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		if (m_region.min[axis] > first[axis])
+		{
+			Plane plane = { 0.0f, 0.0f, 0.0f, -m_region.min[axis] };
+			(&plane.a)[axis] = 1.0f;
+			planes.push_back(plane);
+		}
+
+		if (m_region.max[axis] < last[axis])
+		{
+			Plane plane = { 0.0f, 0.0f, 0.0f, m_region.max[axis] };
+			(&plane.a)[axis] = -1.0f;
+			planes.push_back(plane);
+		}
+	}
+
+	planes.insert(planes.end(), m_region.planes.begin(), m_region.planes.end());
+
+	return planes;
+}
+
+// Cuts the triangles of a surface by the half spaces of the planes. A vertex made on a cut edge is shared by
+// both triangles beside it, triangle soups are indexed for the cut and expanded again afterwards.
+static void clipSurface(IsoSurface& surface, const std::vector<Plane>& planes)
+{
+	bool indexed = surface.indexed();
+	if (!indexed)
+	{
+		surface.indices.resize(surface.vertices.size());
+		for (size_t i = 0; i < surface.indices.size(); i++)
+		{
+			surface.indices[i] = (uint32_t)i;
+		}
+	}
+
+	std::vector<float> distances;
+	std::vector<uint32_t> indices;
+	std::unordered_map<uint64_t, uint32_t> cuts;
+	bool cut = false;
+	for (const Plane& plane : planes)
+	{
+		distances.resize(surface.vertices.size());
+		for (size_t v = 0; v < surface.vertices.size(); v++)
+		{
+			const glm::vec3& p = surface.vertices[v].position;
+			distances[v] = plane.a * p.x + plane.b * p.y + plane.c * p.z + plane.d;
+		}
+
+		bool outside = false;
+		for (uint32_t index : surface.indices)
+		{
+			outside = outside || distances[index] < 0.0f;
+		}
+
+		if (!outside)
+		{
+			continue;
+		}
+
+		// Interpolated from the lower vertex index up, so both triangles on an edge make the same vertex
+		auto edgeVertex = [&](uint32_t i0, uint32_t i1)
+		{
+			if (i0 > i1)
+			{
+				std::swap(i0, i1);
+			}
+
+			auto inserted = cuts.insert(std::make_pair(((uint64_t)i0 << 32) | i1, (uint32_t)surface.vertices.size()));
+			if (inserted.second)
+			{
+				MeshVertexAttribute v0 = surface.vertices[i0];
+				MeshVertexAttribute v1 = surface.vertices[i1];
+				float t = distances[i0] / (distances[i0] - distances[i1]);
+
+				MeshVertexAttribute vertex;
+				vertex.position = v0.position + t * (v1.position - v0.position);
+				vertex.normal = glm::normalize(v0.normal + t * (v1.normal - v0.normal));
+				vertex.colorNorm = v0.colorNorm + t * (v1.colorNorm - v0.colorNorm);
+				surface.vertices.push_back(vertex);
+			}
+
+			return inserted.first->second;
+		};
+
+		// A triangle cut by a plane leaves a polygon of at most four corners, fanned out again
+		indices.clear();
+		cuts.clear();
+		for (size_t i = 0; i < surface.indices.size(); i += 3)
+		{
+			uint32_t polygon[4];
+			int numCorners = 0;
+			for (int corner = 0; corner < 3; corner++)
+			{
+				uint32_t i0 = surface.indices[i + corner];
+				uint32_t i1 = surface.indices[i + (corner + 1) % 3];
+				float d0 = distances[i0];
+				float d1 = distances[i1];
+				if (d0 >= 0.0f)
+				{
+					polygon[numCorners++] = i0;
+				}
+
+				if ((d0 > 0.0f && d1 < 0.0f) || (d0 < 0.0f && d1 > 0.0f))
+				{
+					polygon[numCorners++] = edgeVertex(i0, i1);
+				}
+			}
+
+			for (int corner = 2; corner < numCorners; corner++)
+			{
+				indices.push_back(polygon[0]);
+				indices.push_back(polygon[corner - 1]);
+				indices.push_back(polygon[corner]);
+			}
+		}
+
+		surface.indices.swap(indices);
+		cut = true;
+	}
+
+	if (!indexed)
+	{
+		std::vector<MeshVertexAttribute> vertices(surface.indices.size());
+		for (size_t i = 0; i < surface.indices.size(); i++)
+		{
+			vertices[i] = surface.vertices[surface.indices[i]];
+		}
+
+		surface.vertices.swap(vertices);
+		surface.indices.clear();
+		return;
+	}
+
+	// Drops the vertices of the triangles cut away, the others keep their order
+	if (cut)
+	{
+		std::vector<uint32_t> remap(surface.vertices.size(), 0);
+		for (uint32_t index : surface.indices)
+		{
+			remap[index] = 1;
+		}
+
+		size_t numVertices = 0;
+		for (size_t v = 0; v < surface.vertices.size(); v++)
+		{
+			if (remap[v] != 0)
+			{
+				remap[v] = (uint32_t)numVertices;
+				surface.vertices[numVertices++] = surface.vertices[v];
+			}
+		}
+
+		surface.vertices.resize(numVertices);
+		for (uint32_t& index : surface.indices)
+		{
+			index = remap[index];
+		}
+	}
+}
+
+// Key of what the planes cutting a brick leave of one of its segments, hashed from the brick, the level, the key of
+// the whole segment and the planes, so it stays the same for as long as they do. The top bit keeps it apart from
+// the keys of whole segments, which count up from zero.
+static uint64_t cutSegmentKey(int brick, size_t level, uint64_t key, const std::vector<Plane>& planes)
+{
+	uint64_t hash = 0xcbf29ce484222325ull;
+	auto add = [&hash](const void* data, size_t size)
+	{
+		const uint8_t* bytes = (const uint8_t*)data;
+		for (size_t i = 0; i < size; i++)
+		{
+			hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+		}
+	};
+
+	uint64_t level64 = level;
+	add(&brick, sizeof(brick));
+	add(&level64, sizeof(level64));
+	add(&key, sizeof(key));
+	for (const Plane& plane : planes)
+	{
+		float coefficients[4] = { plane.a, plane.b, plane.c, plane.d };
+		add(coefficients, sizeof(coefficients));
+	}
+
+	return hash | (1ull << 63);
+}
+
+// Welds the kept surfaces of the bricks in their order and cuts them by the region, bricks not done yet are left out.
+// Segmented bricks are only appended, the ones the region cuts are cut by the planes that reach into them alone.
+void RegionExtractor::assemble(const std::vector<int>& bricks, std::vector<IsoSurface>& surfaces)
+{
+	std::vector<Plane> planes = this->clipPlanes();
+	glm::ivec3 numPoints(m_volume.numPointsX, m_volume.numPointsY, m_volume.numPointsZ);
+	surfaces.assign(m_isoValues.size(), IsoSurface());
+	IsoSurface chunk;
+	if (m_segmented)
+	{
+		for (int brick : bricks)
+		{
+			auto kept = m_bricks.find(brick);
+			if (kept == m_bricks.end())
+			{
+				continue;
+			}
+
+			std::vector<Plane> cutting;
+			for (const Plane& plane : planes)
+			{
+				if (!this->inside(brick, std::vector<Plane>(1, plane)))
+				{
+					cutting.push_back(plane);
+				}
+			}
+
+			for (size_t level = 0; level < m_isoValues.size(); level++)
+			{
+				const IsoSurface& brickSurface = kept->second[level];
+				if (cutting.empty() || brickSurface.vertices.empty())
+				{
+					surfaces[level].append(brickSurface);
+					continue;
+				}
+
+				chunk.vertices = brickSurface.vertices;
+				chunk.indices = brickSurface.indices;
+				chunk.segments.clear();
+				clipSurface(chunk, cutting);
+				if (!chunk.vertices.empty())
+				{
+					uint64_t key = cutSegmentKey(brick, level, brickSurface.segments[0].key, cutting);
+					chunk.segments.push_back({ key, 0, chunk.vertices.size(), 0, chunk.indices.size() });
+					surfaces[level].append(chunk);
+				}
+			}
+		}
+
+		return;
+	}
+
+	for (size_t level = 0; level < m_isoValues.size(); level++)
+	{
+		IsoSurface& surface = surfaces[level];
+		BrickWelder welder(numPoints);
+		for (int brick : bricks)
+		{
+			auto kept = m_bricks.find(brick);
+			if (kept == m_bricks.end())
+			{
+				continue;
+			}
+
+			const IsoSurface& brickSurface = kept->second[level];
+			if (!brickSurface.indexed())
+			{
+				surface.append(brickSurface);
+				continue;
+			}
+
+			glm::ivec3 firstPoint;
+			welder.weld(brickSurface, this->brickVolume(brick, firstPoint), firstPoint, chunk);
+			surface.vertices.insert(surface.vertices.end(), chunk.vertices.begin(), chunk.vertices.end());
+			surface.indices.insert(surface.indices.end(), chunk.indices.begin(), chunk.indices.end());
+		}
+
+		clipSurface(surface, planes);
+	}
+}
+
+bool RegionExtractor::extract(const std::vector<float>& isoValues, std::vector<IsoSurface>& surfaces, PartialFunction visible)
+{
+	if (isoValues != m_isoValues)
+	{
+		m_bricks.clear();
+		m_isoValues = isoValues;
+	}
+
+	// Only the bricks under the box are visited, in z, y and x order
+	glm::vec3 lastCell = glm::vec3(m_numBricks * REGION_BRICK_CELLS);
+	glm::vec3 min = glm::clamp((m_region.min - m_volume.origin) / m_volume.spacing, glm::vec3(0.0f), lastCell);
+	glm::vec3 max = glm::clamp((m_region.max - m_volume.origin) / m_volume.spacing, glm::vec3(0.0f), lastCell);
+	glm::ivec3 firstBrick = glm::ivec3(min) / REGION_BRICK_CELLS;
+	glm::ivec3 lastBrick = glm::min(glm::ivec3(max) / REGION_BRICK_CELLS, m_numBricks - 1);
+
+	std::vector<int> touched;
+	for (int z = firstBrick.z; z <= lastBrick.z; z++)
+	{
+		for (int y = firstBrick.y; y <= lastBrick.y; y++)
+		{
+			for (int x = firstBrick.x; x <= lastBrick.x; x++)
+			{
+				int brick = x + m_numBricks.x * (y + m_numBricks.y * z);
+				if (this->touches(brick))
+				{
+					touched.push_back(brick);
+				}
+			}
+		}
+	}
+
+	// Missing bricks in view come first, nearest to the eye first, and the ones off screen after them
+	struct Missing
+	{
+		bool hidden;
+		float distance;
+		int brick;
+
+		bool operator<(const Missing& other) const
+		{
+			return (hidden != other.hidden) ? other.hidden : distance < other.distance;
+		}
+	};
+
+	std::vector<Missing> missing;
+	m_numBricksVisible = 0;
+	for (int brick : touched)
+	{
+		bool hidden = !this->visible(brick);
+		m_numBricksVisible += !hidden;
+		if (m_bricks.count(brick) == 0)
+		{
+			glm::vec3 min;
+			glm::vec3 max;
+			this->brickBounds(brick, min, max);
+			missing.push_back({ hidden, m_viewed ? glm::length(0.5f * (min + max) - m_eye) : 0.0f, brick });
+		}
+	}
+
+	std::stable_sort(missing.begin(), missing.end());
+
+	m_numBricksTouched = (int)touched.size();
+	m_numBricksExtracted = 0;
+	for (size_t i = 0; i < missing.size(); i++)
+	{
+		int brick = missing[i].brick;
+		if (this->cancelled())
+		{
+			return false;
+		}
+
+		// Everything in view is there, shown while the rest is being extracted
+		if (visible != nullptr && missing[i].hidden && (i == 0 || !missing[i - 1].hidden))
+		{
+			this->assemble(touched, surfaces);
+			if (!visible(surfaces))
+			{
+				return false;
+			}
+		}
+
+		std::vector<IsoSurface> brickSurfaces(isoValues.size());
+		if (!this->missesAll(brick, isoValues))
+		{
+			glm::ivec3 firstPoint;
+			IsoSurfaceExtractor extractor(this->brickVolume(brick, firstPoint), m_pool);
+			extractor.setIndexed(m_indexed);
+			extractor.setMethod(m_method);
+			extractor.setCancelFlag(m_cancel);
+			if (!extractor.extract(isoValues, brickSurfaces))
+			{
+				return false;
+			}
+		}
+
+		if (m_segmented)
+		{
+			for (IsoSurface& brickSurface : brickSurfaces)
+			{
+				if (!brickSurface.vertices.empty())
+				{
+					brickSurface.segments.push_back({ m_nextKey++, 0, brickSurface.vertices.size(), 0, brickSurface.indices.size() });
+				}
+			}
+		}
+
+		m_bricks[brick].swap(brickSurfaces);
+		m_numBricksExtracted++;
+	}
+
+	// Bricks the region left behind are dropped, they count as newly exposed once it comes back
+	std::vector<int> sorted = touched;
+	std::sort(sorted.begin(), sorted.end());
+	for (auto it = m_bricks.begin(); it != m_bricks.end();)
+	{
+		it = std::binary_search(sorted.begin(), sorted.end(), it->first) ? std::next(it) : m_bricks.erase(it);
+	}
+
+	this->assemble(touched, surfaces);
+
+	return true;
+}
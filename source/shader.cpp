@@ -63,6 +63,34 @@ void ShaderBase::setBufferNormal(int stride, int offset)
 	this->setBufferParameter("vNormal", 3, stride, offset);
 }
 
+void ShaderBase::setBufferNormalOctahedral(int stride, int offset)
+{
+	this->setBufferParameter("vNormal", 2, stride, offset, GL_SHORT, GL_TRUE);
+}
+
+void ShaderBase::setBufferPositionQuantized(int stride, int offset)
+{
+	this->setBufferParameter("vPosition", 3, stride, offset, GL_UNSIGNED_SHORT, GL_TRUE);
+}
+
+void ShaderBase::setColorNorm(float colorNorm)
+{
+	glUniform1f(glGetUniformLocation(m_pid, "fMeshColorNorm"), colorNorm);
+}
+
+// Packed buffers have no color norm, its attribute is disabled so it is not fetched past their end
+void ShaderBase::setQuantization(bool enable, const glm::vec3& origin, const glm::vec3& scale)
+{
+	if (enable)
+	{
+		this->disableBufferParameter("fColorNorm");
+	}
+
+	glUniform1i(glGetUniformLocation(m_pid, "bQuantized"), enable);
+	glUniform3fv(glGetUniformLocation(m_pid, "vQuantizationOrigin"), 1, &origin[0]);
+	glUniform3fv(glGetUniformLocation(m_pid, "vQuantizationScale"), 1, &scale[0]);
+}
+
 void ShaderBase::setBufferTextureCoord(int stride, int offset)
 {
 	this->setBufferParameter("vTexCoord", 2, stride, offset);
@@ -83,11 +111,11 @@ void ShaderBase::setModelViewProjection(const glm::mat4& modelViewProjection)
 	glUniformMatrix4fv(glGetUniformLocation(m_pid, "mModelViewProj"), 1, GL_FALSE, &modelViewProjection[0][0]);
 }
 
-void ShaderBase::setBufferParameter(std::string name, int numAttribs, int stride, int offset)
+void ShaderBase::setBufferParameter(std::string name, int numAttribs, int stride, int offset, GLenum type, GLboolean normalized)
 {
 	GLuint loc = glGetAttribLocation(m_pid, name.c_str());
 	glEnableVertexAttribArray(loc);
-	glVertexAttribPointer(loc, numAttribs, GL_FLOAT, GL_FALSE, stride, (void*)(offset));
+	glVertexAttribPointer(loc, numAttribs, type, normalized, stride, (void*)(offset));
 
 	if (loc == (unsigned int)-1)
 	{
@@ -95,6 +123,15 @@ void ShaderBase::setBufferParameter(std::string name, int numAttribs, int stride
 	}
 }
 
+void ShaderBase::disableBufferParameter(std::string name)
+{
+	GLint loc = glGetAttribLocation(m_pid, name.c_str());
+	if (loc >= 0)
+	{
+		glDisableVertexAttribArray(loc);
+	}
+}
+
 void ShaderBase::setLightPosition(const glm::vec3& lightPosition)
 {
 	glUniform3fv(glGetUniformLocation(m_pid, "vLightPosition"), 1, &lightPosition[0]);
@@ -126,4 +163,52 @@ void ShaderBase::setMaterial(const Material& material)
 	this->setAmbientColor(material.ambientColor);
 	this->setDiffuseColor(material.diffuseColor);
 	this->setSpecularColor(material.specularColor);
-}
\ No newline at end of file
+}
+
+ComputeShader::ComputeShader(std::string computeShader)
+	: m_pid(0)
+{
+	std::ifstream file(computeShader);
+	if (!file)
+	{
+		fprintf(stderr, "Failed to read compute shader %s\n", computeShader.c_str());
+		return;
+	}
+
+	std::stringstream stream;
+	stream << file.rdbuf();
+	std::string code = stream.str();
+	const char* source = code.c_str();
+
+	GLint success;
+	char infoLog[1024];
+	GLuint shader = glCreateShader(GL_COMPUTE_SHADER);
+	glShaderSource(shader, 1, &source, NULL);
+	glCompileShader(shader);
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+	if (!success)
+	{
+		glGetShaderInfoLog(shader, sizeof(infoLog), NULL, infoLog);
+		fprintf(stderr, "Failed to compile compute shader %s\n%s\n", computeShader.c_str(), infoLog);
+		glDeleteShader(shader);
+		return;
+	}
+
+	m_pid = glCreateProgram();
+	glAttachShader(m_pid, shader);
+	glLinkProgram(m_pid);
+	glDeleteShader(shader);
+	glGetProgramiv(m_pid, GL_LINK_STATUS, &success);
+	if (!success)
+	{
+		glGetProgramInfoLog(m_pid, sizeof(infoLog), NULL, infoLog);
+		fprintf(stderr, "Failed to link compute shader %s\n%s\n", computeShader.c_str(), infoLog);
+		glDeleteProgram(m_pid);
+		m_pid = 0;
+	}
+}
+
+ComputeShader::~ComputeShader()
+{
+	glDeleteProgram(m_pid);
+}
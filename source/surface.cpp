@@ -3,7 +3,7 @@
 
 Surface::Surface(Grid2D& grid, ColorFunction colorFunction)
     : m_grid(grid),
-      m_shader(new BasicColorMapShader()),
+      m_shader(nullptr),
       m_colorFunction(colorFunction),
       m_defaultColor(glm::vec4(1.0f, 0, 0, 1.0f))
 {
@@ -33,6 +33,8 @@ void Surface::initMovable(const GLuint& vao, const GLuint& vbo)
 {
     m_wireframe = GL_FILL;
 
+    // Created with the other GL objects so a surface can be built before there is a context
+    m_shader = new BasicColorMapShader();
     m_shader->use();
 
     // Build surface vertices
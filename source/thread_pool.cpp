@@ -0,0 +1,162 @@
+#pragma once
+#include <thread_pool.h>
+
+ThreadPool::ThreadPool(int numThreads)
+	: m_numQueued(0),
+	  m_stop(false)
+{
+	if (numThreads <= 0)
+	{
+		numThreads = std::max(1, (int)std::thread::hardware_concurrency());
+	}
+
+	for (int i = 0; i < numThreads; i++)
+	{
+		m_queues.push_back(new Queue());
+	}
+
+	for (int i = 0; i < numThreads; i++)
+	{
+		m_threads.push_back(std::thread(&ThreadPool::run, this, i));
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_wakeMutex);
+		m_stop = true;
+	}
+
+	m_wake.notify_all();
+
+	for (std::thread& thread : m_threads)
+	{
+		thread.join();
+	}
+
+	for (Queue* queue : m_queues)
+	{
+		delete queue;
+	}
+}
+
+ThreadPool& ThreadPool::instance()
+{
+	static ThreadPool pool;
+	return pool;
+}
+
+void ThreadPool::parallelFor(int count, const IndexedTask& task)
+{
+	if (count <= 0)
+	{
+		return;
+	}
+
+	int remaining = count;
+	std::mutex doneMutex;
+	std::condition_variable done;
+
+	// Hand out contiguous runs of indices so neighbouring tasks start on the same worker
+	int numQueues = (int)m_queues.size();
+	for (int i = 0; i < count; i++)
+	{
+		int queue = (int)((long long)i * numQueues / count);
+		this->push(queue, [i, &task, &remaining, &doneMutex, &done]()
+		{
+			task(i);
+
+			std::lock_guard<std::mutex> lock(doneMutex);
+			if (--remaining == 0)
+			{
+				done.notify_all();
+			}
+		});
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_wakeMutex);
+	}
+
+	m_wake.notify_all();
+
+	// Help out instead of blocking, this also keeps nested calls from a worker thread from deadlocking
+	Task stolen;
+	while (this->steal(-1, stolen))
+	{
+		stolen();
+		stolen = nullptr;
+	}
+
+	std::unique_lock<std::mutex> lock(doneMutex);
+	done.wait(lock, [&remaining]() { return remaining == 0; });
+}
+
+void ThreadPool::push(int queue, Task task)
+{
+	std::lock_guard<std::mutex> lock(m_queues[queue]->mutex);
+	m_queues[queue]->tasks.push_back(std::move(task));
+	m_numQueued++;
+}
+
+bool ThreadPool::pop(int queue, Task& task)
+{
+	std::lock_guard<std::mutex> lock(m_queues[queue]->mutex);
+	if (m_queues[queue]->tasks.empty())
+	{
+		return false;
+	}
+
+	task = std::move(m_queues[queue]->tasks.front());
+	m_queues[queue]->tasks.pop_front();
+	m_numQueued--;
+
+	return true;
+}
+
+bool ThreadPool::steal(int thief, Task& task)
+{
+	int numQueues = (int)m_queues.size();
+	for (int i = 1; i <= numQueues; i++)
+	{
+		int victim = (thief + i + numQueues) % numQueues;
+		if (victim == thief)
+		{
+			continue;
+		}
+
+		std::lock_guard<std::mutex> lock(m_queues[victim]->mutex);
+		if (!m_queues[victim]->tasks.empty())
+		{
+			task = std::move(m_queues[victim]->tasks.back());
+			m_queues[victim]->tasks.pop_back();
+			m_numQueued--;
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void ThreadPool::run(int queue)
+{
+	while (true)
+	{
+		Task task;
+		if (this->pop(queue, task) || this->steal(queue, task))
+		{
+			task();
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(m_wakeMutex);
+		m_wake.wait(lock, [this]() { return m_stop || m_numQueued > 0; });
+
+		if (m_stop)
+		{
+			return;
+		}
+	}
+}
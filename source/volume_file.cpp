@@ -0,0 +1,151 @@
+#pragma once
+#include <volume_file.h>
+#include <ddsbase.h>
+#include <algorithm>
+#include <cmath>
+
+VolumeFile::VolumeFile(const std::string& path)
+	: m_bytes(0)
+{
+	unsigned int components;
+	unsigned int depth;
+	unsigned int width;
+	unsigned int height;
+
+	float scaleX;
+	float scaleY;
+	float scaleZ;
+
+	unsigned char* volume = readPVMvolume(
+		path.c_str(),
+		&width,
+		&height,
+		&depth,
+		&components,
+		&scaleX,
+		&scaleY,
+		&scaleZ,
+		NULL, NULL, NULL, NULL
+	);
+
+	if (volume == NULL)
+	{
+		fprintf(stderr, "Failed to read PVM volume %s\n", path.c_str());
+		return;
+	}
+
+	this->init(volume, width, height, depth, components, glm::vec3(scaleX, scaleY, scaleZ));
+	free(volume);
+}
+
+VolumeFile::VolumeFile(
+	const std::string& path,
+	int numPointsX,
+	int numPointsY,
+	int numPointsZ,
+	unsigned int components,
+	const glm::vec3& spacing)
+	: m_bytes(0)
+{
+	unsigned int bytes = 0;
+	unsigned char* volume = readDDSfile(path.c_str(), &bytes);
+	if (volume == NULL)
+	{
+		volume = readRAWfile(path.c_str(), &bytes);
+	}
+
+	if (volume == NULL)
+	{
+		fprintf(stderr, "Failed to read volume %s\n", path.c_str());
+		return;
+	}
+
+	if (bytes != (size_t)numPointsX * numPointsY * numPointsZ * components)
+	{
+		fprintf(stderr, "Volume %s holds %u bytes, not %dx%dx%d values of %u bytes\n",
+			path.c_str(), bytes, numPointsX, numPointsY, numPointsZ, components);
+		free(volume);
+		return;
+	}
+
+	this->init(volume, numPointsX, numPointsY, numPointsZ, components, spacing);
+	free(volume);
+}
+
+void VolumeFile::decode(const unsigned char* data, unsigned int components, size_t count, float* values)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		int value = 0;
+
+		for (unsigned int j = 0; j < components; j++)
+		{
+			value |= data[i * components + j] << (8 * j);
+		}
+
+		values[i] = (float)value;
+	}
+}
+
+bool VolumeFile::writeBricks(const std::string& pvmFilePath, const std::string& brickFilePath, int brickCells)
+{
+	unsigned int components;
+	unsigned int depth;
+	unsigned int width;
+	unsigned int height;
+
+	float scaleX;
+	float scaleY;
+	float scaleZ;
+
+	unsigned char* volume = readPVMvolume(
+		pvmFilePath.c_str(),
+		&width,
+		&height,
+		&depth,
+		&components,
+		&scaleX,
+		&scaleY,
+		&scaleZ,
+		NULL, NULL, NULL, NULL
+	);
+
+	if (volume == NULL)
+	{
+		fprintf(stderr, "Failed to read PVM volume %s\n", pvmFilePath.c_str());
+		return false;
+	}
+
+	// Decoded as the whole volume is, one slice at a time
+	size_t sliceSize = (size_t)width * height;
+	auto readSlice = [&](int z, float* values)
+	{
+		VolumeFile::decode(volume + z * sliceSize * components, components, sliceSize, values);
+		return true;
+	};
+
+	glm::vec3 spacing(scaleX, scaleY, scaleZ);
+	glm::vec3 origin = -glm::vec3(width, height, depth) * spacing / 2.0f;
+	bool written = BrickedVolume::write(brickFilePath, width, height, depth, origin, spacing, readSlice, brickCells);
+
+	free(volume);
+
+	return written;
+}
+
+void VolumeFile::init(const unsigned char* data, int numPointsX, int numPointsY, int numPointsZ, unsigned int components, const glm::vec3& spacing)
+{
+	size_t count = (size_t)numPointsX * numPointsY * numPointsZ;
+	m_bytes = count * components;
+	m_values.resize(count);
+	VolumeFile::decode(data, components, count, m_values.data());
+
+	m_volume.values = m_values.data();
+	m_volume.numPointsX = numPointsX;
+	m_volume.numPointsY = numPointsY;
+	m_volume.numPointsZ = numPointsZ;
+	m_volume.origin = -glm::vec3(numPointsX, numPointsY, numPointsZ) * spacing / 2.0f;
+	m_volume.spacing = spacing;
+	m_volume.min = *std::min_element(m_values.begin(), m_values.end());
+	m_volume.max = *std::max_element(m_values.begin(), m_values.end());
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <volume_pyramid.h>
+#include <algorithm>
+
+VolumePyramid::VolumePyramid(const Volume& volume, VolumeReduction reduction, int maxLevels, ThreadPool& pool)
+{
+	m_levels.push_back(volume);
+	while ((int)m_levels.size() <= maxLevels)
+	{
+		const Volume fine = m_levels.back();
+		if (fine.numPointsX < 4 || fine.numPointsY < 4 || fine.numPointsZ < 4)
+		{
+			break;
+		}
+
+		Volume coarse = fine;
+		coarse.numPointsX = (fine.numPointsX + 1) / 2;
+		coarse.numPointsY = (fine.numPointsY + 1) / 2;
+		coarse.numPointsZ = (fine.numPointsZ + 1) / 2;
+		coarse.origin = fine.origin + 0.5f * fine.spacing;
+		coarse.spacing = 2.0f * fine.spacing;
+		coarse.ghostLow = glm::ivec3(0);
+		coarse.ghostHigh = glm::ivec3(0);
+
+		m_values.push_back(std::vector<float>((size_t)coarse.numPointsX * coarse.numPointsY * coarse.numPointsZ));
+		float* values = m_values.back().data();
+
+		// The last point of an odd axis has no partner, it is reduced with itself
+		pool.parallelFor(coarse.numPointsZ, [&](int z)
+		{
+			int z0 = 2 * z;
+			int z1 = std::min(z0 + 1, fine.numPointsZ - 1);
+			for (int y = 0; y < coarse.numPointsY; y++)
+			{
+				int y0 = 2 * y;
+				int y1 = std::min(y0 + 1, fine.numPointsY - 1);
+				const float* rows[4] = {
+					fine.values + fine.index(0, y0, z0), fine.values + fine.index(0, y1, z0),
+					fine.values + fine.index(0, y0, z1), fine.values + fine.index(0, y1, z1) };
+				float* row = values + coarse.index(0, y, z);
+
+				for (int x = 0; x < coarse.numPointsX; x++)
+				{
+					int x0 = 2 * x;
+					int x1 = std::min(x0 + 1, fine.numPointsX - 1);
+					if (reduction == VOLUME_REDUCE_MAX)
+					{
+						float value = rows[0][x0];
+						for (const float* fineRow : rows)
+						{
+							value = std::max(value, std::max(fineRow[x0], fineRow[x1]));
+						}
+						row[x] = value;
+					}
+					else
+					{
+						float sum = 0;
+						for (const float* fineRow : rows)
+						{
+							sum += fineRow[x0] + fineRow[x1];
+						}
+						row[x] = 0.125f * sum;
+					}
+				}
+			}
+		});
+
+		coarse.values = values;
+		m_levels.push_back(coarse);
+	}
+}
+
+size_t VolumePyramid::memory() const
+{
+	size_t bytes = 0;
+	for (const std::vector<float>& values : m_values)
+	{
+		bytes += values.size() * sizeof(float);
+	}
+
+	return bytes;
+}